@@ -0,0 +1,373 @@
+#include "FFT.h"
+#include "MathLib.h"
+#include "Simd.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+/* MathLib micro-benchmark
+* Times DFT_Slow, the single-transform FFT and the batched FFT over power-of-two sizes, plus a few
+* sizes with factors of 3 and 5 and a few primes so the mixed-radix and Bluestein paths are gated
+* too. Every row, DFT_Slow's included, is checked against a double precision reference: a direct
+* DFT while it is affordable, a radix-2 FFT above that. The SIMD width is fixed at compile time, so
+* the scalar baseline is the same source built as MathLib_Benchmark_Scalar. Results go to stdout and to a JSON file, and the exit code is
+* non-zero when any error is over the threshold.
+*
+* Usage: MathLib_Benchmark [--json path] [--min-size n] [--max-size n] [--max-error e] [--min-time ms]
+*/
+
+struct BenchmarkOptions
+{
+	std::string jsonPath = "mathlib_benchmark.json";
+	size_t minSize = 8;
+	size_t maxSize = size_t(1) << 20;
+	// relative to the largest reference magnitude
+	double maxError = 1e-5;
+	double minTimeMs = 50.0;
+};
+
+struct BenchmarkResult
+{
+	std::string name;
+	size_t size;
+	size_t batchCount;
+	double nsPerPoint;
+	double gflops;
+	double maxError;
+};
+
+// DFT_Slow and the direct reference are O(n^2), so they run only up to this size
+static constexpr size_t kMaxSlowSize = 4096;
+// non-power-of-two sizes run alongside the sweep when they fall inside it: mixed radix-2/3/5
+// sizes, and primes that take the generic odd-prime pass and Bluestein's algorithm
+static const size_t kMixedSizes[] = { 12, 17, 60, 1000, 1009 };
+// batches cover about this many points so small and large transforms do similar amounts of work
+static constexpr size_t kBatchPoints = size_t(1) << 18;
+static constexpr size_t kMaxBatchSize = 4096;
+
+static const char* GetSimdName()
+{
+#if ENGINE_SIMD_AVX2
+	return "avx2";
+#elif ENGINE_SIMD_SSE2
+	return "sse2";
+#else
+	return "scalar";
+#endif
+}
+
+// Iterative radix-2 transform in double precision, the reference for sizes DFT_Slow cannot reach
+static std::vector<std::complex<double>> ReferenceFFT(const std::vector<ComplexNumber>& x)
+{
+	const size_t n = x.size();
+	std::vector<std::complex<double>> a(n);
+	for (size_t i = 0, j = 0; i < n; ++i)
+	{
+		a[j] = std::complex<double>(x[i].re, x[i].im);
+		for (size_t bit = n >> 1; (j ^= bit) < bit; bit >>= 1) {}
+	}
+
+	for (size_t length = 2; length <= n; length <<= 1)
+	{
+		for (size_t k = 0; k < length / 2; ++k)
+		{
+			const double angle = -2.0 * PI * static_cast<double>(k) / static_cast<double>(length);
+			const std::complex<double> w(std::cos(angle), std::sin(angle));
+			for (size_t start = 0; start < n; start += length)
+			{
+				const std::complex<double> even = a[start + k];
+				const std::complex<double> odd = a[start + k + length / 2] * w;
+				a[start + k] = even + odd;
+				a[start + k + length / 2] = even - odd;
+			}
+		}
+	}
+
+	return a;
+}
+
+// Direct DFT in double precision, for any size. The twiddle index k * j is reduced mod n before the
+// angle is formed, so the angles stay exact however large the product gets.
+static std::vector<std::complex<double>> ReferenceDFT(const std::vector<ComplexNumber>& x)
+{
+	const size_t n = x.size();
+	std::vector<std::complex<double>> twiddles(n);
+	for (size_t k = 0; k < n; ++k)
+	{
+		const double angle = -2.0 * PI * static_cast<double>(k) / static_cast<double>(n);
+		twiddles[k] = std::complex<double>(std::cos(angle), std::sin(angle));
+	}
+
+	std::vector<std::complex<double>> result(n);
+	for (size_t k = 0; k < n; ++k)
+	{
+		std::complex<double> sum = 0.0;
+		for (size_t j = 0; j < n; ++j)
+		{
+			sum += std::complex<double>(x[j].re, x[j].im) * twiddles[(k * j) % n];
+		}
+		result[k] = sum;
+	}
+	return result;
+}
+
+static std::vector<std::complex<double>> Reference(const std::vector<ComplexNumber>& x)
+{
+	const bool bPowerOfTwo = (x.size() & (x.size() - 1)) == 0;
+	return bPowerOfTwo && x.size() > kMaxSlowSize ? ReferenceFFT(x) : ReferenceDFT(x);
+}
+
+static double RelativeError(const float* re, const float* im, const std::vector<std::complex<double>>& reference)
+{
+	double maxMagnitude = 0.0;
+	double maxError = 0.0;
+	for (size_t i = 0; i < reference.size(); ++i)
+	{
+		maxMagnitude = std::max(maxMagnitude, std::abs(reference[i]));
+		maxError = std::max(maxError, std::abs(std::complex<double>(re[i], im[i]) - reference[i]));
+	}
+	return maxMagnitude > 0.0 ? maxError / maxMagnitude : maxError;
+}
+
+// Runs body until minTimeMs has passed and returns the fastest of several rounds, in nanoseconds per call
+template <typename F>
+static double TimeCalls(F&& body, double minTimeMs)
+{
+	using Clock = std::chrono::steady_clock;
+
+	body();
+
+	double best = 1e300;
+	for (int round = 0; round < 5; ++round)
+	{
+		size_t calls = 0;
+		const Clock::time_point start = Clock::now();
+		double elapsedMs = 0.0;
+		do
+		{
+			body();
+			++calls;
+			elapsedMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		} while (elapsedMs < minTimeMs / 5.0);
+
+		best = std::min(best, elapsedMs * 1e6 / static_cast<double>(calls));
+	}
+	return best;
+}
+
+static BenchmarkResult MakeResult(const std::string& name, size_t size, size_t batchCount, double nsPerCall, double maxError)
+{
+	const double points = static_cast<double>(size * batchCount);
+	// the usual 5 n log2 n operation count for a complex FFT, so sizes and algorithms compare directly
+	const double flops = 5.0 * points * std::log2(static_cast<double>(size));
+
+	BenchmarkResult result;
+	result.name = name;
+	result.size = size;
+	result.batchCount = batchCount;
+	result.nsPerPoint = nsPerCall / points;
+	result.gflops = flops / nsPerCall;
+	result.maxError = maxError;
+	return result;
+}
+
+static void RunSize(size_t size, const BenchmarkOptions& options, std::vector<BenchmarkResult>& results)
+{
+	std::mt19937 generator(static_cast<uint32_t>(size));
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+	std::vector<ComplexNumber> input(size);
+	for (ComplexNumber& value : input)
+	{
+		value = ComplexNumber(distribution(generator), distribution(generator));
+	}
+	const std::vector<std::complex<double>> reference = Reference(input);
+
+	/* DFT_Slow */
+	if (size <= kMaxSlowSize)
+	{
+		std::vector<ComplexNumber> output;
+		const double ns = TimeCalls([&]() { output = DFT_Slow(input); }, options.minTimeMs);
+
+		ComplexBuffer buffer(output);
+		results.push_back(MakeResult("dft_slow", size, 1, ns, RelativeError(buffer.GetRe(), buffer.GetIm(), reference)));
+	}
+
+	/* FFT */
+	{
+		const FFTPlan& plan = FFTPlanCache::GetPlan(size, FFTDirection::Forward);
+		const ComplexBuffer source(input);
+		ComplexBuffer data(size);
+		ComplexBuffer work(plan.GetWorkSize());
+
+		// the copy back to the source values is part of the timing, but it is small next to the transform
+		const double ns = TimeCalls([&]()
+		{
+			std::memcpy(data.GetRe(), source.GetRe(), size * sizeof(float));
+			std::memcpy(data.GetIm(), source.GetIm(), size * sizeof(float));
+			plan.Execute(data.GetRe(), data.GetIm(), work.GetRe(), work.GetIm());
+		}, options.minTimeMs);
+
+		results.push_back(MakeResult(std::string("fft_") + GetSimdName(), size, 1, ns, RelativeError(data.GetRe(), data.GetIm(), reference)));
+	}
+
+	/* Batched FFT */
+	if (size <= kMaxBatchSize)
+	{
+		const FFTBatchPlan plan(size, FFTDirection::Forward);
+		const size_t batchCount = std::max<size_t>(kBatchPoints / size, 1);
+
+		ComplexBuffer source(size * batchCount);
+		for (size_t b = 0; b < batchCount; ++b)
+		{
+			for (size_t i = 0; i < size; ++i)
+			{
+				source.Set(b * size + i, input[i]);
+			}
+		}
+		ComplexBuffer data(size * batchCount);
+
+		const double ns = TimeCalls([&]()
+		{
+			std::memcpy(data.GetRe(), source.GetRe(), data.GetSize() * sizeof(float));
+			std::memcpy(data.GetIm(), source.GetIm(), data.GetSize() * sizeof(float));
+			plan.Execute(data, batchCount);
+		}, options.minTimeMs);
+
+		// every transform in the batch has the same input, so check the first and the last
+		const double firstError = RelativeError(data.GetRe(), data.GetIm(), reference);
+		const double lastError = RelativeError(data.GetRe() + (batchCount - 1) * size, data.GetIm() + (batchCount - 1) * size, reference);
+		results.push_back(MakeResult(std::string("fft_batch_") + GetSimdName(), size, batchCount, ns, std::max(firstError, lastError)));
+	}
+}
+
+static bool WriteJson(const std::string& path, const BenchmarkOptions& options, const std::vector<BenchmarkResult>& results)
+{
+	std::ofstream file(path);
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	file << "{\n";
+	file << "\t\"simd\": \"" << GetSimdName() << "\",\n";
+	file << "\t\"simdWidth\": " << SimdFloat::Width << ",\n";
+	file << "\t\"maxErrorThreshold\": " << options.maxError << ",\n";
+	file << "\t\"results\": [\n";
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		const BenchmarkResult& result = results[i];
+		file << "\t\t{ \"name\": \"" << result.name << "\", \"size\": " << result.size << ", \"batch\": " << result.batchCount
+			<< ", \"nsPerPoint\": " << result.nsPerPoint << ", \"gflops\": " << result.gflops << ", \"maxError\": " << result.maxError
+			<< (i + 1 < results.size() ? " },\n" : " }\n");
+	}
+	file << "\t]\n";
+	file << "}\n";
+
+	return file.good();
+}
+
+static bool ParseOptions(int argc, char** argv, BenchmarkOptions& options)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		const bool bHasValue = i + 1 < argc;
+		if (std::strcmp(argv[i], "--json") == 0 && bHasValue)
+		{
+			options.jsonPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--min-size") == 0 && bHasValue)
+		{
+			options.minSize = std::stoull(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--max-size") == 0 && bHasValue)
+		{
+			options.maxSize = std::stoull(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--max-error") == 0 && bHasValue)
+		{
+			options.maxError = std::stod(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--min-time") == 0 && bHasValue)
+		{
+			options.minTimeMs = std::stod(argv[++i]);
+		}
+		else
+		{
+			std::cerr << "Unknown argument " << argv[i] << "\n";
+			std::cerr << "Usage: " << argv[0] << " [--json path] [--min-size n] [--max-size n] [--max-error e] [--min-time ms]\n";
+			return false;
+		}
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	BenchmarkOptions options;
+	if (!ParseOptions(argc, argv, options))
+	{
+		return 2;
+	}
+
+	// the sweep doubles from minSize, and the double precision reference above kMaxSlowSize is radix-2 only
+	if (options.minSize == 0 || (options.minSize & (options.minSize - 1)) != 0)
+	{
+		std::cerr << "--min-size must be a power of two\n";
+		return 2;
+	}
+
+	std::cout << "MathLib benchmark, " << GetSimdName() << " (" << SimdFloat::Width << " lanes)\n";
+	std::cout << "name                 size    batch    ns/point    GFLOPS   max error\n";
+
+	std::vector<size_t> sizes;
+	for (size_t size = options.minSize; size <= options.maxSize; size *= 2)
+	{
+		sizes.push_back(size);
+	}
+	for (size_t size : kMixedSizes)
+	{
+		if (size >= options.minSize && size <= options.maxSize)
+		{
+			sizes.push_back(size);
+		}
+	}
+	std::sort(sizes.begin(), sizes.end());
+
+	std::vector<BenchmarkResult> results;
+	bool bPassed = true;
+	for (size_t size : sizes)
+	{
+		const size_t firstResult = results.size();
+		RunSize(size, options, results);
+
+		for (size_t i = firstResult; i < results.size(); ++i)
+		{
+			const BenchmarkResult& result = results[i];
+			const bool bResultPassed = result.maxError <= options.maxError;
+			bPassed = bPassed && bResultPassed;
+
+			char line[160];
+			std::snprintf(line, sizeof(line), "%-18s %7zu %8zu %11.3f %9.3f %11.3e%s\n",
+				result.name.c_str(), result.size, result.batchCount, result.nsPerPoint, result.gflops, result.maxError, bResultPassed ? "" : "  FAILED");
+			std::cout << line;
+		}
+	}
+
+	if (!WriteJson(options.jsonPath, options, results))
+	{
+		std::cerr << "Failed to write " << options.jsonPath << "\n";
+		return 2;
+	}
+
+	return bPassed ? 0 : 1;
+}
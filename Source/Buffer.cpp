@@ -0,0 +1,71 @@
+#include "Buffer.h"
+
+#include "Renderer.h"
+
+#include <stdexcept>
+
+Buffer::Buffer(Renderer& renderer, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties)
+	: renderer(renderer), size(size)
+{
+	VkDevice device = renderer.GetLogicalDevice();
+
+	VkBufferCreateInfo bufferInfo = { VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+	bufferInfo.size = size;
+	bufferInfo.usage = usage;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create buffer");
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetBufferMemoryRequirements(device, buffer, &memoryRequirements);
+
+	VkMemoryAllocateInfo allocInfo = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
+	allocInfo.allocationSize = memoryRequirements.size;
+	allocInfo.memoryTypeIndex = renderer.FindMemoryType(memoryRequirements.memoryTypeBits, properties);
+
+	if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+	{
+		vkDestroyBuffer(device, buffer, nullptr);
+		throw std::runtime_error("failed to allocate buffer memory");
+	}
+
+	vkBindBufferMemory(device, buffer, memory, 0);
+}
+
+Buffer::~Buffer()
+{
+	Unmap();
+	vkDestroyBuffer(renderer.GetLogicalDevice(), buffer, nullptr);
+	vkFreeMemory(renderer.GetLogicalDevice(), memory, nullptr);
+}
+
+void* Buffer::Map()
+{
+	if (!mapped && vkMapMemory(renderer.GetLogicalDevice(), memory, 0, size, 0, &mapped) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to map buffer memory");
+	}
+	return mapped;
+}
+
+void Buffer::Unmap()
+{
+	if (mapped)
+	{
+		vkUnmapMemory(renderer.GetLogicalDevice(), memory);
+		mapped = nullptr;
+	}
+}
+
+VkBuffer Buffer::GetBuffer() const
+{
+	return buffer;
+}
+
+VkDeviceSize Buffer::GetSize() const
+{
+	return size;
+}
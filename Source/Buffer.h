@@ -0,0 +1,29 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+class Renderer;
+
+// A VkBuffer with its own dedicated allocation. Host visible buffers can be mapped for uploads and
+// readbacks; device local buffers are filled by copying from one of those.
+class Buffer
+{
+public:
+	Buffer(Renderer& renderer, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
+	~Buffer();
+
+	Buffer(const Buffer&) = delete;
+	void operator=(const Buffer&) = delete;
+
+	void* Map();
+	void Unmap();
+
+	VkBuffer GetBuffer() const;
+	VkDeviceSize GetSize() const;
+private:
+	Renderer& renderer;
+	VkBuffer buffer = VK_NULL_HANDLE;
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize size;
+	void* mapped = nullptr;
+};
@@ -0,0 +1,225 @@
+#include "ComplexBuffer.h"
+
+#include <stdexcept>
+
+ComplexBuffer::ComplexBuffer(size_t size)
+	: re(size, 0.0f), im(size, 0.0f)
+{
+}
+
+ComplexBuffer::ComplexBuffer(const std::vector<ComplexNumber>& values)
+	: re(values.size()), im(values.size())
+{
+	for (size_t i = 0; i < values.size(); ++i)
+	{
+		re[i] = values[i].re;
+		im[i] = values[i].im;
+	}
+}
+
+void ComplexBuffer::Resize(size_t size)
+{
+	re.resize(size, 0.0f);
+	im.resize(size, 0.0f);
+}
+
+size_t ComplexBuffer::GetSize() const
+{
+	return re.size();
+}
+
+float* ComplexBuffer::GetRe()
+{
+	return re.data();
+}
+
+float* ComplexBuffer::GetIm()
+{
+	return im.data();
+}
+
+const float* ComplexBuffer::GetRe() const
+{
+	return re.data();
+}
+
+const float* ComplexBuffer::GetIm() const
+{
+	return im.data();
+}
+
+ComplexNumber ComplexBuffer::Get(size_t index) const
+{
+	return ComplexNumber(re[index], im[index]);
+}
+
+void ComplexBuffer::Set(size_t index, const ComplexNumber& value)
+{
+	re[index] = value.re;
+	im[index] = value.im;
+}
+
+std::vector<ComplexNumber> ComplexBuffer::ToVector() const
+{
+	std::vector<ComplexNumber> values(re.size());
+	for (size_t i = 0; i < re.size(); ++i)
+	{
+		values[i] = ComplexNumber(re[i], im[i]);
+	}
+	return values;
+}
+
+// Runs op over full vectors, then once more over a zero-padded copy of the tail, so the scalar
+// remainder goes through exactly the same arithmetic as the vector body.
+template <size_t InputCount, size_t OutputCount, typename Op>
+static void RunKernel(size_t count, const float* const (&inputs)[InputCount], float* const (&outputs)[OutputCount], Op op)
+{
+	constexpr size_t width = SimdFloat::Width;
+
+	SimdFloat in[InputCount];
+	SimdFloat out[OutputCount];
+
+	size_t i = 0;
+	for (; i + width <= count; i += width)
+	{
+		for (size_t k = 0; k < InputCount; ++k)
+		{
+			in[k] = SimdLoad(inputs[k] + i);
+		}
+		op(in, out);
+		for (size_t k = 0; k < OutputCount; ++k)
+		{
+			SimdStore(outputs[k] + i, out[k]);
+		}
+	}
+
+	if (i < count)
+	{
+		const size_t remainder = count - i;
+		float tailIn[InputCount][width] = {};
+		float tailOut[OutputCount][width];
+
+		for (size_t k = 0; k < InputCount; ++k)
+		{
+			for (size_t j = 0; j < remainder; ++j)
+			{
+				tailIn[k][j] = inputs[k][i + j];
+			}
+			in[k] = SimdLoad(tailIn[k]);
+		}
+		op(in, out);
+		for (size_t k = 0; k < OutputCount; ++k)
+		{
+			SimdStore(tailOut[k], out[k]);
+			for (size_t j = 0; j < remainder; ++j)
+			{
+				outputs[k][i + j] = tailOut[k][j];
+			}
+		}
+	}
+}
+
+void ComplexMultiply(const float* aRe, const float* aIm, const float* bRe, const float* bIm, float* outRe, float* outIm, size_t count)
+{
+	RunKernel<4, 2>(count, { aRe, aIm, bRe, bIm }, { outRe, outIm }, [](const SimdFloat* in, SimdFloat* out)
+	{
+		out[0] = SimdMulSub(in[0], in[2], SimdMul(in[1], in[3]));
+		out[1] = SimdMulAdd(in[0], in[3], SimdMul(in[1], in[2]));
+	});
+}
+
+void ComplexMultiplyAccumulate(const float* aRe, const float* aIm, const float* bRe, const float* bIm, float* accRe, float* accIm, size_t count)
+{
+	RunKernel<6, 2>(count, { aRe, aIm, bRe, bIm, accRe, accIm }, { accRe, accIm }, [](const SimdFloat* in, SimdFloat* out)
+	{
+		out[0] = SimdSub(SimdMulAdd(in[0], in[2], in[4]), SimdMul(in[1], in[3]));
+		out[1] = SimdMulAdd(in[1], in[2], SimdMulAdd(in[0], in[3], in[5]));
+	});
+}
+
+void ComplexConjugateMultiply(const float* aRe, const float* aIm, const float* bRe, const float* bIm, float* outRe, float* outIm, size_t count)
+{
+	RunKernel<4, 2>(count, { aRe, aIm, bRe, bIm }, { outRe, outIm }, [](const SimdFloat* in, SimdFloat* out)
+	{
+		out[0] = SimdMulAdd(in[0], in[2], SimdMul(in[1], in[3]));
+		out[1] = SimdMulSub(in[1], in[2], SimdMul(in[0], in[3]));
+	});
+}
+
+void ComplexMagnitude(const float* re, const float* im, float* out, size_t count)
+{
+	RunKernel<2, 1>(count, { re, im }, { out }, [](const SimdFloat* in, SimdFloat* out)
+	{
+		out[0] = SimdSqrt(SimdMulAdd(in[0], in[0], SimdMul(in[1], in[1])));
+	});
+}
+
+void ComplexArg(const float* re, const float* im, float* out, size_t count)
+{
+	RunKernel<2, 1>(count, { re, im }, { out }, [](const SimdFloat* in, SimdFloat* out)
+	{
+		const SimdFloat x = in[0];
+		const SimdFloat y = in[1];
+		const SimdFloat ax = SimdAbs(x);
+		const SimdFloat ay = SimdAbs(y);
+
+		// reduce to atan(a) with a in [0, 1], then unfold the octant
+		const SimdFloat numerator = SimdMin(ax, ay);
+		const SimdFloat denominator = SimdMax(SimdMax(ax, ay), SimdSet(1e-30f));
+		const SimdFloat a = SimdDiv(numerator, denominator);
+		const SimdFloat a2 = SimdMul(a, a);
+
+		SimdFloat poly = SimdSet(-0.01172120f);
+		poly = SimdMulAdd(poly, a2, SimdSet(0.05265332f));
+		poly = SimdMulAdd(poly, a2, SimdSet(-0.11643287f));
+		poly = SimdMulAdd(poly, a2, SimdSet(0.19354346f));
+		poly = SimdMulAdd(poly, a2, SimdSet(-0.33262347f));
+		poly = SimdMulAdd(poly, a2, SimdSet(0.99997726f));
+		SimdFloat result = SimdMul(poly, a);
+
+		result = SimdSelect(SimdLess(ax, ay), SimdSub(SimdSet(static_cast<float>(PI / 2.0)), result), result);
+		result = SimdSelect(SimdLess(x, SimdSet(0.0f)), SimdSub(SimdSet(static_cast<float>(PI)), result), result);
+		out[0] = SimdXorSign(result, y);
+	});
+}
+
+static void CheckSizes(const ComplexBuffer& a, const ComplexBuffer& b)
+{
+	if (a.GetSize() != b.GetSize())
+	{
+		throw std::runtime_error("complex buffer sizes do not match");
+	}
+}
+
+void ComplexMultiply(const ComplexBuffer& a, const ComplexBuffer& b, ComplexBuffer& out)
+{
+	CheckSizes(a, b);
+	out.Resize(a.GetSize());
+	ComplexMultiply(a.GetRe(), a.GetIm(), b.GetRe(), b.GetIm(), out.GetRe(), out.GetIm(), a.GetSize());
+}
+
+void ComplexMultiplyAccumulate(const ComplexBuffer& a, const ComplexBuffer& b, ComplexBuffer& acc)
+{
+	CheckSizes(a, b);
+	CheckSizes(a, acc);
+	ComplexMultiplyAccumulate(a.GetRe(), a.GetIm(), b.GetRe(), b.GetIm(), acc.GetRe(), acc.GetIm(), a.GetSize());
+}
+
+void ComplexConjugateMultiply(const ComplexBuffer& a, const ComplexBuffer& b, ComplexBuffer& out)
+{
+	CheckSizes(a, b);
+	out.Resize(a.GetSize());
+	ComplexConjugateMultiply(a.GetRe(), a.GetIm(), b.GetRe(), b.GetIm(), out.GetRe(), out.GetIm(), a.GetSize());
+}
+
+void ComplexMagnitude(const ComplexBuffer& a, std::vector<float>& out)
+{
+	out.resize(a.GetSize());
+	ComplexMagnitude(a.GetRe(), a.GetIm(), out.data(), a.GetSize());
+}
+
+void ComplexArg(const ComplexBuffer& a, std::vector<float>& out)
+{
+	out.resize(a.GetSize());
+	ComplexArg(a.GetRe(), a.GetIm(), out.data(), a.GetSize());
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "MathLib.h"
+#include "Simd.h"
+
+#include <stddef.h>
+#include <vector>
+
+// Structure-of-arrays complex storage: real and imaginary parts live in separate aligned arrays so
+// the kernels below and the FFT can work on SimdFloat::Width values at a time.
+class ComplexBuffer
+{
+public:
+	ComplexBuffer() = default;
+	explicit ComplexBuffer(size_t size);
+	explicit ComplexBuffer(const std::vector<ComplexNumber>& values);
+
+	void Resize(size_t size);
+	size_t GetSize() const;
+
+	float* GetRe();
+	float* GetIm();
+	const float* GetRe() const;
+	const float* GetIm() const;
+
+	ComplexNumber Get(size_t index) const;
+	void Set(size_t index, const ComplexNumber& value);
+	std::vector<ComplexNumber> ToVector() const;
+private:
+	std::vector<float, AlignedAllocator<float>> re;
+	std::vector<float, AlignedAllocator<float>> im;
+};
+
+/* Element-wise kernels
+* The raw pointer versions take count elements from each split array and may be called in place
+* (out == a). The ComplexBuffer versions resize the output to match the inputs.
+*/
+
+// out = a * b
+void ComplexMultiply(const float* aRe, const float* aIm, const float* bRe, const float* bIm, float* outRe, float* outIm, size_t count);
+// acc += a * b
+void ComplexMultiplyAccumulate(const float* aRe, const float* aIm, const float* bRe, const float* bIm, float* accRe, float* accIm, size_t count);
+// out = a * conj(b)
+void ComplexConjugateMultiply(const float* aRe, const float* aIm, const float* bRe, const float* bIm, float* outRe, float* outIm, size_t count);
+// out = |a|
+void ComplexMagnitude(const float* re, const float* im, float* out, size_t count);
+// out = arg(a), within about 2e-6 radians of atan2
+void ComplexArg(const float* re, const float* im, float* out, size_t count);
+
+void ComplexMultiply(const ComplexBuffer& a, const ComplexBuffer& b, ComplexBuffer& out);
+void ComplexMultiplyAccumulate(const ComplexBuffer& a, const ComplexBuffer& b, ComplexBuffer& acc);
+void ComplexConjugateMultiply(const ComplexBuffer& a, const ComplexBuffer& b, ComplexBuffer& out);
+void ComplexMagnitude(const ComplexBuffer& a, std::vector<float>& out);
+void ComplexArg(const ComplexBuffer& a, std::vector<float>& out);
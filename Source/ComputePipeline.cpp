@@ -0,0 +1,95 @@
+#include "ComputePipeline.h"
+
+#include "FileUtils.h"
+#include "ShaderModuleCache.h"
+
+#include <vulkan/vulkan.h>
+
+#include <iostream>
+#include <stdexcept>
+
+ComputePipeline::ComputePipeline(Renderer& renderer, const std::string& shaderFilepath, const std::vector<VkDescriptorSetLayoutBinding>& bindings, uint32_t pushConstantSize)
+    : renderer(renderer)
+{
+    CreateDescriptorSetLayout(bindings);
+    CreatePipelineLayout(pushConstantSize);
+    CreateComputePipeline(shaderFilepath);
+}
+
+ComputePipeline::~ComputePipeline()
+{
+    vkDestroyPipeline(renderer.GetLogicalDevice(), computePipeline, nullptr);
+    vkDestroyPipelineLayout(renderer.GetLogicalDevice(), pipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(renderer.GetLogicalDevice(), descriptorSetLayout, nullptr);
+}
+
+void ComputePipeline::Bind(VkCommandBuffer commandBuffer)
+{
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computePipeline);
+}
+
+VkPipeline ComputePipeline::GetPipeline()
+{
+    return computePipeline;
+}
+
+VkPipelineLayout ComputePipeline::GetPipelineLayout()
+{
+    return pipelineLayout;
+}
+
+VkDescriptorSetLayout ComputePipeline::GetDescriptorSetLayout()
+{
+    return descriptorSetLayout;
+}
+
+void ComputePipeline::CreateDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings)
+{
+    VkDescriptorSetLayoutCreateInfo layoutInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(renderer.GetLogicalDevice(), &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create descriptor set layout");
+    }
+}
+
+void ComputePipeline::CreatePipelineLayout(uint32_t pushConstantSize)
+{
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = pushConstantSize;
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = { VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = pushConstantSize > 0 ? 1 : 0;
+    pipelineLayoutInfo.pPushConstantRanges = pushConstantSize > 0 ? &pushConstantRange : nullptr;
+
+    if (vkCreatePipelineLayout(renderer.GetLogicalDevice(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create compute pipeline layout");
+    }
+}
+
+void ComputePipeline::CreateComputePipeline(const std::string& shaderFilepath)
+{
+    // only read while the pipeline is created, so it is not kept past this call
+    const std::shared_ptr<const ShaderModule> computeShaderModule = renderer.GetShaderModuleCache().Acquire(ReadSpirvFile(shaderFilepath));
+
+    VkPipelineShaderStageCreateInfo computeShaderStageInfo = { VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO };
+    computeShaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    computeShaderStageInfo.pName = "main";
+    computeShaderModule->FillStageInfo(computeShaderStageInfo);
+
+    VkComputePipelineCreateInfo pipelineInfo = { VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO };
+    pipelineInfo.stage = computeShaderStageInfo;
+    pipelineInfo.layout = pipelineLayout;
+
+    if (vkCreateComputePipelines(renderer.GetLogicalDevice(), renderer.GetPipelineCache(), 1, &pipelineInfo, nullptr, &computePipeline) != VK_SUCCESS)
+    {
+        throw std::runtime_error("failed to create compute pipeline");
+    }
+}
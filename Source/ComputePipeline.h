@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Renderer.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+// Compute counterpart to Pipeline: one shader stage, one descriptor set layout and an optional push
+// constant block visible to the compute stage
+class ComputePipeline
+{
+public:
+    ComputePipeline(Renderer& renderer, const std::string& shaderFilepath, const std::vector<VkDescriptorSetLayoutBinding>& bindings, uint32_t pushConstantSize);
+    ~ComputePipeline();
+
+    ComputePipeline(const ComputePipeline&) = delete;
+    void operator=(const ComputePipeline&) = delete;
+
+    void Bind(VkCommandBuffer commandBuffer);
+
+    VkPipeline GetPipeline();
+    VkPipelineLayout GetPipelineLayout();
+    VkDescriptorSetLayout GetDescriptorSetLayout();
+private:
+    void CreateDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+    void CreatePipelineLayout(uint32_t pushConstantSize);
+    void CreateComputePipeline(const std::string& shaderFilepath);
+private:
+    Renderer& renderer;
+    VkDescriptorSetLayout descriptorSetLayout;
+    VkPipelineLayout pipelineLayout;
+    VkPipeline computePipeline;
+};
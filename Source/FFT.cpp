@@ -0,0 +1,1271 @@
+#include "FFT.h"
+
+#include "FFTTables.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string.h>
+#include <unordered_map>
+
+// Prime factors above this run through Bluestein's algorithm, since a generic radix-p pass costs O(p) per point
+static constexpr uint32_t kMaxGenericRadix = 64;
+
+struct FFTScratch
+{
+	std::vector<float, AlignedAllocator<float>> re;
+	std::vector<float, AlignedAllocator<float>> im;
+	std::vector<float, AlignedAllocator<float>> workRe;
+	std::vector<float, AlignedAllocator<float>> workIm;
+};
+
+// Per-thread scratch for the std::vector convenience paths. Buffers only ever grow, so repeated
+// transforms of the same size do not allocate.
+static FFTScratch& GetThreadScratch(size_t size, size_t workSize)
+{
+	thread_local FFTScratch scratch;
+	if (scratch.re.size() < size)
+	{
+		scratch.re.resize(size);
+		scratch.im.resize(size);
+	}
+	if (scratch.workRe.size() < workSize)
+	{
+		scratch.workRe.resize(workSize);
+		scratch.workIm.resize(workSize);
+	}
+	return scratch;
+}
+
+static std::vector<uint32_t> Factorize(size_t n)
+{
+	std::vector<uint32_t> factors;
+	while (n % 4 == 0)
+	{
+		factors.push_back(4);
+		n /= 4;
+	}
+	if (n % 2 == 0)
+	{
+		factors.push_back(2);
+		n /= 2;
+	}
+	for (size_t p = 3; p * p <= n; p += 2)
+	{
+		while (n % p == 0)
+		{
+			factors.push_back(static_cast<uint32_t>(p));
+			n /= p;
+		}
+	}
+	if (n > 1)
+	{
+		factors.push_back(n > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(n));
+	}
+	return factors;
+}
+
+static double DirectionSign(FFTDirection direction)
+{
+	return direction == FFTDirection::Forward ? -1.0 : 1.0;
+}
+
+// exp(sign * 2 pi i * index / length), read from the compile-time table when length allows it
+static void UnitRoot(double sign, size_t index, size_t length, float& outCos, float& outSin)
+{
+	if (IsTablePowerOfTwo(length))
+	{
+		LookupUnitRoot(index * (kFFTTableSize / length), outCos, outSin);
+		outSin = sign < 0.0 ? -outSin : outSin;
+	}
+	else
+	{
+		const double angle = sign * 2.0 * PI * static_cast<double>(index % length) / static_cast<double>(length);
+		outCos = static_cast<float>(cos(angle));
+		outSin = static_cast<float>(sin(angle));
+	}
+}
+
+// butterfly constants for the radix-3 and radix-5 passes
+static constexpr float kSin2Pi3 = static_cast<float>(ConstexprSin(PI / 3.0));
+static constexpr float kCos2Pi5 = static_cast<float>(ConstexprCos(2.0 * PI / 5.0));
+static constexpr float kSin2Pi5 = static_cast<float>(ConstexprSin(2.0 * PI / 5.0));
+static constexpr float kCos4Pi5 = static_cast<float>(-ConstexprCos(PI / 5.0));
+static constexpr float kSin4Pi5 = static_cast<float>(ConstexprSin(PI / 5.0));
+
+/* Stockham passes
+* Each pass reads x[q + s * (p + j * m)] for j < radix, takes a radix-point DFT across j, multiplies
+* output k by w_n^(p * k) and writes it to y[q + s * (radix * p + k)], where n is the pass length,
+* m = n / radix and s is the product of the radices of the earlier passes.
+*/
+
+static void Radix2Pass(size_t m, size_t s, const float* twRe, const float* twIm,
+	const float* xr, const float* xi, float* yr, float* yi)
+{
+	for (size_t p = 0; p < m; ++p)
+	{
+		const float w1r = twRe[p];
+		const float w1i = twIm[p];
+
+		const float* a0r = xr + s * p;
+		const float* a0i = xi + s * p;
+		const float* a1r = xr + s * (p + m);
+		const float* a1i = xi + s * (p + m);
+		float* y0r = yr + s * (2 * p);
+		float* y0i = yi + s * (2 * p);
+		float* y1r = y0r + s;
+		float* y1i = y0i + s;
+
+		size_t q = 0;
+		if (s >= SimdFloat::Width)
+		{
+			const SimdFloat vw1r = SimdSet(w1r);
+			const SimdFloat vw1i = SimdSet(w1i);
+			for (; q + SimdFloat::Width <= s; q += SimdFloat::Width)
+			{
+				const SimdFloat ar = SimdLoad(a0r + q);
+				const SimdFloat ai = SimdLoad(a0i + q);
+				const SimdFloat br = SimdLoad(a1r + q);
+				const SimdFloat bi = SimdLoad(a1i + q);
+				const SimdFloat dr = SimdSub(ar, br);
+				const SimdFloat di = SimdSub(ai, bi);
+				SimdStore(y0r + q, SimdAdd(ar, br));
+				SimdStore(y0i + q, SimdAdd(ai, bi));
+				SimdStore(y1r + q, SimdMulSub(dr, vw1r, SimdMul(di, vw1i)));
+				SimdStore(y1i + q, SimdMulAdd(dr, vw1i, SimdMul(di, vw1r)));
+			}
+		}
+
+		for (; q < s; ++q)
+		{
+			const float dr = a0r[q] - a1r[q];
+			const float di = a0i[q] - a1i[q];
+			y0r[q] = a0r[q] + a1r[q];
+			y0i[q] = a0i[q] + a1i[q];
+			y1r[q] = dr * w1r - di * w1i;
+			y1i[q] = dr * w1i + di * w1r;
+		}
+	}
+}
+
+static void Radix3Pass(size_t m, size_t s, double sign, const float* twRe, const float* twIm,
+	const float* xr, const float* xi, float* yr, float* yi)
+{
+	const float c = -0.5f;
+	const float sn = static_cast<float>(sign) * kSin2Pi3;
+
+	for (size_t p = 0; p < m; ++p)
+	{
+		const float w1r = twRe[2 * p + 0];
+		const float w1i = twIm[2 * p + 0];
+		const float w2r = twRe[2 * p + 1];
+		const float w2i = twIm[2 * p + 1];
+
+		for (size_t q = 0; q < s; ++q)
+		{
+			const float a0r = xr[q + s * p];
+			const float a0i = xi[q + s * p];
+			const float a1r = xr[q + s * (p + m)];
+			const float a1i = xi[q + s * (p + m)];
+			const float a2r = xr[q + s * (p + 2 * m)];
+			const float a2i = xi[q + s * (p + 2 * m)];
+
+			const float tr = a1r + a2r;
+			const float ti = a1i + a2i;
+			const float mr = a0r + c * tr;
+			const float mi = a0i + c * ti;
+			// i * sn * (a1 - a2)
+			const float ur = -sn * (a1i - a2i);
+			const float ui = sn * (a1r - a2r);
+
+			const float b1r = mr + ur;
+			const float b1i = mi + ui;
+			const float b2r = mr - ur;
+			const float b2i = mi - ui;
+
+			float* y = yr + q + s * (3 * p);
+			float* yI = yi + q + s * (3 * p);
+			y[0] = a0r + tr;
+			yI[0] = a0i + ti;
+			y[s] = b1r * w1r - b1i * w1i;
+			yI[s] = b1r * w1i + b1i * w1r;
+			y[2 * s] = b2r * w2r - b2i * w2i;
+			yI[2 * s] = b2r * w2i + b2i * w2r;
+		}
+	}
+}
+
+static void Radix4Pass(size_t m, size_t s, double sign, const float* twRe, const float* twIm,
+	const float* xr, const float* xi, float* yr, float* yi)
+{
+	// multiplying by -i (forward) or +i (inverse) is a swap and a negation
+	const float sg = static_cast<float>(sign);
+
+	for (size_t p = 0; p < m; ++p)
+	{
+		const float w1r = twRe[3 * p + 0];
+		const float w1i = twIm[3 * p + 0];
+		const float w2r = twRe[3 * p + 1];
+		const float w2i = twIm[3 * p + 1];
+		const float w3r = twRe[3 * p + 2];
+		const float w3i = twIm[3 * p + 2];
+
+		size_t q = 0;
+		if (s >= SimdFloat::Width)
+		{
+			const SimdFloat vsg = SimdSet(sg);
+			const SimdFloat vw1r = SimdSet(w1r);
+			const SimdFloat vw1i = SimdSet(w1i);
+			const SimdFloat vw2r = SimdSet(w2r);
+			const SimdFloat vw2i = SimdSet(w2i);
+			const SimdFloat vw3r = SimdSet(w3r);
+			const SimdFloat vw3i = SimdSet(w3i);
+
+			for (; q + SimdFloat::Width <= s; q += SimdFloat::Width)
+			{
+				const SimdFloat a0r = SimdLoad(xr + q + s * p);
+				const SimdFloat a0i = SimdLoad(xi + q + s * p);
+				const SimdFloat a1r = SimdLoad(xr + q + s * (p + m));
+				const SimdFloat a1i = SimdLoad(xi + q + s * (p + m));
+				const SimdFloat a2r = SimdLoad(xr + q + s * (p + 2 * m));
+				const SimdFloat a2i = SimdLoad(xi + q + s * (p + 2 * m));
+				const SimdFloat a3r = SimdLoad(xr + q + s * (p + 3 * m));
+				const SimdFloat a3i = SimdLoad(xi + q + s * (p + 3 * m));
+
+				const SimdFloat t0r = SimdAdd(a0r, a2r);
+				const SimdFloat t0i = SimdAdd(a0i, a2i);
+				const SimdFloat t1r = SimdSub(a0r, a2r);
+				const SimdFloat t1i = SimdSub(a0i, a2i);
+				const SimdFloat t2r = SimdAdd(a1r, a3r);
+				const SimdFloat t2i = SimdAdd(a1i, a3i);
+				const SimdFloat t3r = SimdMul(vsg, SimdSub(a3i, a1i));
+				const SimdFloat t3i = SimdMul(vsg, SimdSub(a1r, a3r));
+
+				const SimdFloat b1r = SimdAdd(t1r, t3r);
+				const SimdFloat b1i = SimdAdd(t1i, t3i);
+				const SimdFloat b2r = SimdSub(t0r, t2r);
+				const SimdFloat b2i = SimdSub(t0i, t2i);
+				const SimdFloat b3r = SimdSub(t1r, t3r);
+				const SimdFloat b3i = SimdSub(t1i, t3i);
+
+				float* y = yr + q + s * (4 * p);
+				float* yI = yi + q + s * (4 * p);
+				SimdStore(y, SimdAdd(t0r, t2r));
+				SimdStore(yI, SimdAdd(t0i, t2i));
+				SimdStore(y + s, SimdMulSub(b1r, vw1r, SimdMul(b1i, vw1i)));
+				SimdStore(yI + s, SimdMulAdd(b1r, vw1i, SimdMul(b1i, vw1r)));
+				SimdStore(y + 2 * s, SimdMulSub(b2r, vw2r, SimdMul(b2i, vw2i)));
+				SimdStore(yI + 2 * s, SimdMulAdd(b2r, vw2i, SimdMul(b2i, vw2r)));
+				SimdStore(y + 3 * s, SimdMulSub(b3r, vw3r, SimdMul(b3i, vw3i)));
+				SimdStore(yI + 3 * s, SimdMulAdd(b3r, vw3i, SimdMul(b3i, vw3r)));
+			}
+		}
+
+		for (; q < s; ++q)
+		{
+			const float a0r = xr[q + s * p];
+			const float a0i = xi[q + s * p];
+			const float a1r = xr[q + s * (p + m)];
+			const float a1i = xi[q + s * (p + m)];
+			const float a2r = xr[q + s * (p + 2 * m)];
+			const float a2i = xi[q + s * (p + 2 * m)];
+			const float a3r = xr[q + s * (p + 3 * m)];
+			const float a3i = xi[q + s * (p + 3 * m)];
+
+			const float t0r = a0r + a2r;
+			const float t0i = a0i + a2i;
+			const float t1r = a0r - a2r;
+			const float t1i = a0i - a2i;
+			const float t2r = a1r + a3r;
+			const float t2i = a1i + a3i;
+			const float t3r = -sg * (a1i - a3i);
+			const float t3i = sg * (a1r - a3r);
+
+			const float b1r = t1r + t3r;
+			const float b1i = t1i + t3i;
+			const float b2r = t0r - t2r;
+			const float b2i = t0i - t2i;
+			const float b3r = t1r - t3r;
+			const float b3i = t1i - t3i;
+
+			float* y = yr + q + s * (4 * p);
+			float* yI = yi + q + s * (4 * p);
+			y[0] = t0r + t2r;
+			yI[0] = t0i + t2i;
+			y[s] = b1r * w1r - b1i * w1i;
+			yI[s] = b1r * w1i + b1i * w1r;
+			y[2 * s] = b2r * w2r - b2i * w2i;
+			yI[2 * s] = b2r * w2i + b2i * w2r;
+			y[3 * s] = b3r * w3r - b3i * w3i;
+			yI[3 * s] = b3r * w3i + b3i * w3r;
+		}
+	}
+}
+
+static void Radix5Pass(size_t m, size_t s, double sign, const float* twRe, const float* twIm,
+	const float* xr, const float* xi, float* yr, float* yi)
+{
+	const float c1 = kCos2Pi5;
+	const float c2 = kCos4Pi5;
+	const float s1 = static_cast<float>(sign) * kSin2Pi5;
+	const float s2 = static_cast<float>(sign) * kSin4Pi5;
+
+	for (size_t p = 0; p < m; ++p)
+	{
+		const float* wr = twRe + 4 * p;
+		const float* wi = twIm + 4 * p;
+
+		for (size_t q = 0; q < s; ++q)
+		{
+			const float a0r = xr[q + s * p];
+			const float a0i = xi[q + s * p];
+			const float a1r = xr[q + s * (p + m)];
+			const float a1i = xi[q + s * (p + m)];
+			const float a2r = xr[q + s * (p + 2 * m)];
+			const float a2i = xi[q + s * (p + 2 * m)];
+			const float a3r = xr[q + s * (p + 3 * m)];
+			const float a3i = xi[q + s * (p + 3 * m)];
+			const float a4r = xr[q + s * (p + 4 * m)];
+			const float a4i = xi[q + s * (p + 4 * m)];
+
+			const float t1r = a1r + a4r;
+			const float t1i = a1i + a4i;
+			const float t2r = a2r + a3r;
+			const float t2i = a2i + a3i;
+			const float d1r = a1r - a4r;
+			const float d1i = a1i - a4i;
+			const float d2r = a2r - a3r;
+			const float d2i = a2i - a3i;
+
+			const float m1r = a0r + c1 * t1r + c2 * t2r;
+			const float m1i = a0i + c1 * t1i + c2 * t2i;
+			const float m2r = a0r + c2 * t1r + c1 * t2r;
+			const float m2i = a0i + c2 * t1i + c1 * t2i;
+			// u = s1 * d1 + s2 * d2 and v = s2 * d1 - s1 * d2, both rotated by i
+			const float ur = -(s1 * d1i + s2 * d2i);
+			const float ui = s1 * d1r + s2 * d2r;
+			const float vr = -(s2 * d1i - s1 * d2i);
+			const float vi = s2 * d1r - s1 * d2r;
+
+			const float br[4] = { m1r + ur, m2r + vr, m2r - vr, m1r - ur };
+			const float bi[4] = { m1i + ui, m2i + vi, m2i - vi, m1i - ui };
+
+			float* y = yr + q + s * (5 * p);
+			float* yI = yi + q + s * (5 * p);
+			y[0] = a0r + t1r + t2r;
+			yI[0] = a0i + t1i + t2i;
+			for (size_t k = 0; k < 4; ++k)
+			{
+				y[(k + 1) * s] = br[k] * wr[k] - bi[k] * wi[k];
+				yI[(k + 1) * s] = br[k] * wi[k] + bi[k] * wr[k];
+			}
+		}
+	}
+}
+
+static void GenericPass(uint32_t radix, size_t m, size_t s, const float* rootRe, const float* rootIm,
+	const float* twRe, const float* twIm, const float* xr, const float* xi, float* yr, float* yi)
+{
+	float ar[kMaxGenericRadix];
+	float ai[kMaxGenericRadix];
+
+	for (size_t p = 0; p < m; ++p)
+	{
+		const float* wr = twRe + (radix - 1) * p;
+		const float* wi = twIm + (radix - 1) * p;
+
+		for (size_t q = 0; q < s; ++q)
+		{
+			for (uint32_t j = 0; j < radix; ++j)
+			{
+				ar[j] = xr[q + s * (p + j * m)];
+				ai[j] = xi[q + s * (p + j * m)];
+			}
+
+			for (uint32_t k = 0; k < radix; ++k)
+			{
+				float sumR = 0.0f;
+				float sumI = 0.0f;
+				uint32_t rootIndex = 0;
+				for (uint32_t j = 0; j < radix; ++j)
+				{
+					sumR += ar[j] * rootRe[rootIndex] - ai[j] * rootIm[rootIndex];
+					sumI += ar[j] * rootIm[rootIndex] + ai[j] * rootRe[rootIndex];
+					rootIndex += k;
+					if (rootIndex >= radix)
+					{
+						rootIndex -= radix;
+					}
+				}
+
+				float* y = yr + q + s * (radix * p + k);
+				float* yI = yi + q + s * (radix * p + k);
+				if (k == 0)
+				{
+					*y = sumR;
+					*yI = sumI;
+				}
+				else
+				{
+					*y = sumR * wr[k - 1] - sumI * wi[k - 1];
+					*yI = sumR * wi[k - 1] + sumI * wr[k - 1];
+				}
+			}
+		}
+	}
+}
+
+FFTPlan::FFTPlan(size_t size, FFTDirection direction)
+	: size(size), direction(direction)
+{
+	if (size == 0)
+	{
+		throw std::runtime_error("FFT size must be greater than zero");
+	}
+
+	std::vector<uint32_t> factors = Factorize(size);
+	if (!factors.empty() && *std::max_element(factors.begin(), factors.end()) > kMaxGenericRadix)
+	{
+		CreateBluestein();
+	}
+	else
+	{
+		CreateStockhamPasses();
+	}
+}
+
+FFTPlan::~FFTPlan()
+{
+}
+
+void FFTPlan::CreateStockhamPasses()
+{
+	const double sign = DirectionSign(direction);
+
+	size_t length = size;
+	size_t stride = 1;
+	for (uint32_t radix : Factorize(size))
+	{
+		Pass pass;
+		pass.radix = radix;
+		pass.length = length;
+		pass.stride = stride;
+		pass.twiddleOffset = twiddleRe.size();
+		pass.rootOffset = rootRe.size();
+
+		const size_t m = length / radix;
+		for (size_t p = 0; p < m; ++p)
+		{
+			for (size_t k = 1; k < radix; ++k)
+			{
+				float c, sn;
+				UnitRoot(sign, p * k, length, c, sn);
+				twiddleRe.push_back(c);
+				twiddleIm.push_back(sn);
+			}
+		}
+
+		// roots of unity for the generic pass; the batched passes also use them for radix 3 and 5
+		if (radix != 2 && radix != 4)
+		{
+			for (size_t j = 0; j < radix; ++j)
+			{
+				float c, sn;
+				UnitRoot(sign, j, radix, c, sn);
+				rootRe.push_back(c);
+				rootIm.push_back(sn);
+			}
+		}
+
+		passes.push_back(pass);
+		length = m;
+		stride *= radix;
+	}
+}
+
+void FFTPlan::CreateBluestein()
+{
+	convolutionSize = 1;
+	while (convolutionSize < 2 * size - 1)
+	{
+		convolutionSize <<= 1;
+	}
+
+	convolutionForward = &FFTPlanCache::GetPlan(convolutionSize, FFTDirection::Forward);
+	convolutionInverse = &FFTPlanCache::GetPlan(convolutionSize, FFTDirection::Inverse);
+
+	// chirp w_n = exp(sign * i * pi * n^2 / size), with n^2 reduced modulo 2 * size to keep the angle exact
+	const double sign = DirectionSign(direction);
+	chirpRe.resize(size);
+	chirpIm.resize(size);
+	for (size_t n = 0; n < size; ++n)
+	{
+		const uint64_t index = (static_cast<uint64_t>(n) * n) % (2 * static_cast<uint64_t>(size));
+		const double angle = sign * PI * static_cast<double>(index) / static_cast<double>(size);
+		chirpRe[n] = static_cast<float>(cos(angle));
+		chirpIm[n] = static_cast<float>(sin(angle));
+	}
+
+	// the convolution kernel is conj(w) laid out symmetrically around zero
+	chirpSpectrumRe.assign(convolutionSize, 0.0f);
+	chirpSpectrumIm.assign(convolutionSize, 0.0f);
+	chirpSpectrumRe[0] = chirpRe[0];
+	chirpSpectrumIm[0] = -chirpIm[0];
+	for (size_t n = 1; n < size; ++n)
+	{
+		chirpSpectrumRe[n] = chirpSpectrumRe[convolutionSize - n] = chirpRe[n];
+		chirpSpectrumIm[n] = chirpSpectrumIm[convolutionSize - n] = -chirpIm[n];
+	}
+
+	std::vector<float> workRe(convolutionForward->GetWorkSize());
+	std::vector<float> workIm(convolutionForward->GetWorkSize());
+	convolutionForward->Execute(chirpSpectrumRe.data(), chirpSpectrumIm.data(), workRe.data(), workIm.data());
+}
+
+size_t FFTPlan::GetSize() const
+{
+	return size;
+}
+
+size_t FFTPlan::GetWorkSize() const
+{
+	return convolutionSize > 0 ? 2 * convolutionSize : size;
+}
+
+FFTDirection FFTPlan::GetDirection() const
+{
+	return direction;
+}
+
+void FFTPlan::Execute(float* re, float* im, float* workRe, float* workIm) const
+{
+	if (convolutionSize > 0)
+	{
+		ExecuteBluestein(re, im, workRe, workIm);
+	}
+	else
+	{
+		ExecuteStockham(re, im, workRe, workIm);
+	}
+}
+
+void FFTPlan::Execute(float* re, float* im) const
+{
+	FFTScratch& scratch = GetThreadScratch(0, GetWorkSize());
+	Execute(re, im, scratch.workRe.data(), scratch.workIm.data());
+}
+
+void FFTPlan::Execute(ComplexBuffer& data) const
+{
+	if (data.GetSize() != size)
+	{
+		throw std::runtime_error("FFT input does not match the plan size");
+	}
+
+	Execute(data.GetRe(), data.GetIm());
+}
+
+void FFTPlan::Execute(std::vector<ComplexNumber>& data) const
+{
+	if (data.size() != size)
+	{
+		throw std::runtime_error("FFT input does not match the plan size");
+	}
+
+	FFTScratch& scratch = GetThreadScratch(size, GetWorkSize());
+	for (size_t i = 0; i < size; ++i)
+	{
+		scratch.re[i] = data[i].re;
+		scratch.im[i] = data[i].im;
+	}
+
+	Execute(scratch.re.data(), scratch.im.data(), scratch.workRe.data(), scratch.workIm.data());
+
+	for (size_t i = 0; i < size; ++i)
+	{
+		data[i].re = scratch.re[i];
+		data[i].im = scratch.im[i];
+	}
+}
+
+void FFTPlan::ExecuteStockham(float* re, float* im, float* workRe, float* workIm) const
+{
+	const double sign = DirectionSign(direction);
+
+	const float* xr = re;
+	const float* xi = im;
+	float* yr = workRe;
+	float* yi = workIm;
+
+	for (const Pass& pass : passes)
+	{
+		const size_t m = pass.length / pass.radix;
+		const float* twRe = twiddleRe.data() + pass.twiddleOffset;
+		const float* twIm = twiddleIm.data() + pass.twiddleOffset;
+
+		switch (pass.radix)
+		{
+		case 2:
+			Radix2Pass(m, pass.stride, twRe, twIm, xr, xi, yr, yi);
+			break;
+		case 3:
+			Radix3Pass(m, pass.stride, sign, twRe, twIm, xr, xi, yr, yi);
+			break;
+		case 4:
+			Radix4Pass(m, pass.stride, sign, twRe, twIm, xr, xi, yr, yi);
+			break;
+		case 5:
+			Radix5Pass(m, pass.stride, sign, twRe, twIm, xr, xi, yr, yi);
+			break;
+		default:
+			GenericPass(pass.radix, m, pass.stride, rootRe.data() + pass.rootOffset, rootIm.data() + pass.rootOffset,
+				twRe, twIm, xr, xi, yr, yi);
+			break;
+		}
+
+		// ping-pong between the data and the work buffers
+		float* nextYr = const_cast<float*>(xr);
+		float* nextYi = const_cast<float*>(xi);
+		xr = yr;
+		xi = yi;
+		yr = nextYr;
+		yi = nextYi;
+	}
+
+	if (xr != re)
+	{
+		memcpy(re, xr, size * sizeof(float));
+		memcpy(im, xi, size * sizeof(float));
+	}
+
+	if (direction == FFTDirection::Inverse)
+	{
+		const float scale = 1.0f / static_cast<float>(size);
+		for (size_t i = 0; i < size; ++i)
+		{
+			re[i] *= scale;
+			im[i] *= scale;
+		}
+	}
+}
+
+void FFTPlan::ExecuteBluestein(float* re, float* im, float* workRe, float* workIm) const
+{
+	float* aRe = workRe;
+	float* aIm = workIm;
+	float* innerWorkRe = workRe + convolutionSize;
+	float* innerWorkIm = workIm + convolutionSize;
+
+	ComplexMultiply(re, im, chirpRe.data(), chirpIm.data(), aRe, aIm, size);
+	std::fill(aRe + size, aRe + convolutionSize, 0.0f);
+	std::fill(aIm + size, aIm + convolutionSize, 0.0f);
+
+	convolutionForward->Execute(aRe, aIm, innerWorkRe, innerWorkIm);
+	ComplexMultiply(aRe, aIm, chirpSpectrumRe.data(), chirpSpectrumIm.data(), aRe, aIm, convolutionSize);
+	convolutionInverse->Execute(aRe, aIm, innerWorkRe, innerWorkIm);
+
+	ComplexMultiply(aRe, aIm, chirpRe.data(), chirpIm.data(), re, im, size);
+	if (direction == FFTDirection::Inverse)
+	{
+		const float scale = 1.0f / static_cast<float>(size);
+		for (size_t k = 0; k < size; ++k)
+		{
+			re[k] *= scale;
+			im[k] *= scale;
+		}
+	}
+}
+
+std::vector<ComplexNumber> FFT(const std::vector<ComplexNumber>& x, FFTDirection direction)
+{
+	std::vector<ComplexNumber> result = x;
+	if (!x.empty())
+	{
+		FFTPlanCache::GetPlan(x.size(), direction).Execute(result);
+	}
+	return result;
+}
+
+RealFFTPlan::RealFFTPlan(size_t size, FFTDirection direction)
+	: size(size), direction(direction), halfPlan(size / 2 > 0 ? size / 2 : 1, direction)
+{
+	if (size < 2 || size % 2 != 0)
+	{
+		throw std::runtime_error("real FFT size must be even");
+	}
+
+	const size_t quarter = size / 4;
+	twiddleRe.resize(quarter + 1);
+	twiddleIm.resize(quarter + 1);
+	for (size_t k = 0; k <= quarter; ++k)
+	{
+		UnitRoot(-1.0, k, size, twiddleRe[k], twiddleIm[k]);
+	}
+}
+
+size_t RealFFTPlan::GetSize() const
+{
+	return size;
+}
+
+size_t RealFFTPlan::GetSpectrumSize() const
+{
+	return size / 2 + 1;
+}
+
+FFTDirection RealFFTPlan::GetDirection() const
+{
+	return direction;
+}
+
+void RealFFTPlan::Execute(const float* samples, ComplexBuffer& spectrum) const
+{
+	spectrum.Resize(GetSpectrumSize());
+	ExecuteForward(samples, spectrum.GetRe(), spectrum.GetIm());
+}
+
+void RealFFTPlan::Execute(const ComplexBuffer& spectrum, float* samples) const
+{
+	if (spectrum.GetSize() != GetSpectrumSize())
+	{
+		throw std::runtime_error("real FFT spectrum does not match the plan size");
+	}
+
+	ExecuteInverse(spectrum.GetRe(), spectrum.GetIm(), samples);
+}
+
+void RealFFTPlan::ExecuteForward(const float* samples, float* re, float* im) const
+{
+	if (direction != FFTDirection::Forward)
+	{
+		throw std::runtime_error("real FFT plan was created for the inverse direction");
+	}
+
+	const size_t half = size / 2;
+
+	// z[n] = x[2n] + i * x[2n + 1], written straight into the output so the half-size FFT runs in place
+	for (size_t n = 0; n < half; ++n)
+	{
+		re[n] = samples[2 * n];
+		im[n] = samples[2 * n + 1];
+	}
+
+	FFTScratch& scratch = GetThreadScratch(0, halfPlan.GetWorkSize());
+	halfPlan.Execute(re, im, scratch.workRe.data(), scratch.workIm.data());
+
+	// Split Z into the spectra of the even samples E and odd samples O, then X[k] = E[k] + W^k * O[k].
+	// Bins k and half - k are computed together since each needs the other's Z.
+	const float z0r = re[0];
+	const float z0i = im[0];
+	re[0] = z0r + z0i;
+	im[0] = 0.0f;
+	re[half] = z0r - z0i;
+	im[half] = 0.0f;
+
+	for (size_t k = 1; k <= half / 2; ++k)
+	{
+		const size_t mirror = half - k;
+		const float ar = re[k];
+		const float ai = im[k];
+		const float br = re[mirror];
+		const float bi = im[mirror];
+
+		const float evenRe = 0.5f * (ar + br);
+		const float evenIm = 0.5f * (ai - bi);
+		const float oddRe = 0.5f * (ai + bi);
+		const float oddIm = -0.5f * (ar - br);
+
+		const float wr = twiddleRe[k];
+		const float wi = twiddleIm[k];
+		const float tr = wr * oddRe - wi * oddIm;
+		const float ti = wr * oddIm + wi * oddRe;
+
+		re[k] = evenRe + tr;
+		im[k] = evenIm + ti;
+		re[mirror] = evenRe - tr;
+		im[mirror] = ti - evenIm;
+	}
+}
+
+void RealFFTPlan::ExecuteInverse(const float* re, const float* im, float* samples) const
+{
+	if (direction != FFTDirection::Inverse)
+	{
+		throw std::runtime_error("real FFT plan was created for the forward direction");
+	}
+
+	const size_t half = size / 2;
+
+	FFTScratch& scratch = GetThreadScratch(half, halfPlan.GetWorkSize());
+	float* zr = scratch.re.data();
+	float* zi = scratch.im.data();
+
+	// Rebuild Z[k] = E[k] + i * O[k] from X[k] and conj(X[half - k]), undoing the forward split
+	zr[0] = 0.5f * (re[0] + re[half]);
+	zi[0] = 0.5f * (re[0] - re[half]);
+
+	for (size_t k = 1; k <= half / 2; ++k)
+	{
+		const size_t mirror = half - k;
+		const float ar = re[k];
+		const float ai = im[k];
+		const float br = re[mirror];
+		const float bi = im[mirror];
+
+		const float evenRe = 0.5f * (ar + br);
+		const float evenIm = 0.5f * (ai - bi);
+		const float dr = 0.5f * (ar - br);
+		const float di = 0.5f * (ai + bi);
+
+		// O = D * conj(W^k)
+		const float wr = twiddleRe[k];
+		const float wi = twiddleIm[k];
+		const float oddRe = dr * wr + di * wi;
+		const float oddIm = di * wr - dr * wi;
+
+		zr[k] = evenRe - oddIm;
+		zi[k] = evenIm + oddRe;
+		zr[mirror] = evenRe + oddIm;
+		zi[mirror] = oddRe - evenIm;
+	}
+
+	halfPlan.Execute(zr, zi, scratch.workRe.data(), scratch.workIm.data());
+
+	for (size_t n = 0; n < half; ++n)
+	{
+		samples[2 * n] = zr[n];
+		samples[2 * n + 1] = zi[n];
+	}
+}
+
+ComplexBuffer RealFFT(const std::vector<float>& x)
+{
+	ComplexBuffer spectrum;
+	if (x.size() >= 2 && x.size() % 2 == 0)
+	{
+		FFTPlanCache::GetRealPlan(x.size(), FFTDirection::Forward).Execute(x.data(), spectrum);
+	}
+	else if (!x.empty())
+	{
+		ComplexBuffer full(x.size());
+		std::copy(x.begin(), x.end(), full.GetRe());
+		FFTPlanCache::GetPlan(x.size(), FFTDirection::Forward).Execute(full);
+
+		spectrum.Resize(x.size() / 2 + 1);
+		std::copy(full.GetRe(), full.GetRe() + spectrum.GetSize(), spectrum.GetRe());
+		std::copy(full.GetIm(), full.GetIm() + spectrum.GetSize(), spectrum.GetIm());
+	}
+	return spectrum;
+}
+
+std::vector<float> InverseRealFFT(const ComplexBuffer& spectrum, size_t size)
+{
+	std::vector<float> samples(size);
+	if (size >= 2 && size % 2 == 0)
+	{
+		FFTPlanCache::GetRealPlan(size, FFTDirection::Inverse).Execute(spectrum, samples.data());
+	}
+	else if (size > 0)
+	{
+		// rebuild the full Hermitian spectrum for odd sizes
+		ComplexBuffer full(size);
+		for (size_t k = 0; k < size; ++k)
+		{
+			full.Set(k, k < spectrum.GetSize() ? spectrum.Get(k) : spectrum.Get(size - k).Conjugate());
+		}
+		FFTPlanCache::GetPlan(size, FFTDirection::Inverse).Execute(full);
+		std::copy(full.GetRe(), full.GetRe() + size, samples.begin());
+	}
+	return samples;
+}
+
+struct FFTPlanKey
+{
+	size_t size;
+	FFTDirection direction;
+	bool bReal;
+
+	bool operator==(const FFTPlanKey& other) const
+	{
+		return size == other.size && direction == other.direction && bReal == other.bReal;
+	}
+};
+
+struct FFTPlanKeyHash
+{
+	size_t operator()(const FFTPlanKey& key) const
+	{
+		return std::hash<size_t>()(key.size * 4 + static_cast<size_t>(key.direction) * 2 + (key.bReal ? 1 : 0));
+	}
+};
+
+struct FFTPlanCacheEntry
+{
+	std::unique_ptr<FFTPlan> complexPlan;
+	std::unique_ptr<RealFFTPlan> realPlan;
+};
+
+static std::shared_mutex planCacheMutex;
+static std::unordered_map<FFTPlanKey, FFTPlanCacheEntry, FFTPlanKeyHash> planCache;
+
+template <typename Plan>
+static const Plan& GetCachedPlan(const FFTPlanKey& key, std::unique_ptr<Plan> FFTPlanCacheEntry::* member)
+{
+	{
+		std::shared_lock<std::shared_mutex> lock(planCacheMutex);
+		auto it = planCache.find(key);
+		if (it != planCache.end())
+		{
+			return *(it->second.*member);
+		}
+	}
+
+	// build outside the lock: Bluestein plans look up their own power-of-two plans while constructing
+	std::unique_ptr<Plan> plan = std::make_unique<Plan>(key.size, key.direction);
+
+	std::unique_lock<std::shared_mutex> lock(planCacheMutex);
+	FFTPlanCacheEntry& entry = planCache[key];
+	if (!(entry.*member))
+	{
+		entry.*member = std::move(plan);
+	}
+	return *(entry.*member);
+}
+
+const FFTPlan& FFTPlanCache::GetPlan(size_t size, FFTDirection direction)
+{
+	return GetCachedPlan<FFTPlan>({ size, direction, false }, &FFTPlanCacheEntry::complexPlan);
+}
+
+const RealFFTPlan& FFTPlanCache::GetRealPlan(size_t size, FFTDirection direction)
+{
+	return GetCachedPlan<RealFFTPlan>({ size, direction, true }, &FFTPlanCacheEntry::realPlan);
+}
+
+static constexpr size_t kLanes = SimdFloat::Width;
+// Up to this size the per-call overhead and FFTPlan's scalar early passes dominate, so interleaving
+// wins at any lane count (measured against FFTPlan once per transform over the same batch)
+static constexpr size_t kMaxInterleavedSize = 16 * kLanes;
+
+FFTBatchPlan::FFTBatchPlan(size_t size, FFTDirection direction)
+	: plan(FFTPlanCache::GetPlan(size, direction))
+{
+	// FFTPlan vectorizes only radix-2 and radix-4 passes, and only once the stride spans a vector
+	size_t scalarPasses = 0;
+	bool bGenericPass = false;
+	for (const FFTPlan::Pass& pass : plan.passes)
+	{
+		scalarPasses += (pass.radix != 2 && pass.radix != 4) || pass.stride < kLanes ? 1 : 0;
+		bGenericPass = bGenericPass || pass.radix > 5;
+	}
+
+	// Generic passes are scalar O(radix) per point in FFTPlan, so those sizes always interleave. The
+	// interleaved radix-3 and radix-5 passes run the generic kernel too, which only pays off over
+	// FFTPlan's dedicated scalar ones with 8 lanes, and then only once most passes would be scalar.
+	// Bluestein sizes have no Stockham passes to vectorize across, and a scalar build has no lanes.
+	const bool bMostlyScalar = kLanes >= 8 && 2 * scalarPasses > plan.passes.size();
+	bInterleave = kLanes > 1 && plan.convolutionSize == 0 && (size <= kMaxInterleavedSize || bGenericPass || bMostlyScalar);
+}
+
+size_t FFTBatchPlan::GetSize() const
+{
+	return plan.GetSize();
+}
+
+FFTDirection FFTBatchPlan::GetDirection() const
+{
+	return plan.GetDirection();
+}
+
+/* Batched passes
+* Same Stockham passes as FFTPlan, except every element is a SimdFloat holding that element of
+* SimdFloat::Width different transforms, so element e of the group lives at offset e * Width.
+*/
+
+static void BatchRadix2Pass(size_t m, size_t s, const float* twRe, const float* twIm,
+	const float* xr, const float* xi, float* yr, float* yi)
+{
+	for (size_t p = 0; p < m; ++p)
+	{
+		const SimdFloat wr = SimdSet(twRe[p]);
+		const SimdFloat wi = SimdSet(twIm[p]);
+
+		for (size_t q = 0; q < s; ++q)
+		{
+			const size_t in0 = (q + s * p) * kLanes;
+			const size_t in1 = (q + s * (p + m)) * kLanes;
+			const size_t out0 = (q + s * (2 * p)) * kLanes;
+			const size_t out1 = out0 + s * kLanes;
+
+			const SimdFloat ar = SimdLoad(xr + in0);
+			const SimdFloat ai = SimdLoad(xi + in0);
+			const SimdFloat br = SimdLoad(xr + in1);
+			const SimdFloat bi = SimdLoad(xi + in1);
+			const SimdFloat dr = SimdSub(ar, br);
+			const SimdFloat di = SimdSub(ai, bi);
+
+			SimdStore(yr + out0, SimdAdd(ar, br));
+			SimdStore(yi + out0, SimdAdd(ai, bi));
+			SimdStore(yr + out1, SimdMulSub(dr, wr, SimdMul(di, wi)));
+			SimdStore(yi + out1, SimdMulAdd(dr, wi, SimdMul(di, wr)));
+		}
+	}
+}
+
+static void BatchRadix4Pass(size_t m, size_t s, double sign, const float* twRe, const float* twIm,
+	const float* xr, const float* xi, float* yr, float* yi)
+{
+	const SimdFloat sg = SimdSet(static_cast<float>(sign));
+
+	for (size_t p = 0; p < m; ++p)
+	{
+		SimdFloat wr[3];
+		SimdFloat wi[3];
+		for (size_t k = 0; k < 3; ++k)
+		{
+			wr[k] = SimdSet(twRe[3 * p + k]);
+			wi[k] = SimdSet(twIm[3 * p + k]);
+		}
+
+		for (size_t q = 0; q < s; ++q)
+		{
+			SimdFloat ar[4];
+			SimdFloat ai[4];
+			for (size_t j = 0; j < 4; ++j)
+			{
+				ar[j] = SimdLoad(xr + (q + s * (p + j * m)) * kLanes);
+				ai[j] = SimdLoad(xi + (q + s * (p + j * m)) * kLanes);
+			}
+
+			const SimdFloat t0r = SimdAdd(ar[0], ar[2]);
+			const SimdFloat t0i = SimdAdd(ai[0], ai[2]);
+			const SimdFloat t1r = SimdSub(ar[0], ar[2]);
+			const SimdFloat t1i = SimdSub(ai[0], ai[2]);
+			const SimdFloat t2r = SimdAdd(ar[1], ar[3]);
+			const SimdFloat t2i = SimdAdd(ai[1], ai[3]);
+			const SimdFloat t3r = SimdMul(sg, SimdSub(ai[3], ai[1]));
+			const SimdFloat t3i = SimdMul(sg, SimdSub(ar[1], ar[3]));
+
+			const SimdFloat br[3] = { SimdAdd(t1r, t3r), SimdSub(t0r, t2r), SimdSub(t1r, t3r) };
+			const SimdFloat bi[3] = { SimdAdd(t1i, t3i), SimdSub(t0i, t2i), SimdSub(t1i, t3i) };
+
+			const size_t out = (q + s * (4 * p)) * kLanes;
+			SimdStore(yr + out, SimdAdd(t0r, t2r));
+			SimdStore(yi + out, SimdAdd(t0i, t2i));
+			for (size_t k = 0; k < 3; ++k)
+			{
+				const size_t offset = out + (k + 1) * s * kLanes;
+				SimdStore(yr + offset, SimdMulSub(br[k], wr[k], SimdMul(bi[k], wi[k])));
+				SimdStore(yi + offset, SimdMulAdd(br[k], wi[k], SimdMul(bi[k], wr[k])));
+			}
+		}
+	}
+}
+
+static void BatchGenericPass(uint32_t radix, size_t m, size_t s, const float* rootRe, const float* rootIm,
+	const float* twRe, const float* twIm, const float* xr, const float* xi, float* yr, float* yi)
+{
+	SimdFloat ar[kMaxGenericRadix];
+	SimdFloat ai[kMaxGenericRadix];
+
+	for (size_t p = 0; p < m; ++p)
+	{
+		for (size_t q = 0; q < s; ++q)
+		{
+			for (uint32_t j = 0; j < radix; ++j)
+			{
+				ar[j] = SimdLoad(xr + (q + s * (p + j * m)) * kLanes);
+				ai[j] = SimdLoad(xi + (q + s * (p + j * m)) * kLanes);
+			}
+
+			for (uint32_t k = 0; k < radix; ++k)
+			{
+				SimdFloat sumR = ar[0];
+				SimdFloat sumI = ai[0];
+				uint32_t rootIndex = k;
+				for (uint32_t j = 1; j < radix; ++j)
+				{
+					const SimdFloat cr = SimdSet(rootRe[rootIndex]);
+					const SimdFloat ci = SimdSet(rootIm[rootIndex]);
+					sumR = SimdAdd(sumR, SimdMulSub(ar[j], cr, SimdMul(ai[j], ci)));
+					sumI = SimdAdd(sumI, SimdMulAdd(ar[j], ci, SimdMul(ai[j], cr)));
+					rootIndex += k;
+					if (rootIndex >= radix)
+					{
+						rootIndex -= radix;
+					}
+				}
+
+				const size_t out = (q + s * (radix * p + k)) * kLanes;
+				if (k == 0)
+				{
+					SimdStore(yr + out, sumR);
+					SimdStore(yi + out, sumI);
+				}
+				else
+				{
+					const SimdFloat wr = SimdSet(twRe[(radix - 1) * p + k - 1]);
+					const SimdFloat wi = SimdSet(twIm[(radix - 1) * p + k - 1]);
+					SimdStore(yr + out, SimdMulSub(sumR, wr, SimdMul(sumI, wi)));
+					SimdStore(yi + out, SimdMulAdd(sumR, wi, SimdMul(sumI, wr)));
+				}
+			}
+		}
+	}
+}
+
+// src holds Width transforms of size floats back to back; dst gets element j of lane l at j * Width + l
+static void InterleaveLanes(const float* src, size_t size, float* dst)
+{
+	SimdFloat block[kLanes];
+	for (size_t j = 0; j < size; j += kLanes)
+	{
+		for (size_t lane = 0; lane < kLanes; ++lane)
+		{
+			block[lane] = SimdLoad(src + lane * size + j);
+		}
+		SimdTranspose(block);
+		for (size_t i = 0; i < kLanes; ++i)
+		{
+			SimdStore(dst + (j + i) * kLanes, block[i]);
+		}
+	}
+}
+
+static void DeinterleaveLanes(const float* src, size_t size, float scale, float* dst)
+{
+	const SimdFloat vscale = SimdSet(scale);
+	SimdFloat block[kLanes];
+	for (size_t j = 0; j < size; j += kLanes)
+	{
+		for (size_t i = 0; i < kLanes; ++i)
+		{
+			block[i] = SimdMul(SimdLoad(src + (j + i) * kLanes), vscale);
+		}
+		SimdTranspose(block);
+		for (size_t lane = 0; lane < kLanes; ++lane)
+		{
+			SimdStore(dst + lane * size + j, block[lane]);
+		}
+	}
+}
+
+void FFTBatchPlan::ExecuteGroup(float* re, float* im, size_t laneCount) const
+{
+	const size_t size = plan.GetSize();
+	const double sign = DirectionSign(plan.GetDirection());
+
+	// two lane-interleaved buffers to ping-pong between
+	FFTScratch& scratch = GetThreadScratch(size * kLanes, size * kLanes);
+	float* xr = scratch.re.data();
+	float* xi = scratch.im.data();
+	float* yr = scratch.workRe.data();
+	float* yi = scratch.workIm.data();
+
+	// full groups of a lane-multiple size are interleaved Width x Width blocks at a time in registers
+	const bool bBlockTranspose = laneCount == kLanes && size % kLanes == 0;
+	if (bBlockTranspose)
+	{
+		InterleaveLanes(re, size, xr);
+		InterleaveLanes(im, size, xi);
+	}
+	else
+	{
+		// padding lanes of a partial group transform zeros and are never written back
+		std::fill(xr, xr + size * kLanes, 0.0f);
+		std::fill(xi, xi + size * kLanes, 0.0f);
+		for (size_t j = 0; j < size; ++j)
+		{
+			for (size_t lane = 0; lane < laneCount; ++lane)
+			{
+				xr[j * kLanes + lane] = re[lane * size + j];
+				xi[j * kLanes + lane] = im[lane * size + j];
+			}
+		}
+	}
+
+	for (const FFTPlan::Pass& pass : plan.passes)
+	{
+		const size_t m = pass.length / pass.radix;
+		const float* twRe = plan.twiddleRe.data() + pass.twiddleOffset;
+		const float* twIm = plan.twiddleIm.data() + pass.twiddleOffset;
+
+		switch (pass.radix)
+		{
+		case 2:
+			BatchRadix2Pass(m, pass.stride, twRe, twIm, xr, xi, yr, yi);
+			break;
+		case 4:
+			BatchRadix4Pass(m, pass.stride, sign, twRe, twIm, xr, xi, yr, yi);
+			break;
+		default:
+			BatchGenericPass(pass.radix, m, pass.stride, plan.rootRe.data() + pass.rootOffset, plan.rootIm.data() + pass.rootOffset,
+				twRe, twIm, xr, xi, yr, yi);
+			break;
+		}
+
+		std::swap(xr, yr);
+		std::swap(xi, yi);
+	}
+
+	const float scale = plan.GetDirection() == FFTDirection::Inverse ? 1.0f / static_cast<float>(size) : 1.0f;
+	if (bBlockTranspose)
+	{
+		DeinterleaveLanes(xr, size, scale, re);
+		DeinterleaveLanes(xi, size, scale, im);
+	}
+	else
+	{
+		for (size_t j = 0; j < size; ++j)
+		{
+			for (size_t lane = 0; lane < laneCount; ++lane)
+			{
+				re[lane * size + j] = xr[j * kLanes + lane] * scale;
+				im[lane * size + j] = xi[j * kLanes + lane] * scale;
+			}
+		}
+	}
+}
+
+void FFTBatchPlan::Execute(float* re, float* im, size_t batchCount, ThreadPool* threadPool) const
+{
+	const size_t size = plan.GetSize();
+
+	auto executeRange = [this, re, im, size, batchCount](size_t groupBegin, size_t groupEnd)
+	{
+		for (size_t group = groupBegin; group < groupEnd; ++group)
+		{
+			const size_t first = group * kLanes;
+			const size_t laneCount = std::min(kLanes, batchCount - first);
+			if (bInterleave)
+			{
+				ExecuteGroup(re + first * size, im + first * size, laneCount);
+			}
+			else
+			{
+				for (size_t lane = 0; lane < laneCount; ++lane)
+				{
+					plan.Execute(re + (first + lane) * size, im + (first + lane) * size);
+				}
+			}
+		}
+	};
+
+	const size_t groupCount = (batchCount + kLanes - 1) / kLanes;
+	// keep each task around 64K points so the dispatch cost stays small next to the math
+	const size_t groupsPerTask = std::max<size_t>(1, (1 << 16) / (size * kLanes));
+	ParallelFor(threadPool, groupCount, groupsPerTask, executeRange);
+}
+
+void FFTBatchPlan::Execute(ComplexBuffer& data, size_t batchCount, ThreadPool* threadPool) const
+{
+	if (data.GetSize() != batchCount * plan.GetSize())
+	{
+		throw std::runtime_error("FFT batch does not match the plan size");
+	}
+
+	Execute(data.GetRe(), data.GetIm(), batchCount, threadPool);
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include "ComplexBuffer.h"
+#include "MathLib.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+class ThreadPool;
+
+// A precomputed complex-to-complex transform of a fixed size.
+// The size is factored into radix-4 and radix-2 passes first, then radix-3, radix-5 and generic
+// odd-prime passes, and the passes run as a Stockham autosort so no bit-reversal step is needed.
+// Sizes with a prime factor too large for a generic pass go through Bluestein's algorithm instead,
+// so every size runs in O(n log n). Like DFT_Slow, the inverse transform is scaled by 1/n.
+class FFTPlan
+{
+public:
+	FFTPlan(size_t size, FFTDirection direction);
+	~FFTPlan();
+
+	FFTPlan(const FFTPlan&) = delete;
+	void operator=(const FFTPlan&) = delete;
+
+	// Transforms split-complex data in place. workRe and workIm must each hold GetWorkSize() floats.
+	void Execute(float* re, float* im, float* workRe, float* workIm) const;
+	// Same as above with per-thread work buffers, so concurrent calls on one plan are safe
+	void Execute(float* re, float* im) const;
+	void Execute(ComplexBuffer& data) const;
+	void Execute(std::vector<ComplexNumber>& data) const;
+
+	size_t GetSize() const;
+	size_t GetWorkSize() const;
+	FFTDirection GetDirection() const;
+private:
+	friend class FFTBatchPlan;
+
+	struct Pass
+	{
+		uint32_t radix;
+		size_t length;
+		size_t stride;
+		size_t twiddleOffset;
+		size_t rootOffset;
+	};
+
+	void CreateStockhamPasses();
+	void CreateBluestein();
+	void ExecuteStockham(float* re, float* im, float* workRe, float* workIm) const;
+	void ExecuteBluestein(float* re, float* im, float* workRe, float* workIm) const;
+private:
+	size_t size;
+	FFTDirection direction;
+
+	std::vector<Pass> passes;
+	std::vector<float> twiddleRe;
+	std::vector<float> twiddleIm;
+	std::vector<float> rootRe;
+	std::vector<float> rootIm;
+
+	// Bluestein state, only used when the size has a large prime factor
+	size_t convolutionSize = 0;
+	const FFTPlan* convolutionForward = nullptr;
+	const FFTPlan* convolutionInverse = nullptr;
+	std::vector<float> chirpRe;
+	std::vector<float> chirpIm;
+	std::vector<float> chirpSpectrumRe;
+	std::vector<float> chirpSpectrumIm;
+};
+
+// A transform of an even number of real samples, run as a complex FFT of half the size by packing
+// even samples into the real parts and odd samples into the imaginary parts. Forward produces the
+// size / 2 + 1 non-redundant bins; the rest of the spectrum is their conjugate mirror. Inverse takes
+// those bins back to real samples, scaled by 1/size like the complex inverse.
+class RealFFTPlan
+{
+public:
+	RealFFTPlan(size_t size, FFTDirection direction);
+
+	RealFFTPlan(const RealFFTPlan&) = delete;
+	void operator=(const RealFFTPlan&) = delete;
+
+	// Forward: GetSize() samples in, spectrum is resized to GetSpectrumSize()
+	void Execute(const float* samples, ComplexBuffer& spectrum) const;
+	// Inverse: GetSpectrumSize() bins in, GetSize() samples out
+	void Execute(const ComplexBuffer& spectrum, float* samples) const;
+	// The same on raw arrays, named by direction since both take three of them
+	void ExecuteForward(const float* samples, float* spectrumRe, float* spectrumIm) const;
+	void ExecuteInverse(const float* spectrumRe, const float* spectrumIm, float* samples) const;
+
+	size_t GetSize() const;
+	size_t GetSpectrumSize() const;
+	FFTDirection GetDirection() const;
+private:
+	size_t size;
+	FFTDirection direction;
+	FFTPlan halfPlan;
+	// forward twiddles exp(-2 pi i k / size) for k <= size / 4
+	std::vector<float> twiddleRe;
+	std::vector<float> twiddleIm;
+};
+
+// Thousands of independent transforms of one small size, such as per-tile spectra or filter banks.
+// Transforms are taken SimdFloat::Width at a time and interleaved so each vector lane holds a
+// different transform, then the Stockham passes run on whole vectors; this removes the per-call
+// overhead and the scalar early passes that dominate small transforms. Sizes where FFTPlan would
+// vectorize most of its own passes, and scalar builds, run FFTPlan once per transform instead, since
+// it is faster there. The batch can be split over a thread pool.
+class FFTBatchPlan
+{
+public:
+	FFTBatchPlan(size_t size, FFTDirection direction);
+
+	// batchCount transforms stored back to back, transform b at [b * GetSize(), (b + 1) * GetSize())
+	void Execute(float* re, float* im, size_t batchCount, ThreadPool* threadPool = nullptr) const;
+	void Execute(ComplexBuffer& data, size_t batchCount, ThreadPool* threadPool = nullptr) const;
+
+	size_t GetSize() const;
+	FFTDirection GetDirection() const;
+private:
+	void ExecuteGroup(float* re, float* im, size_t laneCount) const;
+private:
+	const FFTPlan& plan;
+	bool bInterleave;
+};
+
+// Process-wide plan cache keyed by (size, direction, real or complex). Plans are immutable once
+// built, so the returned references are shared across threads and stay valid until exit; repeat
+// transforms through a cached plan do no allocation and no trig.
+class FFTPlanCache
+{
+public:
+	static const FFTPlan& GetPlan(size_t size, FFTDirection direction);
+	static const RealFFTPlan& GetRealPlan(size_t size, FFTDirection direction);
+};
+
+// Convenience transforms through the plan cache
+std::vector<ComplexNumber> FFT(const std::vector<ComplexNumber>& x, FFTDirection direction = FFTDirection::Forward);
+
+// Half spectrum of real samples. Odd sizes fall back to a full complex transform.
+ComplexBuffer RealFFT(const std::vector<float>& x);
+std::vector<float> InverseRealFFT(const ComplexBuffer& spectrum, size_t size);
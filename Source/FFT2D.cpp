@@ -0,0 +1,169 @@
+#include "FFT2D.h"
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+// 32 x 32 floats is 4KB per tile, so a source and destination tile of both arrays stay in L1
+static constexpr size_t kTransposeTileSize = 32;
+
+// Transforms rowCount contiguous rows of plan.GetSize() values in place
+static void TransformRows(float* re, float* im, size_t rowCount, const FFTPlan& plan, ThreadPool* threadPool)
+{
+	const size_t rowLength = plan.GetSize();
+	ParallelFor(threadPool, rowCount, 1, [re, im, rowLength, &plan](size_t begin, size_t end)
+	{
+		for (size_t row = begin; row < end; ++row)
+		{
+			plan.Execute(re + row * rowLength, im + row * rowLength);
+		}
+	});
+}
+
+static void Transpose(const float* srcRe, const float* srcIm, float* dstRe, float* dstIm, size_t srcWidth, size_t srcHeight, ThreadPool* threadPool)
+{
+	// split on whole tile rows so no two threads write the same destination tile
+	const size_t tileRows = (srcHeight + kTransposeTileSize - 1) / kTransposeTileSize;
+	ParallelFor(threadPool, tileRows, 1, [=](size_t begin, size_t end)
+	{
+		const size_t rowBegin = begin * kTransposeTileSize;
+		const size_t rowEnd = std::min(end * kTransposeTileSize, srcHeight);
+		TransposeBlocked(srcRe, dstRe, srcWidth, srcHeight, rowBegin, rowEnd);
+		TransposeBlocked(srcIm, dstIm, srcWidth, srcHeight, rowBegin, rowEnd);
+	});
+}
+
+FFT2DPlan::FFT2DPlan(size_t width, size_t height, FFTDirection direction, ThreadPool* threadPool)
+	: width(width), height(height), direction(direction), threadPool(threadPool),
+	rowPlan(width, direction), columnPlan(height, direction), transposed(width * height)
+{
+}
+
+size_t FFT2DPlan::GetWidth() const
+{
+	return width;
+}
+
+size_t FFT2DPlan::GetHeight() const
+{
+	return height;
+}
+
+FFTDirection FFT2DPlan::GetDirection() const
+{
+	return direction;
+}
+
+void FFT2DPlan::Execute(ComplexBuffer& grid)
+{
+	if (grid.GetSize() != width * height)
+	{
+		throw std::runtime_error("FFT grid does not match the plan size");
+	}
+
+	/* Row Pass */
+	TransformRows(grid.GetRe(), grid.GetIm(), height, rowPlan, threadPool);
+
+	/* Column Pass, as rows of the transposed grid */
+	Transpose(grid.GetRe(), grid.GetIm(), transposed.GetRe(), transposed.GetIm(), width, height, threadPool);
+	TransformRows(transposed.GetRe(), transposed.GetIm(), width, columnPlan, threadPool);
+	Transpose(transposed.GetRe(), transposed.GetIm(), grid.GetRe(), grid.GetIm(), height, width, threadPool);
+}
+
+RealFFT2DPlan::RealFFT2DPlan(size_t width, size_t height, FFTDirection direction, ThreadPool* threadPool)
+	: width(width), height(height), direction(direction), threadPool(threadPool),
+	rowPlan(width, direction), columnPlan(height, direction), transposed((width / 2 + 1) * height)
+{
+	if (width < 2 || width % 2 != 0)
+	{
+		throw std::runtime_error("real 2D FFT width must be even");
+	}
+}
+
+size_t RealFFT2DPlan::GetWidth() const
+{
+	return width;
+}
+
+size_t RealFFT2DPlan::GetHeight() const
+{
+	return height;
+}
+
+size_t RealFFT2DPlan::GetSpectrumWidth() const
+{
+	return rowPlan.GetSpectrumSize();
+}
+
+FFTDirection RealFFT2DPlan::GetDirection() const
+{
+	return direction;
+}
+
+void RealFFT2DPlan::Execute(const float* samples, ComplexBuffer& spectrum)
+{
+	const size_t spectrumWidth = GetSpectrumWidth();
+	spectrum.Resize(spectrumWidth * height);
+	float* re = spectrum.GetRe();
+	float* im = spectrum.GetIm();
+
+	/* Row Pass */
+	ParallelFor(threadPool, height, 1, [=, this](size_t begin, size_t end)
+	{
+		for (size_t row = begin; row < end; ++row)
+		{
+			rowPlan.ExecuteForward(samples + row * width, re + row * spectrumWidth, im + row * spectrumWidth);
+		}
+	});
+
+	/* Column Pass, over the half spectrum only */
+	Transpose(re, im, transposed.GetRe(), transposed.GetIm(), spectrumWidth, height, threadPool);
+	TransformRows(transposed.GetRe(), transposed.GetIm(), spectrumWidth, columnPlan, threadPool);
+	Transpose(transposed.GetRe(), transposed.GetIm(), re, im, height, spectrumWidth, threadPool);
+}
+
+void RealFFT2DPlan::Execute(ComplexBuffer& spectrum, float* samples)
+{
+	const size_t spectrumWidth = GetSpectrumWidth();
+	if (spectrum.GetSize() != spectrumWidth * height)
+	{
+		throw std::runtime_error("real FFT grid does not match the plan size");
+	}
+	float* re = spectrum.GetRe();
+	float* im = spectrum.GetIm();
+
+	/* Column Pass */
+	Transpose(re, im, transposed.GetRe(), transposed.GetIm(), spectrumWidth, height, threadPool);
+	TransformRows(transposed.GetRe(), transposed.GetIm(), spectrumWidth, columnPlan, threadPool);
+	Transpose(transposed.GetRe(), transposed.GetIm(), re, im, height, spectrumWidth, threadPool);
+
+	/* Row Pass, back to real samples */
+	ParallelFor(threadPool, height, 1, [=, this](size_t begin, size_t end)
+	{
+		for (size_t row = begin; row < end; ++row)
+		{
+			rowPlan.ExecuteInverse(re + row * spectrumWidth, im + row * spectrumWidth, samples + row * width);
+		}
+	});
+}
+
+void TransposeBlocked(const float* src, float* dst, size_t srcWidth, size_t srcHeight, size_t rowBegin, size_t rowEnd)
+{
+	for (size_t tileY = rowBegin; tileY < rowEnd; tileY += kTransposeTileSize)
+	{
+		const size_t yEnd = std::min(tileY + kTransposeTileSize, rowEnd);
+		for (size_t tileX = 0; tileX < srcWidth; tileX += kTransposeTileSize)
+		{
+			const size_t xEnd = std::min(tileX + kTransposeTileSize, srcWidth);
+			for (size_t y = tileY; y < yEnd; ++y)
+			{
+				const float* srcRow = src + y * srcWidth;
+				for (size_t x = tileX; x < xEnd; ++x)
+				{
+					dst[x * srcHeight + y] = srcRow[x];
+				}
+			}
+		}
+	}
+}
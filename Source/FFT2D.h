@@ -0,0 +1,71 @@
+#pragma once
+
+#include "ComplexBuffer.h"
+#include "FFT.h"
+
+#include <stddef.h>
+
+class ThreadPool;
+
+// 2D complex transform of a row-major width x height grid. Rows are transformed in place, the grid
+// is transposed tile by tile so the columns become contiguous rows, those are transformed, and the
+// result is transposed back. Rows and tiles are spread over the thread pool when one is given.
+// The plan owns the transpose buffer, so one plan must not execute on two grids at the same time.
+class FFT2DPlan
+{
+public:
+	FFT2DPlan(size_t width, size_t height, FFTDirection direction, ThreadPool* threadPool = nullptr);
+
+	FFT2DPlan(const FFT2DPlan&) = delete;
+	void operator=(const FFT2DPlan&) = delete;
+
+	void Execute(ComplexBuffer& grid);
+
+	size_t GetWidth() const;
+	size_t GetHeight() const;
+	FFTDirection GetDirection() const;
+private:
+	size_t width;
+	size_t height;
+	FFTDirection direction;
+	ThreadPool* threadPool;
+
+	FFTPlan rowPlan;
+	FFTPlan columnPlan;
+	ComplexBuffer transposed;
+};
+
+// 2D transform of a real row-major width x height grid through its half spectrum. Rows go through
+// RealFFTPlan, which leaves width / 2 + 1 bins per row, and only those columns are transformed; the
+// rest of the spectrum is their conjugate mirror, so this is about half the work of FFT2DPlan on the
+// same grid. The width must be even. Scaling matches FFT2DPlan, and so does the buffer ownership.
+class RealFFT2DPlan
+{
+public:
+	RealFFT2DPlan(size_t width, size_t height, FFTDirection direction, ThreadPool* threadPool = nullptr);
+
+	RealFFT2DPlan(const RealFFT2DPlan&) = delete;
+	void operator=(const RealFFT2DPlan&) = delete;
+
+	// Forward: width x height samples in, spectrum is resized to GetSpectrumWidth() x height
+	void Execute(const float* samples, ComplexBuffer& spectrum);
+	// Inverse: the spectrum is used as scratch, width x height samples out
+	void Execute(ComplexBuffer& spectrum, float* samples);
+
+	size_t GetWidth() const;
+	size_t GetHeight() const;
+	size_t GetSpectrumWidth() const;
+	FFTDirection GetDirection() const;
+private:
+	size_t width;
+	size_t height;
+	FFTDirection direction;
+	ThreadPool* threadPool;
+
+	RealFFTPlan rowPlan;
+	FFTPlan columnPlan;
+	ComplexBuffer transposed;
+};
+
+// Cache-blocked out-of-place transpose of a row-major srcWidth x srcHeight float array
+void TransposeBlocked(const float* src, float* dst, size_t srcWidth, size_t srcHeight, size_t rowBegin, size_t rowEnd);
@@ -0,0 +1,178 @@
+#include "FFTBloom.h"
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+// the per-pixel work is light, so rows are handed out in groups
+static constexpr size_t kMinRowsPerTask = 16;
+
+// Smallest 2^a 3^b 5^c >= size, which the FFT runs with its fast radix passes and with less padding
+// than rounding up to a power of two
+static size_t NextFastSize(size_t size)
+{
+	for (size_t candidate = std::max<size_t>(size, 1); ; ++candidate)
+	{
+		size_t remainder = candidate;
+		for (size_t factor : { 2, 3, 5 })
+		{
+			while (remainder % factor == 0)
+			{
+				remainder /= factor;
+			}
+		}
+
+		if (remainder == 1)
+		{
+			return candidate;
+		}
+	}
+}
+
+FFTBloom::FFTBloom(size_t width, size_t height, const std::vector<float>& kernel, size_t kernelWidth, size_t kernelHeight, ThreadPool* threadPool)
+	: width(width), height(height),
+	// even, for the real transform, which then runs a complex FFT of the fast half size
+	paddedWidth(2 * NextFastSize((width + kernelWidth / 2 + 1) / 2)), paddedHeight(NextFastSize(height + kernelHeight / 2)),
+	threadPool(threadPool),
+	forwardPlan(paddedWidth, paddedHeight, FFTDirection::Forward, threadPool),
+	inversePlan(paddedWidth, paddedHeight, FFTDirection::Inverse, threadPool),
+	blueForwardPlan(paddedWidth, paddedHeight, FFTDirection::Forward, threadPool),
+	blueInversePlan(paddedWidth, paddedHeight, FFTDirection::Inverse, threadPool),
+	kernelSpectrum(paddedWidth * paddedHeight), redGreen(paddedWidth * paddedHeight), blue(paddedWidth * paddedHeight)
+{
+	if (kernel.size() != kernelWidth * kernelHeight || kernelWidth > paddedWidth || kernelHeight > paddedHeight)
+	{
+		throw std::runtime_error("bloom kernel does not match its size");
+	}
+
+	float kernelSum = 0.0f;
+	for (float weight : kernel)
+	{
+		kernelSum += weight;
+	}
+	const float normalization = kernelSum != 0.0f ? 1.0f / kernelSum : 1.0f;
+
+	// wrap the kernel so its center sits at the origin; ComplexBuffer starts zeroed
+	float* kernelRe = kernelSpectrum.GetRe();
+	for (size_t y = 0; y < kernelHeight; ++y)
+	{
+		const size_t wrappedY = (y + paddedHeight - kernelHeight / 2) % paddedHeight;
+		for (size_t x = 0; x < kernelWidth; ++x)
+		{
+			const size_t wrappedX = (x + paddedWidth - kernelWidth / 2) % paddedWidth;
+			kernelRe[wrappedY * paddedWidth + wrappedX] += kernel[y * kernelWidth + x] * normalization;
+		}
+	}
+
+	forwardPlan.Execute(kernelSpectrum);
+
+	const size_t spectrumWidth = blueForwardPlan.GetSpectrumWidth();
+	kernelHalfSpectrum.Resize(spectrumWidth * paddedHeight);
+	for (size_t y = 0; y < paddedHeight; ++y)
+	{
+		std::copy_n(kernelSpectrum.GetRe() + y * paddedWidth, spectrumWidth, kernelHalfSpectrum.GetRe() + y * spectrumWidth);
+		std::copy_n(kernelSpectrum.GetIm() + y * paddedWidth, spectrumWidth, kernelHalfSpectrum.GetIm() + y * spectrumWidth);
+	}
+}
+
+size_t FFTBloom::GetWidth() const
+{
+	return width;
+}
+
+size_t FFTBloom::GetHeight() const
+{
+	return height;
+}
+
+void FFTBloom::Apply(float* rgb, const FFTBloomSettings& settings)
+{
+	ExtractBrightPass(rgb, settings.threshold);
+
+	forwardPlan.Execute(redGreen);
+	blueForwardPlan.Execute(blue.data(), blueSpectrum);
+
+	ComplexMultiply(redGreen, kernelSpectrum, redGreen);
+	ComplexMultiply(blueSpectrum, kernelHalfSpectrum, blueSpectrum);
+
+	inversePlan.Execute(redGreen);
+	blueInversePlan.Execute(blueSpectrum, blue.data());
+
+	Composite(rgb, settings.intensity);
+}
+
+void FFTBloom::ExtractBrightPass(const float* rgb, float threshold)
+{
+	float* redGreenRe = redGreen.GetRe();
+	float* redGreenIm = redGreen.GetIm();
+	float* blueSamples = blue.data();
+
+	// the inverse leaves the padding with the spread of the kernel, so the whole grid is rewritten
+	ParallelFor(threadPool, paddedHeight, kMinRowsPerTask, [=, this](size_t begin, size_t end)
+	{
+		for (size_t y = begin; y < end; ++y)
+		{
+			const size_t row = y * paddedWidth;
+			std::fill(redGreenRe + row, redGreenRe + row + paddedWidth, 0.0f);
+			std::fill(redGreenIm + row, redGreenIm + row + paddedWidth, 0.0f);
+			std::fill(blueSamples + row, blueSamples + row + paddedWidth, 0.0f);
+
+			if (y >= height)
+			{
+				continue;
+			}
+
+			const float* pixel = rgb + y * width * 3;
+			for (size_t x = 0; x < width; ++x, pixel += 3)
+			{
+				// scale the color rather than clamping each channel, so bright pixels keep their hue
+				const float brightness = std::max(pixel[0], std::max(pixel[1], pixel[2]));
+				const float contribution = brightness > threshold ? (brightness - threshold) / brightness : 0.0f;
+
+				redGreenRe[row + x] = pixel[0] * contribution;
+				redGreenIm[row + x] = pixel[1] * contribution;
+				blueSamples[row + x] = pixel[2] * contribution;
+			}
+		}
+	});
+}
+
+void FFTBloom::Composite(float* rgb, float intensity)
+{
+	const float* redGreenRe = redGreen.GetRe();
+	const float* redGreenIm = redGreen.GetIm();
+	const float* blueSamples = blue.data();
+
+	ParallelFor(threadPool, height, kMinRowsPerTask, [=, this](size_t begin, size_t end)
+	{
+		for (size_t y = begin; y < end; ++y)
+		{
+			const size_t row = y * paddedWidth;
+			float* pixel = rgb + y * width * 3;
+			for (size_t x = 0; x < width; ++x, pixel += 3)
+			{
+				pixel[0] += intensity * redGreenRe[row + x];
+				pixel[1] += intensity * redGreenIm[row + x];
+				pixel[2] += intensity * blueSamples[row + x];
+			}
+		}
+	});
+}
+
+std::vector<float> FFTBloom::MakeGlareKernel(size_t size, float coreRadius, float falloff)
+{
+	std::vector<float> kernel(size * size);
+	const float center = static_cast<float>(size / 2);
+	for (size_t y = 0; y < size; ++y)
+	{
+		for (size_t x = 0; x < size; ++x)
+		{
+			const float dx = (static_cast<float>(x) - center) / coreRadius;
+			const float dy = (static_cast<float>(y) - center) / coreRadius;
+			kernel[y * size + x] = std::pow(1.0f + dx * dx + dy * dy, -falloff);
+		}
+	}
+	return kernel;
+}
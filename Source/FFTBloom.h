@@ -0,0 +1,64 @@
+#pragma once
+
+#include "ComplexBuffer.h"
+#include "FFT2D.h"
+
+#include <stddef.h>
+#include <vector>
+
+class ThreadPool;
+
+struct FFTBloomSettings
+{
+	// the part of each pixel above this brightness feeds the bloom
+	float threshold = 1.0f;
+	float intensity = 0.1f;
+};
+
+// Bloom and glare as a single convolution of the bright parts of the frame with a large kernel,
+// done by multiplying spectra. Its cost depends only on the padded frame size, not on the kernel
+// radius, so full-frame glare kernels cost the same as small ones.
+// Red and green are packed as the real and imaginary parts of one complex grid, which a real kernel
+// keeps separate. Blue goes through the real 2D transform, which only computes the half spectrum, so
+// the three channels cost about one and a half complex transforms each way. Frames are zero-padded
+// so the convolution does not wrap around the edges.
+class FFTBloom
+{
+public:
+	// kernel is kernelWidth x kernelHeight with its center at (kernelWidth / 2, kernelHeight / 2).
+	// It is normalized to sum to one.
+	FFTBloom(size_t width, size_t height, const std::vector<float>& kernel, size_t kernelWidth, size_t kernelHeight, ThreadPool* threadPool = nullptr);
+
+	FFTBloom(const FFTBloom&) = delete;
+	void operator=(const FFTBloom&) = delete;
+
+	// Adds the bloom of an interleaved RGB float frame of width x height pixels to itself
+	void Apply(float* rgb, const FFTBloomSettings& settings);
+
+	size_t GetWidth() const;
+	size_t GetHeight() const;
+
+	// A size x size glare kernel with a sharp core and a long 1 / (1 + (r / coreRadius)^2)^falloff tail
+	static std::vector<float> MakeGlareKernel(size_t size, float coreRadius, float falloff);
+private:
+	void ExtractBrightPass(const float* rgb, float threshold);
+	void Composite(float* rgb, float intensity);
+private:
+	size_t width;
+	size_t height;
+	size_t paddedWidth;
+	size_t paddedHeight;
+	ThreadPool* threadPool;
+
+	FFT2DPlan forwardPlan;
+	FFT2DPlan inversePlan;
+	RealFFT2DPlan blueForwardPlan;
+	RealFFT2DPlan blueInversePlan;
+	ComplexBuffer kernelSpectrum;
+	// the left paddedWidth / 2 + 1 columns of kernelSpectrum, for the blue half spectrum
+	ComplexBuffer kernelHalfSpectrum;
+	// red + i green
+	ComplexBuffer redGreen;
+	std::vector<float> blue;
+	ComplexBuffer blueSpectrum;
+};
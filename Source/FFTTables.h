@@ -0,0 +1,72 @@
+#pragma once
+
+#include "MathLib.h"
+
+#include <array>
+#include <stddef.h>
+
+// Twiddle factors generated at compile time, so plans for the common power-of-two sizes are built
+// without calling sin or cos. Every power-of-two size up to kFFTTableSize reads the same table with
+// a stride of kFFTTableSize / size.
+static constexpr size_t kFFTTableSize = 8192;
+
+// Taylor series for |x| <= pi / 2, which converges to double precision well within the term limit
+constexpr double ConstexprSin(double x)
+{
+	double term = x;
+	double sum = x;
+	for (int n = 1; n < 24; ++n)
+	{
+		term *= -x * x / ((2.0 * n) * (2.0 * n + 1.0));
+		sum += term;
+	}
+	return sum;
+}
+
+constexpr double ConstexprCos(double x)
+{
+	double term = 1.0;
+	double sum = 1.0;
+	for (int n = 1; n < 24; ++n)
+	{
+		term *= -x * x / ((2.0 * n - 1.0) * (2.0 * n));
+		sum += term;
+	}
+	return sum;
+}
+
+// sin(2 pi k / kFFTTableSize) for the first quarter wave; the other quadrants are reflections of it
+static constexpr std::array<float, kFFTTableSize / 4 + 1> kFFTQuarterSineTable = []()
+{
+	std::array<float, kFFTTableSize / 4 + 1> table{};
+	for (size_t k = 0; k <= kFFTTableSize / 4; ++k)
+	{
+		table[k] = static_cast<float>(ConstexprSin(2.0 * PI * static_cast<double>(k) / static_cast<double>(kFFTTableSize)));
+	}
+	return table;
+}();
+
+// exp(2 pi i * index / kFFTTableSize) from the quarter-wave table
+constexpr void LookupUnitRoot(size_t index, float& outCos, float& outSin)
+{
+	constexpr size_t quarter = kFFTTableSize / 4;
+	index %= kFFTTableSize;
+
+	const size_t quadrant = index / quarter;
+	const size_t offset = index % quarter;
+	const float s = kFFTQuarterSineTable[offset];
+	const float c = kFFTQuarterSineTable[quarter - offset];
+
+	switch (quadrant)
+	{
+	case 0: outCos = c; outSin = s; break;
+	case 1: outCos = -s; outSin = c; break;
+	case 2: outCos = -c; outSin = -s; break;
+	default: outCos = s; outSin = -c; break;
+	}
+}
+
+constexpr bool IsTablePowerOfTwo(size_t size)
+{
+	return size > 0 && size <= kFFTTableSize && (size & (size - 1)) == 0;
+}
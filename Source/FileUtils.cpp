@@ -0,0 +1,113 @@
+#include "FileUtils.h"
+
+#include "Hash.h"
+
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
+#include <thread>
+
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+std::vector<char> ReadFile(const std::string& filename) {
+    std::ifstream file(filename, std::ios::ate | std::ios::binary);
+
+    if (!file.is_open())
+    {
+        throw std::runtime_error("failed to open file " + filename);
+    }
+
+    size_t fileSize = (size_t) file.tellg();
+    std::vector<char> buffer(fileSize);
+
+    file.seekg(0);
+    file.read(buffer.data(), fileSize);
+    file.close();
+
+    return buffer;
+}
+
+bool TryReadFile(const std::string& filename, std::vector<char>& outContents)
+{
+    try
+    {
+        outContents = ReadFile(filename);
+        return true;
+    }
+    catch (const std::runtime_error&)
+    {
+        return false;
+    }
+}
+
+std::vector<uint32_t> ReadSpirvFile(const std::string& filename)
+{
+    const std::vector<char> code = ReadFile(filename);
+    std::vector<uint32_t> spirv(code.size() / sizeof(uint32_t));
+    std::memcpy(spirv.data(), code.data(), spirv.size() * sizeof(uint32_t));
+    return spirv;
+}
+
+// Pushes a closed file's contents to the disk, so a crash right after a rename cannot leave the new
+// name pointing at data that was never written
+static bool FlushToDisk(const std::string& path)
+{
+#ifdef _WIN32
+    const int descriptor = _open(path.c_str(), _O_WRONLY | _O_BINARY);
+    if (descriptor < 0)
+    {
+        return false;
+    }
+    const bool bFlushed = _commit(descriptor) == 0;
+    _close(descriptor);
+#else
+    const int descriptor = open(path.c_str(), O_WRONLY);
+    if (descriptor < 0)
+    {
+        return false;
+    }
+    const bool bFlushed = fsync(descriptor) == 0;
+    close(descriptor);
+#endif
+    return bFlushed;
+}
+
+bool WriteFileAtomic(const std::string& path, const void* data, size_t size)
+{
+    // unique per thread and per write, so concurrent writes of the same file never share a temp file
+    static std::atomic<uint64_t> writeCount{ 0 };
+    const uint64_t writer = std::hash<std::thread::id>()(std::this_thread::get_id()) ^ (writeCount++ << 32);
+    const std::string temporaryPath = path + "." + HashToString(writer) + ".tmp";
+
+    std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    file.write(static_cast<const char*>(data), size);
+    // closing flushes the stream buffer, which is where a full disk shows up
+    file.close();
+
+    std::error_code error;
+    if (file.fail() || !FlushToDisk(temporaryPath))
+    {
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+
+    std::filesystem::rename(temporaryPath, path, error);
+    if (error)
+    {
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+    return true;
+}
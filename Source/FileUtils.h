@@ -0,0 +1,16 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+std::vector<char> ReadFile(const std::string& filename);
+// ReadFile for files that may vanish at any moment, such as sources being edited; false instead of throwing
+bool TryReadFile(const std::string& filename, std::vector<char>& outContents);
+// Reads a .spv file as 32-bit SPIR-V words
+std::vector<uint32_t> ReadSpirvFile(const std::string& filename);
+// Writes to a temporary file beside path, flushes it to the disk and renames it into place, so readers,
+// including another process or the next run after a crash, see either the old contents or the new,
+// never a partial file
+bool WriteFileAtomic(const std::string& path, const void* data, size_t size);
@@ -0,0 +1,287 @@
+#include "GPUFFT.h"
+
+#include "FFT2D.h"
+#include "FFTTables.h"
+#include "Renderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+
+// Mirrors the push constant block in Shaders/fft.comp
+struct FFTPushConstants
+{
+	uint32_t size;
+	uint32_t log2Size;
+	uint32_t elementStride;
+	uint32_t transformStride;
+	uint32_t twiddleStride;
+	float directionSign;
+	float scale;
+};
+
+static bool IsSupportedSize(size_t size)
+{
+	return size >= 2 && size <= GPUFFT2D::kMaxSize && (size & (size - 1)) == 0;
+}
+
+static uint32_t Log2(size_t size)
+{
+	uint32_t log2Size = 0;
+	while ((size_t(1) << log2Size) < size)
+	{
+		++log2Size;
+	}
+	return log2Size;
+}
+
+static std::vector<VkDescriptorSetLayoutBinding> GetFFTBindings()
+{
+	std::vector<VkDescriptorSetLayoutBinding> bindings(2);
+	for (uint32_t i = 0; i < bindings.size(); ++i)
+	{
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+	return bindings;
+}
+
+static void RecordBufferBarrier(VkCommandBuffer commandBuffer, VkBuffer buffer, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+	VkBufferMemoryBarrier barrier = { VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER };
+	barrier.srcAccessMask = srcAccess;
+	barrier.dstAccessMask = dstAccess;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = buffer;
+	barrier.offset = 0;
+	barrier.size = VK_WHOLE_SIZE;
+
+	vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+static size_t CheckedSide(size_t size)
+{
+	if (!IsSupportedSize(size))
+	{
+		throw std::runtime_error("GPU FFT sides must be powers of two between 2 and 1024");
+	}
+	return size;
+}
+
+GPUFFT2D::GPUFFT2D(Renderer& renderer, size_t width, size_t height, const std::string& shaderFilepath)
+	: renderer(renderer), width(CheckedSide(width)), height(CheckedSide(height)), twiddleTableSize(std::max(width, height)),
+	pipeline(renderer, shaderFilepath, GetFFTBindings(), sizeof(FFTPushConstants)),
+	data(renderer, width * height * 2 * sizeof(float),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
+	staging(renderer, width * height * 2 * sizeof(float),
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT),
+	twiddles(renderer, twiddleTableSize * 2 * sizeof(float),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+{
+	UploadTwiddles();
+	CreateDescriptorSet();
+}
+
+GPUFFT2D::~GPUFFT2D()
+{
+	vkDestroyDescriptorPool(renderer.GetLogicalDevice(), descriptorPool, nullptr);
+}
+
+VkBuffer GPUFFT2D::GetDataBuffer() const
+{
+	return data.GetBuffer();
+}
+
+size_t GPUFFT2D::GetWidth() const
+{
+	return width;
+}
+
+size_t GPUFFT2D::GetHeight() const
+{
+	return height;
+}
+
+void GPUFFT2D::Record(VkCommandBuffer commandBuffer, FFTDirection direction)
+{
+	pipeline.Bind(commandBuffer);
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.GetPipelineLayout(), 0, 1, &descriptorSet, 0, nullptr);
+
+	/* Row Pass */
+	RecordPass(commandBuffer, direction, width, 1, width, height);
+
+	RecordBufferBarrier(commandBuffer, data.GetBuffer(),
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+	/* Column Pass, strided in place rather than transposed */
+	RecordPass(commandBuffer, direction, height, width, 1, width);
+}
+
+void GPUFFT2D::Execute(ComplexBuffer& grid, FFTDirection direction)
+{
+	if (grid.GetSize() != width * height)
+	{
+		throw std::runtime_error("FFT grid does not match the plan size");
+	}
+
+	float* mapped = static_cast<float*>(staging.Map());
+	const float* re = grid.GetRe();
+	const float* im = grid.GetIm();
+	for (size_t i = 0; i < grid.GetSize(); ++i)
+	{
+		mapped[2 * i] = re[i];
+		mapped[2 * i + 1] = im[i];
+	}
+
+	VkBufferCopy copyRegion{};
+	copyRegion.size = data.GetSize();
+
+	VkCommandBuffer commandBuffer = renderer.BeginSingleTimeCommands();
+
+	vkCmdCopyBuffer(commandBuffer, staging.GetBuffer(), data.GetBuffer(), 1, &copyRegion);
+	RecordBufferBarrier(commandBuffer, data.GetBuffer(),
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+	Record(commandBuffer, direction);
+
+	RecordBufferBarrier(commandBuffer, data.GetBuffer(),
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+	vkCmdCopyBuffer(commandBuffer, data.GetBuffer(), staging.GetBuffer(), 1, &copyRegion);
+	RecordBufferBarrier(commandBuffer, staging.GetBuffer(),
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+		VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT);
+
+	renderer.EndSingleTimeCommands(commandBuffer);
+
+	float* outRe = grid.GetRe();
+	float* outIm = grid.GetIm();
+	for (size_t i = 0; i < grid.GetSize(); ++i)
+	{
+		outRe[i] = mapped[2 * i];
+		outIm[i] = mapped[2 * i + 1];
+	}
+	staging.Unmap();
+}
+
+void GPUFFT2D::CreateDescriptorSet()
+{
+	VkDevice device = renderer.GetLogicalDevice();
+
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSize.descriptorCount = 2;
+
+	VkDescriptorPoolCreateInfo poolInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create FFT descriptor pool");
+	}
+
+	VkDescriptorSetLayout setLayout = pipeline.GetDescriptorSetLayout();
+
+	VkDescriptorSetAllocateInfo allocInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+	allocInfo.descriptorPool = descriptorPool;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &setLayout;
+
+	if (vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate FFT descriptor set");
+	}
+
+	VkDescriptorBufferInfo bufferInfos[2] = {};
+	bufferInfos[0].buffer = data.GetBuffer();
+	bufferInfos[0].range = VK_WHOLE_SIZE;
+	bufferInfos[1].buffer = twiddles.GetBuffer();
+	bufferInfos[1].range = VK_WHOLE_SIZE;
+
+	VkWriteDescriptorSet writes[2] = {};
+	for (uint32_t i = 0; i < 2; ++i)
+	{
+		writes[i] = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+		writes[i].dstSet = descriptorSet;
+		writes[i].dstBinding = i;
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writes[i].pBufferInfo = &bufferInfos[i];
+	}
+
+	vkUpdateDescriptorSets(device, 2, writes, 0, nullptr);
+}
+
+void GPUFFT2D::UploadTwiddles()
+{
+	// one table for both sides and both directions; the shader strides into it and flips the sine
+	float* mapped = static_cast<float*>(twiddles.Map());
+	const size_t tableStride = kFFTTableSize / twiddleTableSize;
+	for (size_t k = 0; k < twiddleTableSize; ++k)
+	{
+		LookupUnitRoot(k * tableStride, mapped[2 * k], mapped[2 * k + 1]);
+	}
+	twiddles.Unmap();
+}
+
+void GPUFFT2D::RecordPass(VkCommandBuffer commandBuffer, FFTDirection direction, size_t size, size_t elementStride, size_t transformStride, size_t transformCount)
+{
+	FFTPushConstants pushConstants;
+	pushConstants.size = static_cast<uint32_t>(size);
+	pushConstants.log2Size = Log2(size);
+	pushConstants.elementStride = static_cast<uint32_t>(elementStride);
+	pushConstants.transformStride = static_cast<uint32_t>(transformStride);
+	pushConstants.twiddleStride = static_cast<uint32_t>(twiddleTableSize / size);
+	pushConstants.directionSign = direction == FFTDirection::Forward ? -1.0f : 1.0f;
+	pushConstants.scale = direction == FFTDirection::Forward ? 1.0f : 1.0f / static_cast<float>(size);
+
+	vkCmdPushConstants(commandBuffer, pipeline.GetPipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pushConstants), &pushConstants);
+	vkCmdDispatch(commandBuffer, static_cast<uint32_t>(transformCount), 1, 1);
+}
+
+float ValidateGPUFFT(Renderer& renderer, size_t width, size_t height, const std::string& shaderFilepath)
+{
+	std::mt19937 generator(1234);
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+	ComplexBuffer input(width * height);
+	for (size_t i = 0; i < input.GetSize(); ++i)
+	{
+		input.GetRe()[i] = distribution(generator);
+		input.GetIm()[i] = distribution(generator);
+	}
+
+	GPUFFT2D gpuFFT(renderer, width, height, shaderFilepath);
+
+	float maxRelativeError = 0.0f;
+	for (FFTDirection direction : { FFTDirection::Forward, FFTDirection::Inverse })
+	{
+		ComplexBuffer expected = input;
+		FFT2DPlan(width, height, direction).Execute(expected);
+
+		ComplexBuffer actual = input;
+		gpuFFT.Execute(actual, direction);
+
+		float maxMagnitude = 0.0f;
+		float maxError = 0.0f;
+		for (size_t i = 0; i < expected.GetSize(); ++i)
+		{
+			maxMagnitude = std::max(maxMagnitude, std::hypot(expected.GetRe()[i], expected.GetIm()[i]));
+			maxError = std::max(maxError, std::hypot(actual.GetRe()[i] - expected.GetRe()[i], actual.GetIm()[i] - expected.GetIm()[i]));
+		}
+		maxRelativeError = std::max(maxRelativeError, maxMagnitude > 0.0f ? maxError / maxMagnitude : maxError);
+	}
+
+	return maxRelativeError;
+}
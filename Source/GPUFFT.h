@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Buffer.h"
+#include "ComplexBuffer.h"
+#include "ComputePipeline.h"
+#include "MathLib.h"
+
+#include <stddef.h>
+#include <string>
+
+#include "vulkan/vulkan.h"
+
+class Renderer;
+
+// 2D complex FFT of a row-major width x height grid on the compute queue, using the Stockham shader in
+// Shaders/fft.comp for a row pass and then a column pass. Both sides must be powers of two of at
+// most 1024. The grid stays in a device local storage buffer as interleaved (re, im) pairs, so
+// per-frame users record the transform next to the passes that produce and consume the data instead
+// of reading it back. Scaling matches FFT2DPlan: the inverse divides by width * height.
+class GPUFFT2D
+{
+public:
+	static constexpr size_t kMaxSize = 1024;
+
+	GPUFFT2D(Renderer& renderer, size_t width, size_t height, const std::string& shaderFilepath);
+	~GPUFFT2D();
+
+	GPUFFT2D(const GPUFFT2D&) = delete;
+	void operator=(const GPUFFT2D&) = delete;
+
+	// Records both passes; the caller orders access to GetDataBuffer() around them
+	void Record(VkCommandBuffer commandBuffer, FFTDirection direction);
+
+	// Uploads the grid, transforms it and reads it back, waiting for the queue. For validation and
+	// one-off transforms, not for per-frame work.
+	void Execute(ComplexBuffer& grid, FFTDirection direction);
+
+	VkBuffer GetDataBuffer() const;
+	size_t GetWidth() const;
+	size_t GetHeight() const;
+private:
+	void CreateDescriptorSet();
+	void UploadTwiddles();
+	void RecordPass(VkCommandBuffer commandBuffer, FFTDirection direction, size_t size, size_t elementStride, size_t transformStride, size_t transformCount);
+private:
+	Renderer& renderer;
+	size_t width;
+	size_t height;
+	size_t twiddleTableSize;
+
+	ComputePipeline pipeline;
+	Buffer data;
+	Buffer staging;
+	Buffer twiddles;
+	VkDescriptorPool descriptorPool;
+	VkDescriptorSet descriptorSet;
+};
+
+// Runs a forward and an inverse transform of a random grid through GPUFFT2D and FFT2DPlan and returns
+// the largest difference relative to the largest CPU magnitude. The CPU transform is the reference.
+float ValidateGPUFFT(Renderer& renderer, size_t width, size_t height, const std::string& shaderFilepath);
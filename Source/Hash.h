@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Incremental 64-bit FNV-1a. Not cryptographic; used to key caches by content, where 64 bits keep
+// accidental collisions out of reach for any realistic number of entries.
+class Hasher
+{
+public:
+	void Add(const void* data, size_t size)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; ++i)
+		{
+			hash ^= bytes[i];
+			hash *= kPrime;
+		}
+	}
+
+	// strings and vectors are length-prefixed so ("ab", "c") and ("a", "bc") hash differently
+	void Add(const std::string& value)
+	{
+		Add(static_cast<uint64_t>(value.size()));
+		Add(value.data(), value.size());
+	}
+
+	template <typename T>
+	void Add(const std::vector<T>& values)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "only vectors of plain values can be hashed as bytes");
+		Add(static_cast<uint64_t>(values.size()));
+		Add(values.data(), values.size() * sizeof(T));
+	}
+
+	template <typename T>
+	void Add(const T& value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "only plain values can be hashed as bytes");
+		Add(&value, sizeof(T));
+	}
+
+	uint64_t Get() const
+	{
+		return hash;
+	}
+private:
+	static constexpr uint64_t kOffsetBasis = 14695981039346656037ull;
+	static constexpr uint64_t kPrime = 1099511628211ull;
+
+	uint64_t hash = kOffsetBasis;
+};
+
+inline uint64_t HashBytes(const void* data, size_t size)
+{
+	Hasher hasher;
+	hasher.Add(data, size);
+	return hasher.Get();
+}
+
+// 16 lowercase hex digits, for file names
+inline std::string HashToString(uint64_t hash)
+{
+	static const char kDigits[] = "0123456789abcdef";
+	std::string text(16, '0');
+	for (int i = 15; i >= 0; --i, hash >>= 4)
+	{
+		text[i] = kDigits[hash & 0xf];
+	}
+	return text;
+}
@@ -1,15 +1,116 @@
+#include "GPUFFT.h"
 #include "MathLib.h"
+#include "Ocean.h"
+#include "OceanHeightmap.h"
 #include "Pipeline.h"
+#include "PipelineRegistry.h"
 #include "Renderer.h"
+#include "ShaderCache.h"
+#include "ShaderCompiler.h"
+#include "ShaderHotReload.h"
+#include "ThreadPool.h"
 #include "Window.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <iostream>
+#include <vector>
 
 #define WINDOW_WIDTH 1920
 #define WINDOW_HEIGHT 1080
+#define SHADER_DIRECTORY "../Shaders"
+// precompiled SPIR-V, set by CMake to the build tree
+#ifndef ENGINE_SHADER_BINARY_DIR
+#define ENGINE_SHADER_BINARY_DIR "Shaders"
+#endif
+#define SHADER_CACHE_DIRECTORY "ShaderCache"
+#define PIPELINE_CACHE_PATH "PipelineCache.bin"
+#define PIPELINE_MANIFEST_PATH "PipelineManifest.bin"
+
+// debug builds keep the source in the SPIR-V for profilers and shader debuggers
+#if _DEBUG
+#define SHADER_OUTPUT ShaderOutput::DebugInfo
+#else
+#define SHADER_OUTPUT ShaderOutput::Stripped
+#endif
+
+// Compares the compute shader FFT with the CPU FFT on a headless device (a software driver such as
+// lavapipe works) and fails if they disagree
+static int ValidateGPUFFTMain()
+{
+    const float tolerance = 1e-4f;
+    const size_t sizes[][2] = { { 2, 2 }, { 8, 4 }, { 32, 128 }, { 256, 512 }, { 1024, 1024 } };
+
+    Renderer renderer;
+
+    int result = 0;
+    for (const size_t* size : sizes)
+    {
+        const float error = ValidateGPUFFT(renderer, size[0], size[1], ENGINE_SHADER_BINARY_DIR "/fft.comp.spv");
+        const bool bPassed = error <= tolerance;
+        std::cout << "GPU FFT " << size[0] << "x" << size[1] << ": relative error " << error << (bPassed ? "\n" : " FAILED\n");
+        if (!bPassed)
+        {
+            result = 1;
+        }
+    }
+
+    return result;
+}
+
+// Runs the ocean simulation and its heightmap upload for a few seconds of frames on a headless device,
+// and fails if the surface stops being finite. Each frame's copy is waited on in place of a frame fence.
+static int OceanSmokeMain()
+{
+    const int frameCount = 300;
+    const float frameTime = 1.0f / 60.0f;
+
+    Renderer renderer;
+    ThreadPool threadPool;
+    Ocean ocean(Ocean::DefaultSettings(), &threadPool);
+    OceanHeightmap heightmap(renderer, ocean);
+
+    for (int frame = 0; frame < frameCount; ++frame)
+    {
+        ocean.Update(frame * frameTime);
+        heightmap.Stage(ocean);
+
+        VkCommandBuffer commandBuffer = renderer.BeginSingleTimeCommands();
+        heightmap.RecordUpload(commandBuffer);
+        renderer.EndSingleTimeCommands(commandBuffer);
+        renderer.AdvanceFrame();
+    }
+
+    float maxHeight = 0.0f;
+    for (size_t cascade = 0; cascade < ocean.GetCascadeCount(); ++cascade)
+    {
+        for (const glm::vec4& texel : ocean.GetCascade(cascade).GetDisplacement())
+        {
+            if (!std::isfinite(texel.x) || !std::isfinite(texel.y) || !std::isfinite(texel.z) || !std::isfinite(texel.w))
+            {
+                std::cout << "ocean cascade " << cascade << ": non-finite displacement FAILED\n";
+                return 1;
+            }
+            maxHeight = std::max(maxHeight, std::abs(texel.y));
+        }
+    }
+
+    std::cout << "ocean: " << frameCount << " frames of " << ocean.GetCascadeCount() << " cascades at " << ocean.GetResolution() << "^2, max height " << maxHeight << " m\n";
+    return 0;
+}
 
 int main(int argc, char** argv)
 {
+    if (argc > 1 && std::strcmp(argv[1], "--validate-gpu-fft") == 0)
+    {
+        return ValidateGPUFFTMain();
+    }
+    if (argc > 1 && std::strcmp(argv[1], "--ocean") == 0)
+    {
+        return OceanSmokeMain();
+    }
+
     Window::Init();
 
     /* Pipeline Creation
@@ -18,12 +119,63 @@ int main(int argc, char** argv)
     */
 
     Window window(WINDOW_WIDTH, WINDOW_HEIGHT, "Vulkan Engine");
-    Renderer renderer(window);
+    Renderer renderer(window, PIPELINE_CACHE_PATH);
+
+    ShaderCompiler shaderCompiler({ SHADER_DIRECTORY });
+    ShaderCache shaderCache(shaderCompiler, SHADER_CACHE_DIRECTORY);
+
+    ThreadPool threadPool;
 
-    Pipeline pipeline(renderer, Pipeline::DefaultPipelineConfigInfo(), "../Shaders/vert.spv", "../Shaders/frag.spv");
+    // the pipelines of the last run compile while this run's shaders are loaded
+    PipelineRegistry pipelineRegistry(renderer);
+    std::vector<PipelineHandle> prewarmedPipelines = pipelineRegistry.Prewarm(threadPool, PIPELINE_MANIFEST_PATH);
 
-    window.Run();
+    std::vector<ShaderCompileRequest> shaderRequests(2);
+    shaderRequests[0].sourcePath = SHADER_DIRECTORY "/main.vert";
+    shaderRequests[0].stage = ShaderStage::Vertex;
+    shaderRequests[1].sourcePath = SHADER_DIRECTORY "/main.frag";
+    shaderRequests[1].stage = ShaderStage::Fragment;
+    for (ShaderCompileRequest& request : shaderRequests)
+    {
+        request.output = SHADER_OUTPUT;
+    }
+
+    // every stage compiles at once; errors are reported per job, in request order
+    const std::vector<ShaderCompileResult> shaders = shaderCache.CompileAll(shaderRequests, &threadPool);
+    bool bShadersCompiled = true;
+    for (size_t i = 0; i < shaders.size(); ++i)
+    {
+        if (!shaders[i].bSuccess)
+        {
+            std::cerr << "failed to compile " << shaderRequests[i].sourcePath << "\n" << shaders[i].log;
+            bShadersCompiled = false;
+        }
+    }
+    if (!bShadersCompiled)
+    {
+        Window::Terminate();
+        return 1;
+    }
+
+    const std::shared_ptr<Pipeline> pipeline = pipelineRegistry.Get(Pipeline::DefaultPipelineConfigInfo(renderer.GetExtendedDynamicState()), shaders[0].spirv, shaders[1].spirv);
+    // the scene holds every pipeline it uses now; the rest of the prewarmed ones are freed
+    prewarmedPipelines.clear();
+
+    ShaderHotReload shaderHotReload(shaderCache, SHADER_DIRECTORY, &threadPool);
+    shaderHotReload.Register(*pipeline, shaderRequests[0], shaders[0], shaderRequests[1], shaders[1]);
+
+    window.Run([&]()
+    {
+        shaderHotReload.Update();
+        renderer.AdvanceFrame();
+    });
+
+    // every pipeline compiled during the run should have been listed by the last one
+    if (pipelineRegistry.GetUnlistedCount() > 0)
+    {
+        std::cerr << pipelineRegistry.GetUnlistedCount() << " pipelines were created without being prewarmed" << std::endl;
+    }
+    pipelineRegistry.SaveManifest(PIPELINE_MANIFEST_PATH);
 
     Window::Terminate();
 }
-
@@ -0,0 +1,49 @@
+#include "MathLib.h"
+
+#include <stdint.h>
+
+std::ostream& operator<<(std::ostream& os, const ComplexNumber& comp)
+{
+	os << comp.re << " + " << comp.im << "i";
+	return os;
+}
+
+std::vector<ComplexNumber> DFT_Slow(const std::vector<float>& x)
+{
+	std::vector<ComplexNumber> complexInput(x.size());
+	for (size_t i = 0; i < x.size(); ++i)
+	{
+		complexInput[i].re = x[i];
+	}
+
+	return DFT_Slow(complexInput, FFTDirection::Forward);
+}
+
+std::vector<ComplexNumber> DFT_Slow(const std::vector<ComplexNumber>& x, FFTDirection direction)
+{
+	const size_t n = x.size();
+	const double sign = direction == FFTDirection::Forward ? -1.0 : 1.0;
+	const double scale = direction == FFTDirection::Forward || n == 0 ? 1.0 : 1.0 / static_cast<double>(n);
+
+	std::vector<ComplexNumber> result(n);
+	for (size_t k = 0; k < n; ++k)
+	{
+		double sumRe = 0.0;
+		double sumIm = 0.0;
+		for (size_t j = 0; j < n; ++j)
+		{
+			// reduce j * k modulo n first so the angle stays exact for large transforms
+			const uint64_t index = (static_cast<uint64_t>(j) * k) % n;
+			const double angle = sign * 2.0 * PI * static_cast<double>(index) / static_cast<double>(n);
+			const double c = cos(angle);
+			const double s = sin(angle);
+			sumRe += x[j].re * c - x[j].im * s;
+			sumIm += x[j].re * s + x[j].im * c;
+		}
+
+		result[k].re = static_cast<float>(sumRe * scale);
+		result[k].im = static_cast<float>(sumIm * scale);
+	}
+
+	return result;
+}
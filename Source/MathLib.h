@@ -5,6 +5,7 @@
 #include <glm/vec4.hpp>
 #include <glm/mat4x4.hpp>
 
+#include <cmath>
 #include <ostream>
 #include <vector>
 
@@ -12,26 +13,32 @@
 
 class ComplexNumber {
 public:
+	ComplexNumber()
+		: re(0.0f), im(0.0f) {}
+
 	ComplexNumber(float real, float imaginary)
 		: re(real), im(imaginary) {}
 
-	// TODO: complex conjugate
+	ComplexNumber Conjugate() const
+	{
+		return ComplexNumber(re, -im);
+	}
 
-	ComplexNumber operator+=(const ComplexNumber& other)
+	ComplexNumber& operator+=(const ComplexNumber& other)
 	{
 		re += other.re;
 		im += other.im;
 		return *this;
 	}
 
-	ComplexNumber operator-=(const ComplexNumber& other)
+	ComplexNumber& operator-=(const ComplexNumber& other)
 	{
 		re -= other.re;
 		im -= other.im;
 		return *this;
 	}
 
-	ComplexNumber operator*=(const ComplexNumber& other)
+	ComplexNumber& operator*=(const ComplexNumber& other)
 	{
 		float realTerm = re * other.re - im * other.im;
 		float imaginaryTerm = re * other.im + im * other.re;
@@ -40,7 +47,7 @@ public:
 		return *this;
 	}
 
-	ComplexNumber operator/=(const ComplexNumber& other)
+	ComplexNumber& operator/=(const ComplexNumber& other)
 	{
 		float denominator = other.re * other.re + other.im * other.im;
 		float realTerm = (re * other.re + im * other.im) / denominator;
@@ -50,12 +57,13 @@ public:
 		return *this;
 	}
 
-	float Abs()
+	// Per-element helpers; loops over many values should use the ComplexBuffer kernels instead
+	float Abs() const
 	{
 		return sqrt(re * re + im * im);
 	}
 
-	float Arg()
+	float Arg() const
 	{
 		return atan2(im, re);
 	}
@@ -89,17 +97,15 @@ inline ComplexNumber operator/(ComplexNumber lhs, const ComplexNumber& rhs)
 	return lhs;
 }
 
-std::ostream& operator<<(std::ostream& os, const ComplexNumber& comp)
-{
-	os << comp.re << " + " << comp.im << "i";
-	return os;
-}
+std::ostream& operator<<(std::ostream& os, const ComplexNumber& comp);
 
-std::vector<float> DFT_Slow(std::vector<float> x)
+enum class FFTDirection
 {
+	Forward,
+	Inverse,
+};
 
-
-
-
-	return x;
-}
+// O(n^2) reference transforms, evaluated in double precision. These are the oracle the FFT in FFT.h
+// is checked against and should not be used on hot paths. Inverse transforms are scaled by 1/n.
+std::vector<ComplexNumber> DFT_Slow(const std::vector<float>& x);
+std::vector<ComplexNumber> DFT_Slow(const std::vector<ComplexNumber>& x, FFTDirection direction = FFTDirection::Forward);
@@ -0,0 +1,277 @@
+#include "Ocean.h"
+
+#include "ThreadPool.h"
+
+#include <glm/geometric.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+
+// rows of a cascade are cheap, so they are handed out a few at a time
+static constexpr size_t kMinRowsPerTask = 8;
+
+// Packs two spectra of real fields into one, so a single inverse FFT returns a in the real parts and
+// b in the imaginary parts
+static void PackSpectra(float aRe, float aIm, float bRe, float bIm, float& outRe, float& outIm)
+{
+	outRe = aRe - bIm;
+	outIm = aIm + bRe;
+}
+
+OceanCascade::OceanCascade(const OceanSettings& settings, const OceanCascadeSettings& cascadeSettings, ThreadPool* threadPool)
+	: resolution(settings.resolution), patchSize(cascadeSettings.patchSize), choppiness(settings.choppiness), threadPool(threadPool),
+	h0(resolution * resolution), h0MinusConjugate(resolution * resolution),
+	frequencyIndex(resolution * resolution), loopFrequency(static_cast<float>(2.0 * PI) / settings.loopPeriod),
+	kx(resolution * resolution), kz(resolution * resolution), inverseKLength(resolution * resolution),
+	inversePlan(resolution, resolution, FFTDirection::Inverse, threadPool),
+	displacement(resolution * resolution), normals(resolution * resolution)
+{
+	for (ComplexBuffer& grid : grids)
+	{
+		grid.Resize(resolution * resolution);
+	}
+
+	CreateSpectrum(settings, cascadeSettings);
+}
+
+size_t OceanCascade::GetResolution() const
+{
+	return resolution;
+}
+
+float OceanCascade::GetPatchSize() const
+{
+	return patchSize;
+}
+
+const std::vector<glm::vec4>& OceanCascade::GetDisplacement() const
+{
+	return displacement;
+}
+
+const std::vector<glm::vec4>& OceanCascade::GetNormals() const
+{
+	return normals;
+}
+
+void OceanCascade::CreateSpectrum(const OceanSettings& settings, const OceanCascadeSettings& cascadeSettings)
+{
+	const glm::vec2 windDirection = glm::normalize(settings.windDirection);
+	// largest wave that the wind speed can sustain, and a cutoff that removes waves far shorter than a texel
+	const float largestWave = settings.windSpeed * settings.windSpeed / settings.gravity;
+	const float smallestWave = largestWave * 0.001f;
+	// the inverse FFT divides by resolution^2, but Tessendorf's sum does not
+	const float fftScale = static_cast<float>(resolution * resolution);
+
+	std::mt19937 generator(cascadeSettings.seed);
+	std::normal_distribution<float> gaussian(0.0f, 1.0f);
+
+	const size_t count = resolution * resolution;
+	std::vector<float> h0Re(count);
+	std::vector<float> h0Im(count);
+
+	for (size_t z = 0; z < resolution; ++z)
+	{
+		// FFT order: bins past the middle are the negative frequencies
+		const float nz = static_cast<float>(z < resolution / 2 ? static_cast<ptrdiff_t>(z) : static_cast<ptrdiff_t>(z) - static_cast<ptrdiff_t>(resolution));
+		for (size_t x = 0; x < resolution; ++x)
+		{
+			const float nx = static_cast<float>(x < resolution / 2 ? static_cast<ptrdiff_t>(x) : static_cast<ptrdiff_t>(x) - static_cast<ptrdiff_t>(resolution));
+			const size_t index = z * resolution + x;
+
+			const glm::vec2 k = glm::vec2(nx, nz) * static_cast<float>(2.0 * PI) / patchSize;
+			const float kLength = glm::length(k);
+			kx[index] = k.x;
+			kz[index] = k.y;
+			inverseKLength[index] = kLength > 0.0f ? 1.0f / kLength : 0.0f;
+			frequencyIndex[index] = static_cast<uint32_t>(std::round(std::sqrt(settings.gravity * kLength) / loopFrequency));
+
+			// the Nyquist row and column have no matching -k bin, so the odd fields built from them would
+			// not come back real and would leak into their packed partner
+			float phillips = 0.0f;
+			if (kLength > 1e-6f && x != resolution / 2 && z != resolution / 2)
+			{
+				const float kLength2 = kLength * kLength;
+				const float alignment = glm::dot(k / kLength, windDirection);
+				phillips = cascadeSettings.amplitude * std::exp(-1.0f / (kLength2 * largestWave * largestWave)) / (kLength2 * kLength2)
+					* alignment * alignment * std::exp(-kLength2 * smallestWave * smallestWave);
+			}
+
+			const float magnitude = fftScale * std::sqrt(phillips * 0.5f);
+			h0Re[index] = gaussian(generator) * magnitude;
+			h0Im[index] = gaussian(generator) * magnitude;
+		}
+	}
+
+	uint32_t maxFrequencyIndex = 0;
+	for (uint32_t index : frequencyIndex)
+	{
+		maxFrequencyIndex = std::max(maxFrequencyIndex, index);
+	}
+	phaseCos.resize(maxFrequencyIndex + 1);
+	phaseSin.resize(maxFrequencyIndex + 1);
+
+	for (size_t z = 0; z < resolution; ++z)
+	{
+		const size_t minusZ = (resolution - z) % resolution;
+		for (size_t x = 0; x < resolution; ++x)
+		{
+			const size_t minusX = (resolution - x) % resolution;
+			const size_t index = z * resolution + x;
+			const size_t minusIndex = minusZ * resolution + minusX;
+
+			h0.GetRe()[index] = h0Re[index];
+			h0.GetIm()[index] = h0Im[index];
+			h0MinusConjugate.GetRe()[index] = h0Re[minusIndex];
+			h0MinusConjugate.GetIm()[index] = -h0Im[minusIndex];
+		}
+	}
+}
+
+void OceanCascade::Update(float time)
+{
+	UpdatePhases(time);
+	ParallelFor(threadPool, resolution, kMinRowsPerTask, [this](size_t begin, size_t end) { EvolveSpectrum(begin, end); });
+
+	for (ComplexBuffer& grid : grids)
+	{
+		inversePlan.Execute(grid);
+	}
+
+	ParallelFor(threadPool, resolution, kMinRowsPerTask, [this](size_t begin, size_t end) { AssembleOutput(begin, end); });
+}
+
+void OceanCascade::UpdatePhases(float time)
+{
+	// wrap the time first so the float phase stays accurate however long the simulation runs
+	const double loopTime = std::fmod(static_cast<double>(time), 2.0 * PI / loopFrequency);
+	for (size_t i = 0; i < phaseCos.size(); ++i)
+	{
+		const double phase = static_cast<double>(i) * loopFrequency * loopTime;
+		phaseCos[i] = static_cast<float>(std::cos(phase));
+		phaseSin[i] = static_cast<float>(std::sin(phase));
+	}
+}
+
+void OceanCascade::EvolveSpectrum(size_t rowBegin, size_t rowEnd)
+{
+	const float* h0Re = h0.GetRe();
+	const float* h0Im = h0.GetIm();
+	const float* minusRe = h0MinusConjugate.GetRe();
+	const float* minusIm = h0MinusConjugate.GetIm();
+	float* packedRe[4] = { grids[0].GetRe(), grids[1].GetRe(), grids[2].GetRe(), grids[3].GetRe() };
+	float* packedIm[4] = { grids[0].GetIm(), grids[1].GetIm(), grids[2].GetIm(), grids[3].GetIm() };
+
+	for (size_t index = rowBegin * resolution; index < rowEnd * resolution; ++index)
+	{
+		const float c = phaseCos[frequencyIndex[index]];
+		const float s = phaseSin[frequencyIndex[index]];
+
+		// h = h0 e^(i w t) + conj(h0(-k)) e^(-i w t)
+		const float hRe = (h0Re[index] + minusRe[index]) * c - (h0Im[index] - minusIm[index]) * s;
+		const float hIm = (h0Re[index] - minusRe[index]) * s + (h0Im[index] + minusIm[index]) * c;
+
+		const float ax = kx[index] * inverseKLength[index];
+		const float az = kz[index] * inverseKLength[index];
+
+		// displacement -i k/|k| h, slope i k h, displacement derivatives k k/|k| h
+		const float dxRe = ax * hIm, dxIm = -ax * hRe;
+		const float dzRe = az * hIm, dzIm = -az * hRe;
+		const float sxRe = -kx[index] * hIm, sxIm = kx[index] * hRe;
+		const float szRe = -kz[index] * hIm, szIm = kz[index] * hRe;
+		const float dxxRe = kx[index] * ax * hRe, dxxIm = kx[index] * ax * hIm;
+		const float dzzRe = kz[index] * az * hRe, dzzIm = kz[index] * az * hIm;
+		const float dxzRe = kx[index] * az * hRe, dxzIm = kx[index] * az * hIm;
+
+		PackSpectra(hRe, hIm, dxRe, dxIm, packedRe[0][index], packedIm[0][index]);
+		PackSpectra(dzRe, dzIm, sxRe, sxIm, packedRe[1][index], packedIm[1][index]);
+		PackSpectra(szRe, szIm, dxxRe, dxxIm, packedRe[2][index], packedIm[2][index]);
+		PackSpectra(dzzRe, dzzIm, dxzRe, dxzIm, packedRe[3][index], packedIm[3][index]);
+	}
+}
+
+void OceanCascade::AssembleOutput(size_t rowBegin, size_t rowEnd)
+{
+	const float* packedRe[4] = { grids[0].GetRe(), grids[1].GetRe(), grids[2].GetRe(), grids[3].GetRe() };
+	const float* packedIm[4] = { grids[0].GetIm(), grids[1].GetIm(), grids[2].GetIm(), grids[3].GetIm() };
+
+	for (size_t index = rowBegin * resolution; index < rowEnd * resolution; ++index)
+	{
+		const float height = packedRe[0][index];
+		const float dx = packedIm[0][index];
+		const float dz = packedRe[1][index];
+		const float slopeX = packedIm[1][index];
+		const float slopeZ = packedRe[2][index];
+		const float dxx = packedIm[2][index];
+		const float dzz = packedRe[3][index];
+		const float dxz = packedIm[3][index];
+
+		const float jxx = 1.0f + choppiness * dxx;
+		const float jzz = 1.0f + choppiness * dzz;
+		const float jxz = choppiness * dxz;
+
+		displacement[index] = glm::vec4(choppiness * dx, height, choppiness * dz, jxx * jzz - jxz * jxz);
+		normals[index] = glm::vec4(glm::normalize(glm::vec3(-slopeX, 1.0f, -slopeZ)), 0.0f);
+	}
+}
+
+Ocean::Ocean(const OceanSettings& settings, ThreadPool* threadPool)
+	: resolution(settings.resolution)
+{
+	if (settings.cascades.empty())
+	{
+		throw std::runtime_error("ocean needs at least one cascade");
+	}
+
+	for (const OceanCascadeSettings& cascadeSettings : settings.cascades)
+	{
+		cascades.push_back(std::make_unique<OceanCascade>(settings, cascadeSettings, threadPool));
+	}
+}
+
+void Ocean::Update(float time)
+{
+	// each cascade already spreads its rows and FFTs over the pool
+	for (std::unique_ptr<OceanCascade>& cascade : cascades)
+	{
+		cascade->Update(time);
+	}
+}
+
+size_t Ocean::GetResolution() const
+{
+	return resolution;
+}
+
+size_t Ocean::GetCascadeCount() const
+{
+	return cascades.size();
+}
+
+const OceanCascade& Ocean::GetCascade(size_t index) const
+{
+	return *cascades[index];
+}
+
+OceanSettings Ocean::DefaultSettings()
+{
+	OceanSettings settings;
+
+	// patch sizes with no simple ratio between them, so the tiles never line up
+	OceanCascadeSettings swell;
+	swell.patchSize = 250.0f;
+	swell.seed = 1;
+
+	OceanCascadeSettings waves;
+	waves.patchSize = 37.0f;
+	waves.seed = 2;
+
+	OceanCascadeSettings ripples;
+	ripples.patchSize = 5.3f;
+	ripples.seed = 3;
+
+	settings.cascades = { swell, waves, ripples };
+	return settings;
+}
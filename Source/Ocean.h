@@ -0,0 +1,114 @@
+#pragma once
+
+#include "ComplexBuffer.h"
+#include "FFT2D.h"
+#include "MathLib.h"
+
+#include <glm/vec2.hpp>
+
+#include <memory>
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+class ThreadPool;
+
+struct OceanCascadeSettings
+{
+	// world size of the tile, in meters
+	float patchSize = 250.0f;
+	// Phillips spectrum constant
+	float amplitude = 0.0005f;
+	uint32_t seed = 1;
+};
+
+struct OceanSettings
+{
+	// texels per side, shared by every cascade so they fit one image array
+	size_t resolution = 256;
+	glm::vec2 windDirection = glm::vec2(1.0f, 0.0f);
+	float windSpeed = 30.0f;
+	float gravity = 9.81f;
+	// horizontal displacement scale, 0 gives plain height field waves
+	float choppiness = 1.3f;
+	// wave frequencies are rounded to multiples of 2 pi / loopPeriod, so the surface repeats after this
+	// many seconds and every update needs one sin and cos per distinct frequency instead of per texel
+	float loopPeriod = 200.0f;
+	std::vector<OceanCascadeSettings> cascades;
+};
+
+// One tiling patch of Tessendorf's FFT ocean. The Phillips spectrum h0(k) is generated once; each update
+// advances it to h(k, t) = h0(k) e^(i w t) + conj(h0(-k)) e^(-i w t) and derives the spectra of the
+// height, the choppy displacement, the slopes and the displacement Jacobian. Every one of those fields
+// is real in space, so they are packed in pairs as the real and imaginary parts of four inverse 2D
+// FFTs rather than transformed one by one.
+class OceanCascade
+{
+public:
+	OceanCascade(const OceanSettings& settings, const OceanCascadeSettings& cascadeSettings, ThreadPool* threadPool);
+
+	OceanCascade(const OceanCascade&) = delete;
+	void operator=(const OceanCascade&) = delete;
+
+	void Update(float time);
+
+	size_t GetResolution() const;
+	float GetPatchSize() const;
+	// (x displacement, height, z displacement, Jacobian) per texel; a Jacobian below one marks folding foam
+	const std::vector<glm::vec4>& GetDisplacement() const;
+	// (normal, 0) per texel
+	const std::vector<glm::vec4>& GetNormals() const;
+private:
+	void CreateSpectrum(const OceanSettings& settings, const OceanCascadeSettings& cascadeSettings);
+	void UpdatePhases(float time);
+	void EvolveSpectrum(size_t rowBegin, size_t rowEnd);
+	void AssembleOutput(size_t rowBegin, size_t rowEnd);
+private:
+	size_t resolution;
+	float patchSize;
+	float choppiness;
+	ThreadPool* threadPool;
+
+	ComplexBuffer h0;
+	// conj(h0(-k)), stored at k so the time update reads both terms linearly
+	ComplexBuffer h0MinusConjugate;
+	// frequency of each bin as a multiple of the loop frequency, and e^(i w t) for every multiple
+	std::vector<uint32_t> frequencyIndex;
+	float loopFrequency;
+	std::vector<float> phaseCos;
+	std::vector<float> phaseSin;
+	std::vector<float> kx;
+	std::vector<float> kz;
+	// 1 / |k|, zero for the constant term
+	std::vector<float> inverseKLength;
+
+	FFT2DPlan inversePlan;
+	// height + i dx, dz + i slope x, slope z + i dxx, dzz + i dxz
+	ComplexBuffer grids[4];
+
+	std::vector<glm::vec4> displacement;
+	std::vector<glm::vec4> normals;
+};
+
+// A set of cascades with decreasing patch sizes, so the long swell and the short chop each get the
+// full resolution without one tile visibly repeating
+class Ocean
+{
+public:
+	Ocean(const OceanSettings& settings, ThreadPool* threadPool = nullptr);
+
+	Ocean(const Ocean&) = delete;
+	void operator=(const Ocean&) = delete;
+
+	void Update(float time);
+
+	size_t GetResolution() const;
+	size_t GetCascadeCount() const;
+	const OceanCascade& GetCascade(size_t index) const;
+
+	// three cascades covering swell to ripples
+	static OceanSettings DefaultSettings();
+private:
+	size_t resolution;
+	std::vector<std::unique_ptr<OceanCascade>> cascades;
+};
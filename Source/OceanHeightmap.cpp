@@ -0,0 +1,163 @@
+#include "OceanHeightmap.h"
+
+#include "Ocean.h"
+#include "Renderer.h"
+
+#include <cstring>
+#include <stdexcept>
+
+static constexpr VkFormat kHeightmapFormat = VK_FORMAT_R32G32B32A32_SFLOAT;
+
+OceanHeightmap::OceanHeightmap(Renderer& renderer, const Ocean& ocean)
+	: renderer(renderer), resolution(static_cast<uint32_t>(ocean.GetResolution())), layerCount(static_cast<uint32_t>(ocean.GetCascadeCount() * 2)),
+	stagingRegionSize(VkDeviceSize(resolution) * resolution * layerCount * sizeof(glm::vec4)),
+	staging(renderer, stagingRegionSize * Renderer::kMaxFramesInFlight,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+{
+	CreateImage();
+	CreateImageView();
+}
+
+OceanHeightmap::~OceanHeightmap()
+{
+	vkDestroyImageView(renderer.GetLogicalDevice(), imageView, nullptr);
+	vkDestroyImage(renderer.GetLogicalDevice(), image, nullptr);
+	vkFreeMemory(renderer.GetLogicalDevice(), imageMemory, nullptr);
+}
+
+VkImage OceanHeightmap::GetImage() const
+{
+	return image;
+}
+
+VkImageView OceanHeightmap::GetImageView() const
+{
+	return imageView;
+}
+
+uint32_t OceanHeightmap::GetLayerCount() const
+{
+	return layerCount;
+}
+
+void OceanHeightmap::Stage(const Ocean& ocean)
+{
+	const size_t layerSize = size_t(resolution) * resolution;
+	glm::vec4* mapped = reinterpret_cast<glm::vec4*>(static_cast<char*>(staging.Map()) + GetStagingOffset());
+
+	for (size_t cascade = 0; cascade < ocean.GetCascadeCount(); ++cascade)
+	{
+		const OceanCascade& source = ocean.GetCascade(cascade);
+		std::memcpy(mapped + (2 * cascade) * layerSize, source.GetDisplacement().data(), layerSize * sizeof(glm::vec4));
+		std::memcpy(mapped + (2 * cascade + 1) * layerSize, source.GetNormals().data(), layerSize * sizeof(glm::vec4));
+	}
+}
+
+void OceanHeightmap::RecordUpload(VkCommandBuffer commandBuffer)
+{
+	// the old contents are overwritten entirely, so they can be discarded
+	RecordLayoutTransition(commandBuffer,
+		VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		bInitialized ? VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+	VkBufferImageCopy region{};
+	region.bufferOffset = GetStagingOffset();
+	region.bufferRowLength = 0;
+	region.bufferImageHeight = 0;
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = 0;
+	region.imageSubresource.baseArrayLayer = 0;
+	region.imageSubresource.layerCount = layerCount;
+	region.imageOffset = { 0, 0, 0 };
+	region.imageExtent = { resolution, resolution, 1 };
+
+	vkCmdCopyBufferToImage(commandBuffer, staging.GetBuffer(), image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+	RecordLayoutTransition(commandBuffer,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+		VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+	bInitialized = true;
+}
+
+VkDeviceSize OceanHeightmap::GetStagingOffset() const
+{
+	return (renderer.GetFrameIndex() % Renderer::kMaxFramesInFlight) * stagingRegionSize;
+}
+
+void OceanHeightmap::CreateImage()
+{
+	VkDevice device = renderer.GetLogicalDevice();
+
+	VkImageCreateInfo imageInfo = { VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.format = kHeightmapFormat;
+	imageInfo.extent = { resolution, resolution, 1 };
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = layerCount;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create ocean heightmap image");
+	}
+
+	VkMemoryRequirements memoryRequirements;
+	vkGetImageMemoryRequirements(device, image, &memoryRequirements);
+
+	VkMemoryAllocateInfo allocInfo = { VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
+	allocInfo.allocationSize = memoryRequirements.size;
+	allocInfo.memoryTypeIndex = renderer.FindMemoryType(memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	if (vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to allocate ocean heightmap memory");
+	}
+
+	vkBindImageMemory(device, image, imageMemory, 0);
+}
+
+void OceanHeightmap::CreateImageView()
+{
+	VkImageViewCreateInfo viewInfo = { VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+	viewInfo.image = image;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+	viewInfo.format = kHeightmapFormat;
+	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	viewInfo.subresourceRange.baseMipLevel = 0;
+	viewInfo.subresourceRange.levelCount = 1;
+	viewInfo.subresourceRange.baseArrayLayer = 0;
+	viewInfo.subresourceRange.layerCount = layerCount;
+
+	if (vkCreateImageView(renderer.GetLogicalDevice(), &viewInfo, nullptr, &imageView) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create ocean heightmap image view");
+	}
+}
+
+void OceanHeightmap::RecordLayoutTransition(VkCommandBuffer commandBuffer, VkImageLayout oldLayout, VkImageLayout newLayout,
+	VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+	VkImageMemoryBarrier barrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+	barrier.oldLayout = oldLayout;
+	barrier.newLayout = newLayout;
+	barrier.srcAccessMask = srcAccess;
+	barrier.dstAccessMask = dstAccess;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = layerCount;
+
+	vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Buffer.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "vulkan/vulkan.h"
+
+class Ocean;
+class Renderer;
+
+// GPU copy of an Ocean's output: one RGBA32F 2D array image with two layers per cascade, the
+// displacement in layer 2c and the normal in layer 2c + 1. Each update is written into the current
+// frame's region of a persistently mapped staging buffer and copied into the image by a transfer
+// recorded into the frame's command buffer. With one region per frame in flight, the simulation never
+// waits on the GPU beyond the usual frame fence.
+class OceanHeightmap
+{
+public:
+	OceanHeightmap(Renderer& renderer, const Ocean& ocean);
+	~OceanHeightmap();
+
+	OceanHeightmap(const OceanHeightmap&) = delete;
+	void operator=(const OceanHeightmap&) = delete;
+
+	// Copies the latest simulation results into the current frame's staging region, which the frame's
+	// fence has already freed
+	void Stage(const Ocean& ocean);
+	// Records the copy from the region Stage filled this frame, leaving the image ready for sampling in
+	// vertex and fragment shaders
+	void RecordUpload(VkCommandBuffer commandBuffer);
+
+	VkImage GetImage() const;
+	VkImageView GetImageView() const;
+	uint32_t GetLayerCount() const;
+private:
+	void CreateImage();
+	void CreateImageView();
+	VkDeviceSize GetStagingOffset() const;
+	void RecordLayoutTransition(VkCommandBuffer commandBuffer, VkImageLayout oldLayout, VkImageLayout newLayout,
+		VkPipelineStageFlags srcStage, VkAccessFlags srcAccess, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+private:
+	Renderer& renderer;
+	uint32_t resolution;
+	uint32_t layerCount;
+	// bytes of one frame's copy of every layer
+	VkDeviceSize stagingRegionSize;
+	bool bInitialized = false;
+
+	VkImage image;
+	VkDeviceMemory imageMemory;
+	VkImageView imageView;
+	// Renderer::kMaxFramesInFlight regions, one per frame that may still be copying from it
+	Buffer staging;
+};
@@ -1,25 +1,76 @@
 #include "Pipeline.h"
 
+#include "FileUtils.h"
+#include "ShaderModuleCache.h"
+#include "ShaderReflection.h"
+
 #include <vulkan/vulkan.h>
 
-#include <fstream>
 #include <iostream>
+#include <stdexcept>
+
+static ShaderReflection Reflect(const std::vector<uint32_t>& spirv, const VkSpecializationInfo* specialization)
+{
+    ShaderReflection reflection;
+    std::string error;
+    if (!ReflectShader(spirv, reflection, error, specialization))
+    {
+        throw std::runtime_error("failed to reflect shader: " + error);
+    }
+    return reflection;
+}
 
 Pipeline::Pipeline(Renderer& renderer, const PipelineConfigInfo& configInfo, const std::string& vertFilepath, const std::string& fragFilepath)
     : renderer(renderer), configInfo(configInfo)
 {
     CreateRenderPass();
-    CreateGraphicsPipeline(vertFilepath, fragFilepath);
+    CreateGraphicsPipeline(ReadSpirvFile(vertFilepath), ReadSpirvFile(fragFilepath));
+}
+
+Pipeline::Pipeline(Renderer& renderer, const PipelineConfigInfo& configInfo, const std::vector<uint32_t>& vertSpirv, const std::vector<uint32_t>& fragSpirv,
+    const ShaderSpecialization& vertSpecialization, const ShaderSpecialization& fragSpecialization)
+    : renderer(renderer), configInfo(configInfo), vertSpecialization(vertSpecialization), fragSpecialization(fragSpecialization)
+{
+    CreateRenderPass();
+    CreateGraphicsPipeline(vertSpirv, fragSpirv);
 }
 
 Pipeline::~Pipeline()
 {
-    vkDestroyPipelineLayout(renderer.GetLogicalDevice(), pipelineLayout, nullptr);
     vkDestroyRenderPass(renderer.GetLogicalDevice(), renderPass, nullptr);
     vkDestroyPipeline(renderer.GetLogicalDevice(), graphicsPipeline, nullptr);
 }
 
-PipelineConfigInfo Pipeline::DefaultPipelineConfigInfo()
+void Pipeline::Rebuild(const std::vector<uint32_t>& vertSpirv, const std::vector<uint32_t>& fragSpirv)
+{
+    const VkPipeline oldPipeline = graphicsPipeline;
+
+    CreateGraphicsPipeline(vertSpirv, fragSpirv);
+
+    // the layout belongs to the renderer's cache and outlives both pipelines
+    const VkDevice device = renderer.GetLogicalDevice();
+    renderer.DeferDestroy([device, oldPipeline]()
+    {
+        vkDestroyPipeline(device, oldPipeline, nullptr);
+    });
+}
+
+VkPipeline Pipeline::GetPipeline() const
+{
+    return graphicsPipeline;
+}
+
+VkPipelineLayout Pipeline::GetPipelineLayout() const
+{
+    return pipelineLayout;
+}
+
+const std::vector<VkDescriptorSetLayout>& Pipeline::GetDescriptorSetLayouts() const
+{
+    return descriptorSetLayouts;
+}
+
+PipelineConfigInfo Pipeline::DefaultPipelineConfigInfo(const ExtendedDynamicState& extendedDynamicState)
 {
     PipelineConfigInfo configInfo{};
 
@@ -63,6 +114,15 @@ PipelineConfigInfo Pipeline::DefaultPipelineConfigInfo()
     configInfo.colorBlendInfo.blendConstants[2] = 0.0f;
     configInfo.colorBlendInfo.blendConstants[3] = 0.0f;
 
+    configInfo.colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    configInfo.colorBlendAttachment.blendEnable = VK_FALSE;
+    configInfo.colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+    configInfo.colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+    configInfo.colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+    configInfo.colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    configInfo.colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    configInfo.colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
     configInfo.depthStencilInfo = { VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO };
     configInfo.depthStencilInfo.depthTestEnable = VK_TRUE;
     configInfo.depthStencilInfo.depthWriteEnable = VK_TRUE;
@@ -79,6 +139,40 @@ PipelineConfigInfo Pipeline::DefaultPipelineConfigInfo()
         VK_DYNAMIC_STATE_SCISSOR,
     };
 
+    /* Extended Dynamic State, where the device supports it */
+#ifdef VK_EXT_extended_dynamic_state
+    if (extendedDynamicState.cmdSetCullMode)
+    {
+        configInfo.dynamicStates.insert(configInfo.dynamicStates.end(), {
+            VK_DYNAMIC_STATE_CULL_MODE_EXT,
+            VK_DYNAMIC_STATE_FRONT_FACE_EXT,
+            VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_EXT,
+            VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT,
+            VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT,
+            VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT,
+        });
+    }
+#endif
+#ifdef VK_EXT_extended_dynamic_state2
+    if (extendedDynamicState.cmdSetDepthBiasEnable)
+    {
+        configInfo.dynamicStates.insert(configInfo.dynamicStates.end(), {
+            VK_DYNAMIC_STATE_DEPTH_BIAS_ENABLE_EXT,
+            VK_DYNAMIC_STATE_PRIMITIVE_RESTART_ENABLE_EXT,
+        });
+    }
+#endif
+#ifdef VK_EXT_extended_dynamic_state3
+    if (extendedDynamicState.cmdSetColorBlendEnable)
+    {
+        configInfo.dynamicStates.push_back(VK_DYNAMIC_STATE_COLOR_BLEND_ENABLE_EXT);
+    }
+    if (extendedDynamicState.cmdSetColorBlendEquation)
+    {
+        configInfo.dynamicStates.push_back(VK_DYNAMIC_STATE_COLOR_BLEND_EQUATION_EXT);
+    }
+#endif
+
     configInfo.dynamicStateInfo = { VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO };
     configInfo.dynamicStateInfo.dynamicStateCount = static_cast<uint32_t>(configInfo.dynamicStates.size());
     configInfo.dynamicStateInfo.pDynamicStates = configInfo.dynamicStates.data();
@@ -88,37 +182,64 @@ PipelineConfigInfo Pipeline::DefaultPipelineConfigInfo()
     return configInfo;
 }
 
-VkShaderModule Pipeline::CreateShaderModule(const std::vector<char>& code)
+void Pipeline::SetExtendedDynamicState(VkCommandBuffer commandBuffer, const ExtendedDynamicState& extendedDynamicState, const PipelineConfigInfo& configInfo)
 {
-    VkShaderModuleCreateInfo createInfo = { VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO };
-    createInfo.codeSize = code.size();
-    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-
-    VkShaderModule shaderModule;
-    if (vkCreateShaderModule(renderer.GetLogicalDevice(), &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
+    std::vector<VkDynamicState> dynamicStates = configInfo.dynamicStates;
+    if (dynamicStates.empty() && configInfo.dynamicStateInfo.pDynamicStates)
     {
-        throw std::runtime_error("failed to create shader module");
+        dynamicStates.assign(configInfo.dynamicStateInfo.pDynamicStates, configInfo.dynamicStateInfo.pDynamicStates + configInfo.dynamicStateInfo.dynamicStateCount);
     }
 
-    return shaderModule;
-}
-
-static std::vector<char> ReadFile(const std::string& filename) {
-    std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-    if (!file.is_open())
+    for (VkDynamicState state : dynamicStates)
     {
-        throw std::runtime_error("failed to open file!");
+        switch (state)
+        {
+#ifdef VK_EXT_extended_dynamic_state
+        case VK_DYNAMIC_STATE_CULL_MODE_EXT:
+            extendedDynamicState.cmdSetCullMode(commandBuffer, configInfo.rasterizationInfo.cullMode);
+            break;
+        case VK_DYNAMIC_STATE_FRONT_FACE_EXT:
+            extendedDynamicState.cmdSetFrontFace(commandBuffer, configInfo.rasterizationInfo.frontFace);
+            break;
+        case VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_EXT:
+            extendedDynamicState.cmdSetPrimitiveTopology(commandBuffer, configInfo.inputAssemblyInfo.topology);
+            break;
+        case VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT:
+            extendedDynamicState.cmdSetDepthTestEnable(commandBuffer, configInfo.depthStencilInfo.depthTestEnable);
+            break;
+        case VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT:
+            extendedDynamicState.cmdSetDepthWriteEnable(commandBuffer, configInfo.depthStencilInfo.depthWriteEnable);
+            break;
+        case VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT:
+            extendedDynamicState.cmdSetDepthCompareOp(commandBuffer, configInfo.depthStencilInfo.depthCompareOp);
+            break;
+#endif
+#ifdef VK_EXT_extended_dynamic_state2
+        case VK_DYNAMIC_STATE_DEPTH_BIAS_ENABLE_EXT:
+            extendedDynamicState.cmdSetDepthBiasEnable(commandBuffer, configInfo.rasterizationInfo.depthBiasEnable);
+            break;
+        case VK_DYNAMIC_STATE_PRIMITIVE_RESTART_ENABLE_EXT:
+            extendedDynamicState.cmdSetPrimitiveRestartEnable(commandBuffer, configInfo.inputAssemblyInfo.primitiveRestartEnable);
+            break;
+#endif
+#ifdef VK_EXT_extended_dynamic_state3
+        case VK_DYNAMIC_STATE_COLOR_BLEND_ENABLE_EXT:
+            extendedDynamicState.cmdSetColorBlendEnable(commandBuffer, 0, 1, &configInfo.colorBlendAttachment.blendEnable);
+            break;
+        case VK_DYNAMIC_STATE_COLOR_BLEND_EQUATION_EXT:
+        {
+            const VkPipelineColorBlendAttachmentState& blend = configInfo.colorBlendAttachment;
+            const VkColorBlendEquationEXT equation = { blend.srcColorBlendFactor, blend.dstColorBlendFactor, blend.colorBlendOp,
+                blend.srcAlphaBlendFactor, blend.dstAlphaBlendFactor, blend.alphaBlendOp };
+            extendedDynamicState.cmdSetColorBlendEquation(commandBuffer, 0, 1, &equation);
+            break;
+        }
+#endif
+        default:
+            // viewport, scissor and the other classic states are set by the caller
+            break;
+        }
     }
-
-    size_t fileSize = (size_t) file.tellg();
-    std::vector<char> buffer(fileSize);
-
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
-    file.close();
-
-    return buffer;
 }
 
 void Pipeline::CreateRenderPass()
@@ -156,59 +277,60 @@ void Pipeline::CreateRenderPass()
     }
 }
 
-void Pipeline::CreateGraphicsPipeline(const std::string& vertFilepath, const std::string& fragFilepath)
+void Pipeline::CreateGraphicsPipeline(const std::vector<uint32_t>& vertSpirv, const std::vector<uint32_t>& fragSpirv)
 {
-    /* Programmable Stages */
-    const std::vector<char> vertexCode = ReadFile(vertFilepath);
-    const std::vector<char> fragmentCode = ReadFile(fragFilepath);
-
-    VkShaderModule vertexShaderModule = CreateShaderModule(vertexCode);
-    VkShaderModule fragmentShaderModule = CreateShaderModule(fragmentCode);
+    /* Reflection, with array lengths as specialized */
+    const VkSpecializationInfo vertSpecializationInfo = vertSpecialization.GetInfo();
+    const VkSpecializationInfo fragSpecializationInfo = fragSpecialization.GetInfo();
+    const ShaderReflection vertReflection = Reflect(vertSpirv, vertSpecialization.IsEmpty() ? nullptr : &vertSpecializationInfo);
+    const ShaderReflection fragReflection = Reflect(fragSpirv, fragSpecialization.IsEmpty() ? nullptr : &fragSpecializationInfo);
+    const PipelineLayoutDescription layoutDescription = MergeShaderReflections({ vertReflection, fragReflection });
+
+    /* Programmable Stages, shared with every pipeline built from the same SPIR-V */
+    ShaderModuleCache& shaderModuleCache = renderer.GetShaderModuleCache();
+    std::shared_ptr<const ShaderModule> newVertModule = shaderModuleCache.Acquire(vertSpirv);
+    std::shared_ptr<const ShaderModule> newFragModule = shaderModuleCache.Acquire(fragSpirv);
 
     VkPipelineShaderStageCreateInfo vertShaderStageInfo = { VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO };
     vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vertShaderStageInfo.module = vertexShaderModule;
     vertShaderStageInfo.pName = "main";
+    newVertModule->FillStageInfo(vertShaderStageInfo);
 
     VkPipelineShaderStageCreateInfo fragShaderStageInfo = { VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO };
     fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragShaderStageInfo.module = fragmentShaderModule;
     fragShaderStageInfo.pName = "main";
+    newFragModule->FillStageInfo(fragShaderStageInfo);
+
+    vertShaderStageInfo.pSpecializationInfo = vertSpecialization.IsEmpty() ? nullptr : &vertSpecializationInfo;
+    fragShaderStageInfo.pSpecializationInfo = fragSpecialization.IsEmpty() ? nullptr : &fragSpecializationInfo;
 
     VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
 
     /* Fixed Function Stages */
-    VkPipelineVertexInputStateCreateInfo vertexInputInfo = { VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO };
-    vertexInputInfo.vertexAttributeDescriptionCount = 0;
-    vertexInputInfo.vertexBindingDescriptionCount = 0;
-    vertexInputInfo.pVertexAttributeDescriptions = nullptr;
-    vertexInputInfo.pVertexBindingDescriptions = nullptr;
-
-    /* Pipeline Layout */
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo = { VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
-    pipelineLayoutInfo.setLayoutCount = 0;
-    pipelineLayoutInfo.pSetLayouts = nullptr;
-    pipelineLayoutInfo.pushConstantRangeCount = 0;
-    pipelineLayoutInfo.pPushConstantRanges = nullptr;
-
-    if (vkCreatePipelineLayout(renderer.GetLogicalDevice(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+    std::vector<VkVertexInputBindingDescription> bindingDescriptions = configInfo.bindingDescriptions;
+    std::vector<VkVertexInputAttributeDescription> attributeDescriptions = configInfo.attributeDescriptions;
+    if (attributeDescriptions.empty())
     {
-        std::cerr << "Failed to create pipeline layout\n";
+        GetPackedVertexInput(vertReflection, bindingDescriptions, attributeDescriptions);
     }
 
-    /* Blend Attachment - TODO: move this to a dynamic section? */
-    VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
-    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable = VK_FALSE;
-    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
-    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
-    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo = { VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO };
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
+    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+    vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
+
+    /* Pipeline Layout, shared with every pipeline whose shaders declare the same resources */
+    descriptorSetLayouts.clear();
+    for (const std::vector<VkDescriptorSetLayoutBinding>& setBindings : layoutDescription.setBindings)
+    {
+        descriptorSetLayouts.push_back(renderer.GetDescriptorSetLayout(setBindings));
+    }
+    pipelineLayout = renderer.GetPipelineLayout(descriptorSetLayouts, layoutDescription.pushConstantRanges);
 
+    /* Blend Attachment, from the config; its enable and equation may be dynamic */
     configInfo.colorBlendInfo.attachmentCount = 1;
-    configInfo.colorBlendInfo.pAttachments = &colorBlendAttachment;
+    configInfo.colorBlendInfo.pAttachments = &configInfo.colorBlendAttachment;
 
     /* configInfo.viewport.x = 0.0f;
     configInfo.viewport.y = 0.0f;
@@ -219,6 +341,22 @@ void Pipeline::CreateGraphicsPipeline(const std::string& vertFilepath, const std
     configInfo.viewportInfo.pViewports = &configInfo.viewport;
     configInfo.viewportInfo.pScissors = &configInfo.scissor; */
 
+    // the create infos still point into the config this one was copied from; static viewport and
+    // scissor state always comes from the config's own viewport and scissor
+    if (!configInfo.dynamicStates.empty())
+    {
+        configInfo.dynamicStateInfo.dynamicStateCount = static_cast<uint32_t>(configInfo.dynamicStates.size());
+        configInfo.dynamicStateInfo.pDynamicStates = configInfo.dynamicStates.data();
+    }
+    if (configInfo.viewportInfo.pViewports)
+    {
+        configInfo.viewportInfo.pViewports = &configInfo.viewport;
+    }
+    if (configInfo.viewportInfo.pScissors)
+    {
+        configInfo.viewportInfo.pScissors = &configInfo.scissor;
+    }
+
     /* Pipeline Creation */
     VkGraphicsPipelineCreateInfo pipelineInfo = { VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO };
     pipelineInfo.stageCount = 2;
@@ -237,11 +375,12 @@ void Pipeline::CreateGraphicsPipeline(const std::string& vertFilepath, const std
     pipelineInfo.basePipelineIndex = -1;
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-    if (vkCreateGraphicsPipelines(renderer.GetLogicalDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
+    if (vkCreateGraphicsPipelines(renderer.GetLogicalDevice(), renderer.GetPipelineCache(), 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
     {
         std::cerr << "Failed to create graphics pipeline\n";
     }
 
-    vkDestroyShaderModule(renderer.GetLogicalDevice(), vertexShaderModule, nullptr);
-    vkDestroyShaderModule(renderer.GetLogicalDevice(), fragmentShaderModule, nullptr);
+    // keeps the modules alive for pipelines that share a stage; a rebuild releases the old ones here
+    vertModule = std::move(newVertModule);
+    fragModule = std::move(newFragModule);
 }
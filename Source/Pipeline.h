@@ -1,17 +1,22 @@
 #pragma once
 
 #include "Renderer.h"
+#include "ShaderPermutations.h"
 
+#include <memory>
 #include <stdint.h>
 #include <string>
 #include <vector>
 
 #include "vulkan/vulkan.h"
 
+class ShaderModule;
+
 // This abstraction is usefule because we want our application to be able to 
 // configure the pipeline deeply, as well as share configurations between pipelines
 struct PipelineConfigInfo 
 {
+    // used for static viewport and scissor state, which is flagged by a non-null pViewports or pScissors
     VkViewport viewport;
     VkRect2D scissor;
     VkPipelineViewportStateCreateInfo viewportInfo;
@@ -19,29 +24,56 @@ struct PipelineConfigInfo
     VkPipelineRasterizationStateCreateInfo rasterizationInfo;
     VkPipelineMultisampleStateCreateInfo multisampleInfo;
     VkPipelineColorBlendStateCreateInfo colorBlendInfo;
+    // the single color attachment's blend state; colorBlendInfo.pAttachments is not read
+    VkPipelineColorBlendAttachmentState colorBlendAttachment;
     VkPipelineDepthStencilStateCreateInfo depthStencilInfo;
     VkPipelineDynamicStateCreateInfo dynamicStateInfo;
     std::vector<VkDynamicState> dynamicStates;
+    // left empty to derive a packed layout from the vertex shader's inputs
+    std::vector<VkVertexInputBindingDescription> bindingDescriptions;
+    std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
 };
 
 class Pipeline 
 {
 public:
     Pipeline(Renderer& renderer, const PipelineConfigInfo& configInfo, const std::string& vertFilepath, const std::string& fragFilepath);
+    Pipeline(Renderer& renderer, const PipelineConfigInfo& configInfo, const std::vector<uint32_t>& vertSpirv, const std::vector<uint32_t>& fragSpirv,
+        const ShaderSpecialization& vertSpecialization = {}, const ShaderSpecialization& fragSpecialization = {});
     virtual ~Pipeline();
 
     Pipeline(const Pipeline&) = delete;
     void operator=(const Pipeline&) = delete;
 
-    static PipelineConfigInfo DefaultPipelineConfigInfo();
+    // Builds a new pipeline from the given stages and hands the old one to Renderer::DeferDestroy, so
+    // frames still in flight keep drawing with it. The render pass and specialization are kept.
+    void Rebuild(const std::vector<uint32_t>& vertSpirv, const std::vector<uint32_t>& fragSpirv);
+
+    VkPipeline GetPipeline() const;
+    VkPipelineLayout GetPipelineLayout() const;
+    // indexed by set number, as reflected from the shaders; owned by the renderer
+    const std::vector<VkDescriptorSetLayout>& GetDescriptorSetLayouts() const;
+
+    // Given the renderer's extended dynamic state, also leaves every raster state the device can set
+    // from the command buffer out of the pipeline, so pipelines that differ only in that state share
+    // one VkPipeline. Draws then call SetExtendedDynamicState with the state they want.
+    static PipelineConfigInfo DefaultPipelineConfigInfo(const ExtendedDynamicState& extendedDynamicState = {});
+    // Records the config's values for each of its dynamic states that ExtendedDynamicState covers;
+    // call after binding the pipeline and before drawing
+    static void SetExtendedDynamicState(VkCommandBuffer commandBuffer, const ExtendedDynamicState& extendedDynamicState, const PipelineConfigInfo& configInfo);
 private:
-    VkShaderModule CreateShaderModule(const std::vector<char>& code);
     void CreateRenderPass();
-    void CreateGraphicsPipeline(const std::string& vertFilepath, const std::string& fragFilepath);
+    // the pipeline layout and vertex input come from reflecting the two stages
+    void CreateGraphicsPipeline(const std::vector<uint32_t>& vertSpirv, const std::vector<uint32_t>& fragSpirv);
 private:
     Renderer& renderer;
     PipelineConfigInfo configInfo;
+    ShaderSpecialization vertSpecialization;
+    ShaderSpecialization fragSpecialization;
+    std::shared_ptr<const ShaderModule> vertModule;
+    std::shared_ptr<const ShaderModule> fragModule;
     VkRenderPass renderPass;
     VkPipeline graphicsPipeline;
     VkPipelineLayout pipelineLayout;
+    std::vector<VkDescriptorSetLayout> descriptorSetLayouts;
 };
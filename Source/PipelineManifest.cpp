@@ -0,0 +1,362 @@
+#include "PipelineManifest.h"
+
+#include "FileUtils.h"
+#include "Hash.h"
+
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+
+// bump when the record layout changes, so old manifests are ignored rather than misread
+static constexpr uint32_t kManifestMagic = 0x4d4f5350; // "PSOM"
+static constexpr uint32_t kManifestVersion = 3;
+
+struct ManifestHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint64_t bodySize;
+	uint64_t bodyHash;
+};
+
+class ManifestWriter
+{
+public:
+	template <typename T>
+	void Write(const T& value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "only plain values are written as bytes");
+		bytes.append(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	template <typename T>
+	void WriteVector(const std::vector<T>& values)
+	{
+		Write(static_cast<uint32_t>(values.size()));
+		if (values.empty())
+		{
+			return;
+		}
+		bytes.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+	}
+
+	const std::string& GetBytes() const
+	{
+		return bytes;
+	}
+private:
+	std::string bytes;
+};
+
+// Every read is bounds checked; once one fails the rest fail too and IsValid reports it
+class ManifestReader
+{
+public:
+	ManifestReader(const char* data, size_t size)
+		: data(data), size(size)
+	{
+	}
+
+	template <typename T>
+	bool Read(T& outValue)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "only plain values are read as bytes");
+		if (!bValid || size - offset < sizeof(T))
+		{
+			bValid = false;
+			return false;
+		}
+		std::memcpy(&outValue, data + offset, sizeof(T));
+		offset += sizeof(T);
+		return true;
+	}
+
+	template <typename T>
+	bool ReadVector(std::vector<T>& outValues)
+	{
+		uint32_t count = 0;
+		if (!Read(count) || (size - offset) / sizeof(T) < count)
+		{
+			bValid = false;
+			return false;
+		}
+		outValues.resize(count);
+		if (count > 0)
+		{
+			std::memcpy(outValues.data(), data + offset, count * sizeof(T));
+		}
+		offset += count * sizeof(T);
+		return true;
+	}
+
+	bool IsValid() const
+	{
+		return bValid;
+	}
+
+	bool IsAtEnd() const
+	{
+		return offset == size;
+	}
+private:
+	const char* data;
+	size_t size;
+	size_t offset = 0;
+	bool bValid = true;
+};
+
+static std::vector<VkDynamicState> GetDynamicStates(const PipelineConfigInfo& configInfo)
+{
+	if (configInfo.dynamicStates.empty() && configInfo.dynamicStateInfo.pDynamicStates)
+	{
+		return std::vector<VkDynamicState>(configInfo.dynamicStateInfo.pDynamicStates, configInfo.dynamicStateInfo.pDynamicStates + configInfo.dynamicStateInfo.dynamicStateCount);
+	}
+	return configInfo.dynamicStates;
+}
+
+// Create infos are stored whole with their pointers cleared; the pointers are restored on load
+template <typename T>
+static void WriteCreateInfo(ManifestWriter& writer, T createInfo)
+{
+	createInfo.pNext = nullptr;
+	writer.Write(createInfo);
+}
+
+static void WriteConfig(ManifestWriter& writer, const PipelineConfigInfo& configInfo)
+{
+	writer.Write(configInfo.viewport);
+	writer.Write(configInfo.scissor);
+
+	VkPipelineViewportStateCreateInfo viewportInfo = configInfo.viewportInfo;
+	const uint8_t bStaticViewport = viewportInfo.pViewports != nullptr;
+	const uint8_t bStaticScissor = viewportInfo.pScissors != nullptr;
+	viewportInfo.pViewports = nullptr;
+	viewportInfo.pScissors = nullptr;
+	WriteCreateInfo(writer, viewportInfo);
+	writer.Write(bStaticViewport);
+	writer.Write(bStaticScissor);
+
+	WriteCreateInfo(writer, configInfo.inputAssemblyInfo);
+	WriteCreateInfo(writer, configInfo.rasterizationInfo);
+
+	VkPipelineMultisampleStateCreateInfo multisampleInfo = configInfo.multisampleInfo;
+	multisampleInfo.pSampleMask = nullptr;
+	WriteCreateInfo(writer, multisampleInfo);
+
+	// Pipeline uses the config's own attachment, so pAttachments is not read
+	VkPipelineColorBlendStateCreateInfo colorBlendInfo = configInfo.colorBlendInfo;
+	colorBlendInfo.attachmentCount = 0;
+	colorBlendInfo.pAttachments = nullptr;
+	WriteCreateInfo(writer, colorBlendInfo);
+	writer.Write(configInfo.colorBlendAttachment);
+
+	WriteCreateInfo(writer, configInfo.depthStencilInfo);
+
+	VkPipelineDynamicStateCreateInfo dynamicStateInfo = configInfo.dynamicStateInfo;
+	dynamicStateInfo.dynamicStateCount = 0;
+	dynamicStateInfo.pDynamicStates = nullptr;
+	WriteCreateInfo(writer, dynamicStateInfo);
+	writer.WriteVector(GetDynamicStates(configInfo));
+
+	writer.WriteVector(configInfo.bindingDescriptions);
+	writer.WriteVector(configInfo.attributeDescriptions);
+}
+
+static bool ReadConfig(ManifestReader& reader, PipelineConfigInfo& outConfigInfo)
+{
+	uint8_t bStaticViewport = 0;
+	uint8_t bStaticScissor = 0;
+	reader.Read(outConfigInfo.viewport);
+	reader.Read(outConfigInfo.scissor);
+	reader.Read(outConfigInfo.viewportInfo);
+	reader.Read(bStaticViewport);
+	reader.Read(bStaticScissor);
+	reader.Read(outConfigInfo.inputAssemblyInfo);
+	reader.Read(outConfigInfo.rasterizationInfo);
+	reader.Read(outConfigInfo.multisampleInfo);
+	reader.Read(outConfigInfo.colorBlendInfo);
+	reader.Read(outConfigInfo.colorBlendAttachment);
+	reader.Read(outConfigInfo.depthStencilInfo);
+	reader.Read(outConfigInfo.dynamicStateInfo);
+	reader.ReadVector(outConfigInfo.dynamicStates);
+	reader.ReadVector(outConfigInfo.bindingDescriptions);
+	reader.ReadVector(outConfigInfo.attributeDescriptions);
+	if (!reader.IsValid())
+	{
+		return false;
+	}
+
+	// only flags to Pipeline, which points them at its own copy of the config
+	outConfigInfo.viewportInfo.pViewports = bStaticViewport ? &outConfigInfo.viewport : nullptr;
+	outConfigInfo.viewportInfo.pScissors = bStaticScissor ? &outConfigInfo.scissor : nullptr;
+	outConfigInfo.dynamicStateInfo.dynamicStateCount = static_cast<uint32_t>(outConfigInfo.dynamicStates.size());
+	outConfigInfo.dynamicStateInfo.pDynamicStates = outConfigInfo.dynamicStates.data();
+	return true;
+}
+
+static void WriteSpecialization(ManifestWriter& writer, const ShaderSpecialization& specialization)
+{
+	writer.WriteVector(specialization.mapEntries);
+	writer.WriteVector(specialization.data);
+}
+
+static bool ReadSpecialization(ManifestReader& reader, ShaderSpecialization& outSpecialization)
+{
+	reader.ReadVector(outSpecialization.mapEntries);
+	reader.ReadVector(outSpecialization.data);
+	return reader.IsValid();
+}
+
+bool IsPipelineDescribable(const PipelineConfigInfo& configInfo)
+{
+	if (configInfo.viewportInfo.pNext || configInfo.inputAssemblyInfo.pNext || configInfo.rasterizationInfo.pNext || configInfo.multisampleInfo.pNext
+		|| configInfo.colorBlendInfo.pNext || configInfo.depthStencilInfo.pNext || configInfo.dynamicStateInfo.pNext)
+	{
+		return false;
+	}
+
+	if ((configInfo.viewportInfo.pViewports && configInfo.viewportInfo.viewportCount > 1) || (configInfo.viewportInfo.pScissors && configInfo.viewportInfo.scissorCount > 1))
+	{
+		return false;
+	}
+
+	if (configInfo.multisampleInfo.pSampleMask)
+	{
+		const uint32_t sampleMaskWords = (static_cast<uint32_t>(configInfo.multisampleInfo.rasterizationSamples) + 31) / 32;
+		for (uint32_t i = 0; i < sampleMaskWords; ++i)
+		{
+			if (configInfo.multisampleInfo.pSampleMask[i] != ~0u)
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool SavePipelineManifest(const std::string& path, const std::vector<const PipelineDescription*>& descriptions)
+{
+	/* Stages, each distinct SPIR-V once */
+	std::vector<const std::vector<uint32_t>*> shaders;
+	std::unordered_map<const std::vector<uint32_t>*, uint32_t> shaderIndices;
+	auto getShaderIndex = [&shaders, &shaderIndices](const std::shared_ptr<const std::vector<uint32_t>>& spirv)
+	{
+		auto [existing, bInserted] = shaderIndices.emplace(spirv.get(), static_cast<uint32_t>(shaders.size()));
+		if (bInserted)
+		{
+			shaders.push_back(spirv.get());
+		}
+		return existing->second;
+	};
+
+	ManifestWriter records;
+	for (const PipelineDescription* description : descriptions)
+	{
+		records.Write(getShaderIndex(description->vertSpirv));
+		records.Write(getShaderIndex(description->fragSpirv));
+		WriteSpecialization(records, description->vertSpecialization);
+		WriteSpecialization(records, description->fragSpecialization);
+		records.Write(description->colorFormat);
+		records.Write(description->unusedRuns);
+		WriteConfig(records, description->configInfo);
+	}
+
+	ManifestWriter body;
+	body.Write(static_cast<uint32_t>(shaders.size()));
+	for (const std::vector<uint32_t>* spirv : shaders)
+	{
+		body.WriteVector(*spirv);
+	}
+	body.Write(static_cast<uint32_t>(descriptions.size()));
+	std::string contents = body.GetBytes() + records.GetBytes();
+
+	ManifestHeader header{};
+	header.magic = kManifestMagic;
+	header.version = kManifestVersion;
+	header.bodySize = contents.size();
+	header.bodyHash = HashBytes(contents.data(), contents.size());
+	contents.insert(0, reinterpret_cast<const char*>(&header), sizeof(header));
+
+	return WriteFileAtomic(path, contents.data(), contents.size());
+}
+
+bool LoadPipelineManifest(const std::string& path, std::vector<PipelineDescription>& outDescriptions, std::string& outError)
+{
+	std::vector<char> contents;
+	try
+	{
+		contents = ReadFile(path);
+	}
+	catch (const std::runtime_error& error)
+	{
+		outError = error.what();
+		return false;
+	}
+
+	ManifestHeader header;
+	if (contents.size() < sizeof(header))
+	{
+		outError = "file too small";
+		return false;
+	}
+	std::memcpy(&header, contents.data(), sizeof(header));
+
+	const char* body = contents.data() + sizeof(header);
+	const size_t bodySize = contents.size() - sizeof(header);
+	if (header.magic != kManifestMagic || header.version != kManifestVersion)
+	{
+		outError = "not a manifest of this version";
+		return false;
+	}
+	if (header.bodySize != bodySize || header.bodyHash != HashBytes(body, bodySize))
+	{
+		outError = "truncated or corrupted";
+		return false;
+	}
+
+	ManifestReader reader(body, bodySize);
+
+	uint32_t shaderCount = 0;
+	reader.Read(shaderCount);
+	std::vector<std::shared_ptr<const std::vector<uint32_t>>> shaders;
+	for (uint32_t i = 0; i < shaderCount && reader.IsValid(); ++i)
+	{
+		std::vector<uint32_t> spirv;
+		reader.ReadVector(spirv);
+		shaders.push_back(std::make_shared<const std::vector<uint32_t>>(std::move(spirv)));
+	}
+
+	uint32_t pipelineCount = 0;
+	reader.Read(pipelineCount);
+	std::vector<PipelineDescription> descriptions;
+	for (uint32_t i = 0; i < pipelineCount && reader.IsValid(); ++i)
+	{
+		PipelineDescription description;
+		uint32_t vertShader = 0;
+		uint32_t fragShader = 0;
+		reader.Read(vertShader);
+		reader.Read(fragShader);
+		ReadSpecialization(reader, description.vertSpecialization);
+		ReadSpecialization(reader, description.fragSpecialization);
+		reader.Read(description.colorFormat);
+		reader.Read(description.unusedRuns);
+		if (!ReadConfig(reader, description.configInfo) || vertShader >= shaders.size() || fragShader >= shaders.size())
+		{
+			outError = "malformed record";
+			return false;
+		}
+		description.vertSpirv = shaders[vertShader];
+		description.fragSpirv = shaders[fragShader];
+		descriptions.push_back(std::move(description));
+	}
+
+	if (!reader.IsValid() || !reader.IsAtEnd())
+	{
+		outError = "malformed manifest";
+		return false;
+	}
+
+	outDescriptions = std::move(descriptions);
+	return true;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Pipeline.h"
+#include "ShaderPermutations.h"
+
+#include <memory>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+// Everything needed to create one pipeline again in a later run
+struct PipelineDescription
+{
+	PipelineConfigInfo configInfo;
+	// shared between the descriptions of one manifest, so each stage is stored once
+	std::shared_ptr<const std::vector<uint32_t>> vertSpirv;
+	std::shared_ptr<const std::vector<uint32_t>> fragSpirv;
+	ShaderSpecialization vertSpecialization;
+	ShaderSpecialization fragSpecialization;
+	// the render pass format the pipeline was built for
+	VkFormat colorFormat = VK_FORMAT_UNDEFINED;
+	// runs since one last requested the pipeline, so unused entries can age out
+	uint32_t unusedRuns = 0;
+};
+
+// Whether a config survives the round trip through a manifest: no pNext chains, at most one static
+// viewport and scissor (taken from the config's own members) and no partial sample mask
+bool IsPipelineDescribable(const PipelineConfigInfo& configInfo);
+
+// The manifest is one binary file: a header, each distinct stage's SPIR-V once, then one compact record
+// per pipeline that refers to its stages by index. Written atomically, so a crash keeps the old one.
+bool SavePipelineManifest(const std::string& path, const std::vector<const PipelineDescription*>& descriptions);
+// Fails on a missing, truncated or foreign file; a manifest is only a hint, so callers carry on without it
+bool LoadPipelineManifest(const std::string& path, std::vector<PipelineDescription>& outDescriptions, std::string& outError);
@@ -0,0 +1,707 @@
+#include "PipelineRegistry.h"
+
+#include "Hash.h"
+#include "Renderer.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+
+template <typename T>
+static void AppendKey(std::string& key, const T& value)
+{
+	key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// Extension structs the key does not understand could change anything, so their address goes into
+// the key instead: such a state only ever matches itself
+static void AppendNext(std::string& key, const void* pNext)
+{
+	AppendKey(key, pNext);
+}
+
+// The vector is what Pipeline builds from; the create info is only read when the vector is empty
+static std::vector<VkDynamicState> GetDynamicStates(const PipelineConfigInfo& configInfo)
+{
+	std::vector<VkDynamicState> dynamicStates = configInfo.dynamicStates;
+	if (dynamicStates.empty() && configInfo.dynamicStateInfo.pDynamicStates)
+	{
+		dynamicStates.assign(configInfo.dynamicStateInfo.pDynamicStates, configInfo.dynamicStateInfo.pDynamicStates + configInfo.dynamicStateInfo.dynamicStateCount);
+	}
+
+	std::sort(dynamicStates.begin(), dynamicStates.end());
+	dynamicStates.erase(std::unique(dynamicStates.begin(), dynamicStates.end()), dynamicStates.end());
+	return dynamicStates;
+}
+
+// The extended dynamic states, or a value no config lists where the headers predate them
+#ifdef VK_EXT_extended_dynamic_state
+static constexpr VkDynamicState kDynamicCullMode = VK_DYNAMIC_STATE_CULL_MODE_EXT;
+static constexpr VkDynamicState kDynamicFrontFace = VK_DYNAMIC_STATE_FRONT_FACE_EXT;
+static constexpr VkDynamicState kDynamicPrimitiveTopology = VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_EXT;
+static constexpr VkDynamicState kDynamicDepthTestEnable = VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT;
+static constexpr VkDynamicState kDynamicDepthWriteEnable = VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT;
+static constexpr VkDynamicState kDynamicDepthCompareOp = VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT;
+#else
+static constexpr VkDynamicState kDynamicCullMode = VK_DYNAMIC_STATE_MAX_ENUM;
+static constexpr VkDynamicState kDynamicFrontFace = VK_DYNAMIC_STATE_MAX_ENUM;
+static constexpr VkDynamicState kDynamicPrimitiveTopology = VK_DYNAMIC_STATE_MAX_ENUM;
+static constexpr VkDynamicState kDynamicDepthTestEnable = VK_DYNAMIC_STATE_MAX_ENUM;
+static constexpr VkDynamicState kDynamicDepthWriteEnable = VK_DYNAMIC_STATE_MAX_ENUM;
+static constexpr VkDynamicState kDynamicDepthCompareOp = VK_DYNAMIC_STATE_MAX_ENUM;
+#endif
+#ifdef VK_EXT_extended_dynamic_state2
+static constexpr VkDynamicState kDynamicDepthBiasEnable = VK_DYNAMIC_STATE_DEPTH_BIAS_ENABLE_EXT;
+static constexpr VkDynamicState kDynamicPrimitiveRestartEnable = VK_DYNAMIC_STATE_PRIMITIVE_RESTART_ENABLE_EXT;
+#else
+static constexpr VkDynamicState kDynamicDepthBiasEnable = VK_DYNAMIC_STATE_MAX_ENUM;
+static constexpr VkDynamicState kDynamicPrimitiveRestartEnable = VK_DYNAMIC_STATE_MAX_ENUM;
+#endif
+#ifdef VK_EXT_extended_dynamic_state3
+static constexpr VkDynamicState kDynamicColorBlendEnable = VK_DYNAMIC_STATE_COLOR_BLEND_ENABLE_EXT;
+static constexpr VkDynamicState kDynamicColorBlendEquation = VK_DYNAMIC_STATE_COLOR_BLEND_EQUATION_EXT;
+#else
+static constexpr VkDynamicState kDynamicColorBlendEnable = VK_DYNAMIC_STATE_MAX_ENUM;
+static constexpr VkDynamicState kDynamicColorBlendEquation = VK_DYNAMIC_STATE_MAX_ENUM;
+#endif
+
+// Whether the device can set every state the config leaves dynamic. A manifest written on another
+// device or driver may list extended dynamic states this one does not have.
+static bool AreDynamicStatesSupported(const PipelineConfigInfo& configInfo, const ExtendedDynamicState& extendedDynamicState)
+{
+	for (VkDynamicState state : GetDynamicStates(configInfo))
+	{
+		bool bSupported = true;
+		switch (state)
+		{
+#ifdef VK_EXT_extended_dynamic_state
+		case VK_DYNAMIC_STATE_CULL_MODE_EXT: bSupported = extendedDynamicState.cmdSetCullMode != nullptr; break;
+		case VK_DYNAMIC_STATE_FRONT_FACE_EXT: bSupported = extendedDynamicState.cmdSetFrontFace != nullptr; break;
+		case VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_EXT: bSupported = extendedDynamicState.cmdSetPrimitiveTopology != nullptr; break;
+		case VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT: bSupported = extendedDynamicState.cmdSetDepthTestEnable != nullptr; break;
+		case VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT: bSupported = extendedDynamicState.cmdSetDepthWriteEnable != nullptr; break;
+		case VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT: bSupported = extendedDynamicState.cmdSetDepthCompareOp != nullptr; break;
+#endif
+#ifdef VK_EXT_extended_dynamic_state2
+		case VK_DYNAMIC_STATE_DEPTH_BIAS_ENABLE_EXT: bSupported = extendedDynamicState.cmdSetDepthBiasEnable != nullptr; break;
+		case VK_DYNAMIC_STATE_PRIMITIVE_RESTART_ENABLE_EXT: bSupported = extendedDynamicState.cmdSetPrimitiveRestartEnable != nullptr; break;
+#endif
+#ifdef VK_EXT_extended_dynamic_state3
+		case VK_DYNAMIC_STATE_COLOR_BLEND_ENABLE_EXT: bSupported = extendedDynamicState.cmdSetColorBlendEnable != nullptr; break;
+		case VK_DYNAMIC_STATE_COLOR_BLEND_EQUATION_EXT: bSupported = extendedDynamicState.cmdSetColorBlendEquation != nullptr; break;
+#endif
+		default: break;
+		}
+
+		if (!bSupported)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// A dynamic topology still has to be of the class the pipeline was created with
+static uint32_t GetTopologyClass(VkPrimitiveTopology topology)
+{
+	switch (topology)
+	{
+	case VK_PRIMITIVE_TOPOLOGY_POINT_LIST:
+		return 0;
+	case VK_PRIMITIVE_TOPOLOGY_LINE_LIST:
+	case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP:
+	case VK_PRIMITIVE_TOPOLOGY_LINE_LIST_WITH_ADJACENCY:
+	case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP_WITH_ADJACENCY:
+		return 1;
+	case VK_PRIMITIVE_TOPOLOGY_PATCH_LIST:
+		return 3;
+	default:
+		return 2;
+	}
+}
+
+static void AppendShader(std::string& key, const std::vector<uint32_t>& spirv, const ShaderSpecialization& specialization)
+{
+	AppendKey(key, HashBytes(spirv.data(), spirv.size() * sizeof(uint32_t)));
+
+	// map entries in constant order, so the same values listed in another order give the same key
+	std::vector<VkSpecializationMapEntry> mapEntries = specialization.mapEntries;
+	std::sort(mapEntries.begin(), mapEntries.end(),
+		[](const VkSpecializationMapEntry& a, const VkSpecializationMapEntry& b) { return a.constantID < b.constantID; });
+	AppendKey(key, static_cast<uint32_t>(mapEntries.size()));
+	for (const VkSpecializationMapEntry& entry : mapEntries)
+	{
+		AppendKey(key, entry.constantID);
+		AppendKey(key, static_cast<uint64_t>(entry.size));
+		const size_t end = std::min(specialization.data.size(), static_cast<size_t>(entry.offset) + entry.size);
+		for (size_t i = entry.offset; i < end; ++i)
+		{
+			AppendKey(key, specialization.data[i]);
+		}
+	}
+}
+
+bool PipelineHandle::IsReady() const
+{
+	return request && request->bDone.load(std::memory_order_acquire) && request->pipeline;
+}
+
+bool PipelineHandle::IsFailed() const
+{
+	return request && request->bDone.load(std::memory_order_acquire) && !request->pipeline;
+}
+
+Pipeline* PipelineHandle::GetForDraw() const
+{
+	return IsReady() ? request->pipeline.get() : fallback.get();
+}
+
+std::shared_ptr<Pipeline> PipelineHandle::Get() const
+{
+	return IsReady() ? request->pipeline : nullptr;
+}
+
+void PipelineHandle::Wait() const
+{
+	if (request)
+	{
+		request->completion.wait();
+	}
+}
+
+std::string PipelineHandle::GetError() const
+{
+	return IsFailed() ? request->error : "";
+}
+
+PipelineRegistry::PipelineRegistry(Renderer& renderer)
+	: renderer(renderer)
+{
+}
+
+PipelineRegistry::~PipelineRegistry()
+{
+	WaitIdle();
+}
+
+std::shared_ptr<Pipeline> PipelineRegistry::Get(const PipelineConfigInfo& configInfo, const std::vector<uint32_t>& vertSpirv, const std::vector<uint32_t>& fragSpirv,
+	const ShaderSpecialization& vertSpecialization, const ShaderSpecialization& fragSpecialization)
+{
+	const std::string key = GetKey(configInfo, vertSpirv, fragSpirv, vertSpecialization, fragSpecialization);
+	RecordPipeline(key, configInfo, vertSpirv, fragSpirv, vertSpecialization, fragSpecialization);
+	const std::shared_ptr<Slot> slot = GetSlot(key);
+
+	// create outside the registry lock so different keys build in parallel
+	std::unique_lock<std::mutex> slotLock(slot->mutex);
+	if (std::shared_ptr<Pipeline> pipeline = slot->pipeline.lock())
+	{
+		++hitCount;
+		return pipeline;
+	}
+
+	if (slot->pending)
+	{
+		const std::shared_ptr<PipelineHandle::Request> pending = slot->pending;
+		slotLock.unlock();
+		pending->completion.wait();
+		if (!pending->pipeline)
+		{
+			throw std::runtime_error(pending->error);
+		}
+		++hitCount;
+		return pending->pipeline;
+	}
+
+	++missCount;
+	std::shared_ptr<Pipeline> pipeline = std::make_shared<Pipeline>(renderer, configInfo, vertSpirv, fragSpirv, vertSpecialization, fragSpecialization);
+	slot->pipeline = pipeline;
+	return pipeline;
+}
+
+PipelineHandle PipelineRegistry::GetAsync(ThreadPool& threadPool, const std::shared_ptr<Pipeline>& fallback, const PipelineConfigInfo& configInfo,
+	const std::vector<uint32_t>& vertSpirv, const std::vector<uint32_t>& fragSpirv,
+	const ShaderSpecialization& vertSpecialization, const ShaderSpecialization& fragSpecialization)
+{
+	const std::string key = GetKey(configInfo, vertSpirv, fragSpirv, vertSpecialization, fragSpecialization);
+	RecordPipeline(key, configInfo, vertSpirv, fragSpirv, vertSpecialization, fragSpecialization);
+	return StartAsync(threadPool, fallback, key, configInfo, vertSpirv, fragSpirv, vertSpecialization, fragSpecialization);
+}
+
+PipelineHandle PipelineRegistry::StartAsync(ThreadPool& threadPool, const std::shared_ptr<Pipeline>& fallback, const std::string& key, const PipelineConfigInfo& configInfo,
+	const std::vector<uint32_t>& vertSpirv, const std::vector<uint32_t>& fragSpirv,
+	const ShaderSpecialization& vertSpecialization, const ShaderSpecialization& fragSpecialization)
+{
+	PipelineHandle handle;
+	handle.fallback = fallback;
+
+	const std::shared_ptr<Slot> slot = GetSlot(key);
+	std::lock_guard<std::mutex> slotLock(slot->mutex);
+	if (slot->pending)
+	{
+		++hitCount;
+		handle.request = slot->pending;
+		return handle;
+	}
+
+	handle.request = std::make_shared<PipelineHandle::Request>();
+	if (std::shared_ptr<Pipeline> pipeline = slot->pipeline.lock())
+	{
+		++hitCount;
+		std::promise<void> completion;
+		completion.set_value();
+		handle.request->pipeline = std::move(pipeline);
+		handle.request->completion = completion.get_future().share();
+		handle.request->bDone.store(true, std::memory_order_release);
+		return handle;
+	}
+
+	++missCount;
+	{
+		std::lock_guard<std::mutex> idleLock(idleMutex);
+		++pendingCount;
+	}
+
+	// the slot lock is held until completion is stored, so anyone who finds the request can wait on it
+	slot->pending = handle.request;
+	// the task state outlives the task through the request's completion, so it holds the request weakly;
+	// slot->pending keeps it alive until the task is done
+	handle.request->completion = threadPool.Submit(
+		[this, slot, weakRequest = std::weak_ptr<PipelineHandle::Request>(handle.request), configInfo, vertSpirv, fragSpirv, vertSpecialization, fragSpecialization]()
+	{
+		std::shared_ptr<Pipeline> pipeline;
+		std::string error;
+		try
+		{
+			pipeline = std::make_shared<Pipeline>(renderer, configInfo, vertSpirv, fragSpirv, vertSpecialization, fragSpecialization);
+		}
+		catch (const std::exception& exception)
+		{
+			error = exception.what();
+			std::cerr << "failed to create pipeline: " << error << "\n";
+		}
+
+		std::shared_ptr<PipelineHandle::Request> request = weakRequest.lock();
+		{
+			std::lock_guard<std::mutex> slotLock(slot->mutex);
+			slot->pipeline = pipeline;
+			slot->pending.reset();
+		}
+
+		request->pipeline = std::move(pipeline);
+		request->error = std::move(error);
+		request->bDone.store(true, std::memory_order_release);
+
+		std::lock_guard<std::mutex> idleLock(idleMutex);
+		--pendingCount;
+		idleCondition.notify_all();
+	}).share();
+
+	return handle;
+}
+
+void PipelineRegistry::WaitIdle()
+{
+	std::unique_lock<std::mutex> idleLock(idleMutex);
+	idleCondition.wait(idleLock, [this]() { return pendingCount == 0; });
+}
+
+bool PipelineRegistry::SaveManifest(const std::string& path)
+{
+	std::lock_guard<std::mutex> lock(recordMutex);
+
+	// pipelines not requested this run age by one run, and are dropped once they have aged out, so
+	// pipelines built from since-edited shaders leave the manifest
+	std::vector<PipelineDescription> aged;
+	aged.reserve(records.size());
+	for (auto& [key, record] : records)
+	{
+		const uint32_t unusedRuns = record.bUsed ? 0 : record.description.unusedRuns + 1;
+		if (unusedRuns <= kManifestMaxUnusedRuns)
+		{
+			aged.push_back(record.description);
+			aged.back().unusedRuns = unusedRuns;
+		}
+	}
+
+	std::vector<const PipelineDescription*> descriptions;
+	for (const PipelineDescription& description : aged)
+	{
+		descriptions.push_back(&description);
+	}
+	// this run could not tell whether those were still needed
+	for (const PipelineDescription& description : unbuildableDescriptions)
+	{
+		descriptions.push_back(&description);
+	}
+	return SavePipelineManifest(path, descriptions);
+}
+
+std::vector<PipelineHandle> PipelineRegistry::Prewarm(ThreadPool& threadPool, const std::string& path)
+{
+	std::error_code existsError;
+	if (!std::filesystem::exists(path, existsError))
+	{
+		// first run, nothing recorded yet
+		return {};
+	}
+
+	std::vector<PipelineDescription> descriptions;
+	std::string error;
+	if (!LoadPipelineManifest(path, descriptions, error))
+	{
+		std::cerr << "ignoring pipeline manifest " << path << ": " << error << std::endl;
+		return {};
+	}
+
+	const VkFormat colorFormat = renderer.GetSwapchainImageFormat();
+	const ExtendedDynamicState& extendedDynamicState = renderer.GetExtendedDynamicState();
+	std::vector<PipelineHandle> handles;
+	for (PipelineDescription& description : descriptions)
+	{
+		std::unique_lock<std::mutex> lock(recordMutex);
+		description.vertSpirv = ShareSpirv(*description.vertSpirv);
+		description.fragSpirv = ShareSpirv(*description.fragSpirv);
+		if (description.colorFormat != colorFormat || !AreDynamicStatesSupported(description.configInfo, extendedDynamicState))
+		{
+			unbuildableDescriptions.push_back(std::move(description));
+			continue;
+		}
+
+		// listed but not yet used; prewarming alone does not keep a pipeline in the manifest
+		const std::string key = GetKey(description.configInfo, *description.vertSpirv, *description.fragSpirv, description.vertSpecialization, description.fragSpecialization);
+		const PipelineDescription& recorded = records.emplace(key, RecordedPipeline{ std::move(description), true, false }).first->second.description;
+		lock.unlock();
+
+		handles.push_back(StartAsync(threadPool, nullptr, key, recorded.configInfo, *recorded.vertSpirv, *recorded.fragSpirv,
+			recorded.vertSpecialization, recorded.fragSpecialization));
+	}
+	return handles;
+}
+
+size_t PipelineRegistry::GetUnlistedCount()
+{
+	std::lock_guard<std::mutex> lock(recordMutex);
+	size_t count = 0;
+	for (auto& [key, record] : records)
+	{
+		count += record.bListed ? 0 : 1;
+	}
+	return count;
+}
+
+std::string PipelineRegistry::GetKey(const PipelineConfigInfo& configInfo, const std::vector<uint32_t>& vertSpirv, const std::vector<uint32_t>& fragSpirv,
+	const ShaderSpecialization& vertSpecialization, const ShaderSpecialization& fragSpecialization) const
+{
+	const std::vector<VkDynamicState> dynamicStates = GetDynamicStates(configInfo);
+	auto isDynamic = [&dynamicStates](VkDynamicState state)
+	{
+		return std::binary_search(dynamicStates.begin(), dynamicStates.end(), state);
+	};
+
+	std::string key;
+
+	/* Shaders */
+	AppendShader(key, vertSpirv, vertSpecialization);
+	AppendShader(key, fragSpirv, fragSpecialization);
+
+	/* Render Pass, which Pipeline creates from the swapchain format */
+	AppendKey(key, renderer.GetSwapchainImageFormat());
+
+	/* Dynamic State */
+	AppendKey(key, static_cast<uint32_t>(dynamicStates.size()));
+	for (VkDynamicState state : dynamicStates)
+	{
+		AppendKey(key, state);
+	}
+
+	/* Vertex Input, derived from the vertex shader when left empty */
+	std::vector<VkVertexInputBindingDescription> bindings = configInfo.bindingDescriptions;
+	std::sort(bindings.begin(), bindings.end(),
+		[](const VkVertexInputBindingDescription& a, const VkVertexInputBindingDescription& b) { return a.binding < b.binding; });
+	AppendKey(key, static_cast<uint32_t>(bindings.size()));
+	for (const VkVertexInputBindingDescription& binding : bindings)
+	{
+		AppendKey(key, binding.binding);
+		AppendKey(key, binding.stride);
+		AppendKey(key, binding.inputRate);
+	}
+	std::vector<VkVertexInputAttributeDescription> attributes = configInfo.attributeDescriptions;
+	std::sort(attributes.begin(), attributes.end(),
+		[](const VkVertexInputAttributeDescription& a, const VkVertexInputAttributeDescription& b) { return a.location < b.location; });
+	AppendKey(key, static_cast<uint32_t>(attributes.size()));
+	for (const VkVertexInputAttributeDescription& attribute : attributes)
+	{
+		AppendKey(key, attribute.location);
+		AppendKey(key, attribute.binding);
+		AppendKey(key, attribute.format);
+		AppendKey(key, attribute.offset);
+	}
+
+	/* Input Assembly */
+	const VkPipelineInputAssemblyStateCreateInfo& inputAssembly = configInfo.inputAssemblyInfo;
+	AppendNext(key, inputAssembly.pNext);
+	AppendKey(key, inputAssembly.flags);
+	if (isDynamic(kDynamicPrimitiveTopology))
+	{
+		AppendKey(key, GetTopologyClass(inputAssembly.topology));
+	}
+	else
+	{
+		AppendKey(key, inputAssembly.topology);
+	}
+	if (!isDynamic(kDynamicPrimitiveRestartEnable))
+	{
+		AppendKey(key, inputAssembly.primitiveRestartEnable);
+	}
+
+	/* Viewport */
+	const VkPipelineViewportStateCreateInfo& viewport = configInfo.viewportInfo;
+	AppendNext(key, viewport.pNext);
+	AppendKey(key, viewport.flags);
+	AppendKey(key, viewport.viewportCount);
+	AppendKey(key, viewport.scissorCount);
+	if (!isDynamic(VK_DYNAMIC_STATE_VIEWPORT) && viewport.pViewports)
+	{
+		AppendKey(key, configInfo.viewport);
+	}
+	if (!isDynamic(VK_DYNAMIC_STATE_SCISSOR) && viewport.pScissors)
+	{
+		AppendKey(key, configInfo.scissor);
+	}
+
+	/* Rasterization */
+	const VkPipelineRasterizationStateCreateInfo& rasterization = configInfo.rasterizationInfo;
+	AppendNext(key, rasterization.pNext);
+	AppendKey(key, rasterization.flags);
+	AppendKey(key, rasterization.depthClampEnable);
+	AppendKey(key, rasterization.rasterizerDiscardEnable);
+	AppendKey(key, rasterization.polygonMode);
+	if (!isDynamic(kDynamicCullMode))
+	{
+		AppendKey(key, rasterization.cullMode);
+	}
+	if (!isDynamic(kDynamicFrontFace))
+	{
+		AppendKey(key, rasterization.frontFace);
+	}
+	// with a dynamic enable, the bias factors matter whatever the config's enable says
+	const bool bDynamicDepthBiasEnable = isDynamic(kDynamicDepthBiasEnable);
+	if (!bDynamicDepthBiasEnable)
+	{
+		AppendKey(key, rasterization.depthBiasEnable);
+	}
+	if ((rasterization.depthBiasEnable || bDynamicDepthBiasEnable) && !isDynamic(VK_DYNAMIC_STATE_DEPTH_BIAS))
+	{
+		AppendKey(key, rasterization.depthBiasConstantFactor);
+		AppendKey(key, rasterization.depthBiasClamp);
+		AppendKey(key, rasterization.depthBiasSlopeFactor);
+	}
+	if (!isDynamic(VK_DYNAMIC_STATE_LINE_WIDTH))
+	{
+		AppendKey(key, rasterization.lineWidth);
+	}
+
+	/* Multisample */
+	const VkPipelineMultisampleStateCreateInfo& multisample = configInfo.multisampleInfo;
+	AppendNext(key, multisample.pNext);
+	AppendKey(key, multisample.flags);
+	AppendKey(key, multisample.rasterizationSamples);
+	AppendKey(key, multisample.sampleShadingEnable);
+	if (multisample.sampleShadingEnable)
+	{
+		AppendKey(key, multisample.minSampleShading);
+	}
+	// a null mask means every sample, so it keys the same as an explicit all-ones mask
+	const uint32_t sampleMaskWords = (static_cast<uint32_t>(multisample.rasterizationSamples) + 31) / 32;
+	for (uint32_t i = 0; i < sampleMaskWords; ++i)
+	{
+		AppendKey(key, multisample.pSampleMask ? multisample.pSampleMask[i] : ~0u);
+	}
+	AppendKey(key, multisample.alphaToCoverageEnable);
+	AppendKey(key, multisample.alphaToOneEnable);
+
+	/* Depth Stencil, where the depth test off also turns depth writes off */
+	const VkPipelineDepthStencilStateCreateInfo& depthStencil = configInfo.depthStencilInfo;
+	AppendNext(key, depthStencil.pNext);
+	AppendKey(key, depthStencil.flags);
+	const bool bDynamicDepthTestEnable = isDynamic(kDynamicDepthTestEnable);
+	if (!bDynamicDepthTestEnable)
+	{
+		AppendKey(key, depthStencil.depthTestEnable);
+	}
+	if (depthStencil.depthTestEnable || bDynamicDepthTestEnable)
+	{
+		if (!isDynamic(kDynamicDepthWriteEnable))
+		{
+			AppendKey(key, depthStencil.depthWriteEnable);
+		}
+		if (!isDynamic(kDynamicDepthCompareOp))
+		{
+			AppendKey(key, depthStencil.depthCompareOp);
+		}
+	}
+	AppendKey(key, depthStencil.depthBoundsTestEnable);
+	if (depthStencil.depthBoundsTestEnable && !isDynamic(VK_DYNAMIC_STATE_DEPTH_BOUNDS))
+	{
+		AppendKey(key, depthStencil.minDepthBounds);
+		AppendKey(key, depthStencil.maxDepthBounds);
+	}
+	AppendKey(key, depthStencil.stencilTestEnable);
+	if (depthStencil.stencilTestEnable)
+	{
+		for (const VkStencilOpState& stencil : { depthStencil.front, depthStencil.back })
+		{
+			AppendKey(key, stencil.failOp);
+			AppendKey(key, stencil.passOp);
+			AppendKey(key, stencil.depthFailOp);
+			AppendKey(key, stencil.compareOp);
+			if (!isDynamic(VK_DYNAMIC_STATE_STENCIL_COMPARE_MASK))
+			{
+				AppendKey(key, stencil.compareMask);
+			}
+			if (!isDynamic(VK_DYNAMIC_STATE_STENCIL_WRITE_MASK))
+			{
+				AppendKey(key, stencil.writeMask);
+			}
+			if (!isDynamic(VK_DYNAMIC_STATE_STENCIL_REFERENCE))
+			{
+				AppendKey(key, stencil.reference);
+			}
+		}
+	}
+
+	/* Color Blend; Pipeline always uses the config's single attachment, so pAttachments is not read */
+	const VkPipelineColorBlendStateCreateInfo& colorBlend = configInfo.colorBlendInfo;
+	AppendNext(key, colorBlend.pNext);
+	AppendKey(key, colorBlend.flags);
+	AppendKey(key, colorBlend.logicOpEnable);
+	if (colorBlend.logicOpEnable)
+	{
+		AppendKey(key, colorBlend.logicOp);
+	}
+	if (!isDynamic(VK_DYNAMIC_STATE_BLEND_CONSTANTS))
+	{
+		AppendKey(key, colorBlend.blendConstants);
+	}
+	const VkPipelineColorBlendAttachmentState& blendAttachment = configInfo.colorBlendAttachment;
+	AppendKey(key, blendAttachment.colorWriteMask);
+	const bool bDynamicColorBlendEnable = isDynamic(kDynamicColorBlendEnable);
+	if (!bDynamicColorBlendEnable)
+	{
+		AppendKey(key, blendAttachment.blendEnable);
+	}
+	if ((blendAttachment.blendEnable || bDynamicColorBlendEnable) && !isDynamic(kDynamicColorBlendEquation))
+	{
+		AppendKey(key, blendAttachment.srcColorBlendFactor);
+		AppendKey(key, blendAttachment.dstColorBlendFactor);
+		AppendKey(key, blendAttachment.colorBlendOp);
+		AppendKey(key, blendAttachment.srcAlphaBlendFactor);
+		AppendKey(key, blendAttachment.dstAlphaBlendFactor);
+		AppendKey(key, blendAttachment.alphaBlendOp);
+	}
+
+	return key;
+}
+
+std::shared_ptr<PipelineRegistry::Slot> PipelineRegistry::GetSlot(const std::string& key)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	auto existing = slots.find(key);
+	if (existing != slots.end())
+	{
+		return existing->second;
+	}
+
+	// Slots whose pipeline is gone are swept once the map has doubled since the last sweep, which
+	// keeps it bounded by the live keys at a constant cost per request
+	if (slots.size() >= slotSweepThreshold)
+	{
+		for (auto slot = slots.begin(); slot != slots.end();)
+		{
+			// only the map holds it, so no request is waiting on or creating it
+			const bool bUnused = slot->second.use_count() == 1 && slot->second->mutex.try_lock();
+			const bool bExpired = bUnused && slot->second->pipeline.expired() && !slot->second->pending;
+			if (bUnused)
+			{
+				slot->second->mutex.unlock();
+			}
+			slot = bExpired ? slots.erase(slot) : std::next(slot);
+		}
+		slotSweepThreshold = std::max(kMinSlotSweepThreshold, 2 * slots.size());
+	}
+
+	const std::shared_ptr<Slot> slot = std::make_shared<Slot>();
+	slots.emplace(key, slot);
+	return slot;
+}
+
+void PipelineRegistry::RecordPipeline(const std::string& key, const PipelineConfigInfo& configInfo, const std::vector<uint32_t>& vertSpirv, const std::vector<uint32_t>& fragSpirv,
+	const ShaderSpecialization& vertSpecialization, const ShaderSpecialization& fragSpecialization)
+{
+	std::lock_guard<std::mutex> lock(recordMutex);
+	auto existing = records.find(key);
+	if (existing != records.end())
+	{
+		existing->second.bUsed = true;
+		return;
+	}
+
+	// a pipeline the manifest cannot describe is still created, just never prewarmed
+	if (!IsPipelineDescribable(configInfo))
+	{
+		return;
+	}
+
+	RecordedPipeline record{};
+	record.description.configInfo = configInfo;
+	// the copy's dynamic state pointer still leads into the caller's config, so keep the states themselves
+	PipelineConfigInfo& recordedConfig = record.description.configInfo;
+	if (recordedConfig.dynamicStates.empty() && configInfo.dynamicStateInfo.pDynamicStates)
+	{
+		recordedConfig.dynamicStates.assign(configInfo.dynamicStateInfo.pDynamicStates, configInfo.dynamicStateInfo.pDynamicStates + configInfo.dynamicStateInfo.dynamicStateCount);
+	}
+	recordedConfig.dynamicStateInfo.dynamicStateCount = 0;
+	recordedConfig.dynamicStateInfo.pDynamicStates = nullptr;
+	record.description.vertSpirv = ShareSpirv(vertSpirv);
+	record.description.fragSpirv = ShareSpirv(fragSpirv);
+	record.description.vertSpecialization = vertSpecialization;
+	record.description.fragSpecialization = fragSpecialization;
+	record.description.colorFormat = renderer.GetSwapchainImageFormat();
+	record.bListed = false;
+	record.bUsed = true;
+	records.emplace(key, std::move(record));
+}
+
+std::shared_ptr<const std::vector<uint32_t>> PipelineRegistry::ShareSpirv(const std::vector<uint32_t>& spirv)
+{
+	std::shared_ptr<const std::vector<uint32_t>>& shared = recordedSpirv[HashBytes(spirv.data(), spirv.size() * sizeof(uint32_t))];
+	if (!shared)
+	{
+		shared = std::make_shared<const std::vector<uint32_t>>(spirv);
+	}
+	return shared;
+}
+
+size_t PipelineRegistry::GetPipelineCount()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	size_t count = 0;
+	for (auto& [key, slot] : slots)
+	{
+		std::lock_guard<std::mutex> slotLock(slot->mutex);
+		count += slot->pipeline.expired() ? 0 : 1;
+	}
+	return count;
+}
+
+size_t PipelineRegistry::GetHitCount() const
+{
+	return hitCount;
+}
+
+size_t PipelineRegistry::GetMissCount() const
+{
+	return missCount;
+}
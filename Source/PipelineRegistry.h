@@ -0,0 +1,164 @@
+#pragma once
+
+#include "Pipeline.h"
+#include "PipelineManifest.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+class Renderer;
+class ThreadPool;
+
+// A pipeline that may still be compiling on a worker thread. Copies share the same request; checking
+// it costs one atomic load, so it can be done per draw.
+class PipelineHandle
+{
+public:
+	// true once the pipeline exists; stays false when creation failed
+	bool IsReady() const;
+	bool IsFailed() const;
+
+	// What to bind this frame: the pipeline once ready, otherwise the fallback given with the request,
+	// which is null when the draw should be skipped
+	Pipeline* GetForDraw() const;
+	// null until ready
+	std::shared_ptr<Pipeline> Get() const;
+
+	// Blocks until the request finishes either way
+	void Wait() const;
+	// why creation failed, empty otherwise
+	std::string GetError() const;
+private:
+	friend class PipelineRegistry;
+
+	struct Request
+	{
+		std::atomic<bool> bDone{ false };
+		// written before bDone is set and never after
+		std::shared_ptr<Pipeline> pipeline;
+		std::string error;
+		std::shared_future<void> completion;
+	};
+
+	std::shared_ptr<Request> request;
+	std::shared_ptr<Pipeline> fallback;
+};
+
+// Hands out one shared Pipeline per distinct pipeline state. The key is the PipelineConfigInfo with
+// its pointers followed and its don't-care fields dropped (state covered by a dynamic state, depth
+// writes with the depth test off, stencil state with the stencil test off, and so on), plus the hash
+// of each stage's SPIR-V and its specialization data. Materials that differ only in those fields get
+// the same VkPipeline. A pipeline lives as long as someone holds it and is created again on the next
+// request after that.
+//
+// A hot reload rebuilds a shared pipeline in place for everyone holding it; its key still names the
+// old SPIR-V, so a request with the new SPIR-V creates a separate pipeline.
+class PipelineRegistry
+{
+public:
+	explicit PipelineRegistry(Renderer& renderer);
+	// waits for asynchronous requests still compiling, which use the renderer
+	~PipelineRegistry();
+
+	PipelineRegistry(const PipelineRegistry&) = delete;
+	void operator=(const PipelineRegistry&) = delete;
+
+	// Safe to call from several threads; concurrent requests for a new key create it once. Waits for
+	// an asynchronous request for the same key instead of duplicating it, so do not call it from a pool
+	// task while such requests may still be queued behind it.
+	std::shared_ptr<Pipeline> Get(const PipelineConfigInfo& configInfo, const std::vector<uint32_t>& vertSpirv, const std::vector<uint32_t>& fragSpirv,
+		const ShaderSpecialization& vertSpecialization = {}, const ShaderSpecialization& fragSpecialization = {});
+
+	// Returns at once and creates the pipeline on the thread pool, unless the key is already alive or
+	// being created. Until it is ready, GetForDraw returns fallback, which should be a cheap pipeline
+	// with the same layout and vertex input, or null to skip the draws.
+	PipelineHandle GetAsync(ThreadPool& threadPool, const std::shared_ptr<Pipeline>& fallback, const PipelineConfigInfo& configInfo,
+		const std::vector<uint32_t>& vertSpirv, const std::vector<uint32_t>& fragSpirv,
+		const ShaderSpecialization& vertSpecialization = {}, const ShaderSpecialization& fragSpecialization = {});
+	// Blocks until every asynchronous request has finished
+	void WaitIdle();
+
+	// Every distinct pipeline requested is recorded. SaveManifest writes those, together with the ones
+	// Prewarm loaded, so that the next run can create them all before they are first needed; with the
+	// pipeline cache that leaves no pipeline compiles during play. Loaded pipelines that no run has
+	// requested for kManifestMaxUnusedRuns runs are dropped; those for another swapchain format, or
+	// with dynamic states this device cannot set, are written back unchanged.
+	bool SaveManifest(const std::string& path);
+	// Starts creating every pipeline in the manifest that this device can build for the current
+	// swapchain format on the thread pool. Hold on to the handles until the scene's pipelines have been
+	// requested, then release them, so that pipelines the scene does not use are freed.
+	std::vector<PipelineHandle> Prewarm(ThreadPool& threadPool, const std::string& path);
+
+	static constexpr uint32_t kManifestMaxUnusedRuns = 4;
+	// distinct pipelines created since Prewarm that the manifest did not list
+	size_t GetUnlistedCount();
+
+	// The normalized state Get keys on; equal keys build interchangeable pipelines
+	std::string GetKey(const PipelineConfigInfo& configInfo, const std::vector<uint32_t>& vertSpirv, const std::vector<uint32_t>& fragSpirv,
+		const ShaderSpecialization& vertSpecialization = {}, const ShaderSpecialization& fragSpecialization = {}) const;
+
+	// pipelines currently held by at least one user
+	size_t GetPipelineCount();
+	// requests answered with an existing pipeline, and requests that created one
+	size_t GetHitCount() const;
+	size_t GetMissCount() const;
+private:
+	struct Slot
+	{
+		// held while the pipeline is created, so requests for the same key wait instead of duplicating it
+		std::mutex mutex;
+		std::weak_ptr<Pipeline> pipeline;
+		// an asynchronous request still compiling
+		std::shared_ptr<PipelineHandle::Request> pending;
+	};
+
+	struct RecordedPipeline
+	{
+		PipelineDescription description;
+		// loaded from the manifest rather than first requested in this run
+		bool bListed;
+		// requested through Get or GetAsync in this run
+		bool bUsed;
+	};
+
+	std::shared_ptr<Slot> GetSlot(const std::string& key);
+	// GetAsync without recording the request
+	PipelineHandle StartAsync(ThreadPool& threadPool, const std::shared_ptr<Pipeline>& fallback, const std::string& key, const PipelineConfigInfo& configInfo,
+		const std::vector<uint32_t>& vertSpirv, const std::vector<uint32_t>& fragSpirv,
+		const ShaderSpecialization& vertSpecialization, const ShaderSpecialization& fragSpecialization);
+	void RecordPipeline(const std::string& key, const PipelineConfigInfo& configInfo, const std::vector<uint32_t>& vertSpirv, const std::vector<uint32_t>& fragSpirv,
+		const ShaderSpecialization& vertSpecialization, const ShaderSpecialization& fragSpecialization);
+	std::shared_ptr<const std::vector<uint32_t>> ShareSpirv(const std::vector<uint32_t>& spirv);
+private:
+	Renderer& renderer;
+
+	std::mutex mutex;
+	std::unordered_map<std::string, std::shared_ptr<Slot>> slots;
+	static constexpr size_t kMinSlotSweepThreshold = 64;
+	size_t slotSweepThreshold = kMinSlotSweepThreshold;
+
+	std::atomic<size_t> hitCount{ 0 };
+	std::atomic<size_t> missCount{ 0 };
+
+	std::mutex recordMutex;
+	std::unordered_map<std::string, RecordedPipeline> records;
+	// loaded for another swapchain format or for dynamic states this device lacks, so neither
+	// prewarmed nor keyed
+	std::vector<PipelineDescription> unbuildableDescriptions;
+	// by SPIR-V hash, so records that share a stage share its copy
+	std::unordered_map<uint64_t, std::shared_ptr<const std::vector<uint32_t>>> recordedSpirv;
+
+	std::mutex idleMutex;
+	std::condition_variable idleCondition;
+	size_t pendingCount = 0;
+};
@@ -1,11 +1,15 @@
 #include "Renderer.h"
 
+#include "FileUtils.h"
+#include "Hash.h"
+#include "ShaderModuleCache.h"
 #include "Window.h"
 
-#include "glslang/Public/ShaderLang.h"
-
+#include <cstring>
 #include <iostream>
 #include <optional>
+#include <stdexcept>
+#include <type_traits>
 #include <unordered_set>
 #include <limits>
 #include <algorithm>
@@ -14,8 +18,90 @@ struct QueueFamilyIndices
 {
 	std::optional<uint32_t> graphicsFamily;
 	std::optional<uint32_t> presentFamily;
+	std::optional<uint32_t> computeFamily;
 };
 
+static bool HasExtension(const std::vector<VkExtensionProperties>& extensions, const char* name)
+{
+	return std::any_of(extensions.begin(), extensions.end(),
+		[name](const VkExtensionProperties& extension) { return std::strcmp(extension.extensionName, name) == 0; });
+}
+
+// Links a feature struct in front of a pNext chain
+template <typename T>
+static void ChainFeatures(void*& chain, T& features)
+{
+	features.pNext = chain;
+	chain = &features;
+}
+
+// Written ahead of the driver's blob. The driver checks its own header as well, but not every driver
+// survives a truncated or corrupted blob, so the engine checks the size and hash before handing it over.
+struct PipelineCachePrefix
+{
+	uint32_t magic;
+	// some drivers keep their pipelineCacheUUID across updates that change the compiled code
+	uint32_t driverVersion;
+	uint64_t dataSize;
+	uint64_t dataHash;
+};
+
+static constexpr uint32_t kPipelineCacheMagic = 0x43504b56; // "VKPC"
+
+// The blob must come from this exact device; anything else is at best useless to the driver
+static bool IsPipelineCacheValid(const std::vector<char>& contents, const VkPhysicalDeviceProperties& properties, std::string& outReason)
+{
+	PipelineCachePrefix prefix;
+	if (contents.size() < sizeof(prefix))
+	{
+		outReason = "file too small";
+		return false;
+	}
+	std::memcpy(&prefix, contents.data(), sizeof(prefix));
+
+	const char* data = contents.data() + sizeof(prefix);
+	const size_t dataSize = contents.size() - sizeof(prefix);
+	if (prefix.magic != kPipelineCacheMagic || prefix.dataSize != dataSize || prefix.dataHash != HashBytes(data, dataSize))
+	{
+		outReason = "truncated or corrupted";
+		return false;
+	}
+	if (prefix.driverVersion != properties.driverVersion)
+	{
+		outReason = "written by another driver version";
+		return false;
+	}
+
+	// VkPipelineCacheHeaderVersionOne, read field by field since the blob has no alignment guarantee
+	uint32_t headerSize;
+	uint32_t headerVersion;
+	uint32_t vendorID;
+	uint32_t deviceID;
+	uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+	if (dataSize < 4 * sizeof(uint32_t) + VK_UUID_SIZE)
+	{
+		outReason = "missing header";
+		return false;
+	}
+	std::memcpy(&headerSize, data, sizeof(uint32_t));
+	std::memcpy(&headerVersion, data + 4, sizeof(uint32_t));
+	std::memcpy(&vendorID, data + 8, sizeof(uint32_t));
+	std::memcpy(&deviceID, data + 12, sizeof(uint32_t));
+	std::memcpy(pipelineCacheUUID, data + 16, VK_UUID_SIZE);
+
+	if (headerSize < 4 * sizeof(uint32_t) + VK_UUID_SIZE || headerSize > dataSize || headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE)
+	{
+		outReason = "unknown header";
+		return false;
+	}
+	if (vendorID != properties.vendorID || deviceID != properties.deviceID || std::memcmp(pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+	{
+		outReason = "written by another device or driver";
+		return false;
+	}
+	return true;
+}
+
 #if _DEBUG
 static VKAPI_ATTR VkBool32 VKAPI_CALL VulkanDebugCallback(
     VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
@@ -28,29 +114,72 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL VulkanDebugCallback(
 }
 #endif
 
-Renderer::Renderer(Window& window)
-	: window(&window)
+Renderer::Renderer(Window& window, const std::string& pipelineCachePath)
+	: window(&window), pipelineCachePath(pipelineCachePath)
+{
+	Init();
+}
+
+Renderer::Renderer(const std::string& pipelineCachePath)
+	: pipelineCachePath(pipelineCachePath)
+{
+	Init();
+}
+
+void Renderer::Init()
 {
 	CreateVulkanInstance();
 #if _DEBUG
 	CreateDebugMessenger();
 #endif
-	window.CreateSurface(instance, nullptr, &surface);
+	if (window)
+	{
+		window->CreateSurface(instance, nullptr, &surface);
+	}
 	PickPhysicalDevice();
 	CreateLogicalDevice();
-	CreateSwapchain();
-	CreateImageViews();
+	if (window)
+	{
+		CreateSwapchain();
+		CreateImageViews();
+	}
+	CreateCommandPool();
+	CreatePipelineCache();
 }
 
 Renderer::~Renderer()
 {
+	vkDeviceWaitIdle(device);
+	for (DeferredDestroy& deferred : deferredDestroys)
+	{
+		deferred.destroy();
+	}
+	deferredDestroys.clear();
+
+	shaderModuleCache.reset();
+	SavePipelineCache();
+	vkDestroyPipelineCache(device, pipelineCache, nullptr);
+	for (auto& [key, pipelineLayout] : pipelineLayouts)
+	{
+		vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+	}
+	for (auto& [key, descriptorSetLayout] : descriptorSetLayouts)
+	{
+		vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+	}
+
+	vkDestroyCommandPool(device, commandPool, nullptr);
+
 	for (VkImageView& imageView : swapchainImageViews)
 	{
 		vkDestroyImageView(device, imageView, nullptr);
 	}
 
-	vkDestroySwapchainKHR(device, swapchain, nullptr);
-	vkDestroySurfaceKHR(instance, surface, nullptr);
+	if (window)
+	{
+		vkDestroySwapchainKHR(device, swapchain, nullptr);
+		vkDestroySurfaceKHR(instance, surface, nullptr);
+	}
 	vkDestroyDevice(device, nullptr);
 #if _DEBUG
 	DestroyDebugMessenger();
@@ -58,16 +187,248 @@ Renderer::~Renderer()
 	vkDestroyInstance(instance, nullptr);
 }
 
+void Renderer::DeferDestroy(std::function<void()> destroy)
+{
+	deferredDestroys.push_back({ frameIndex + kMaxFramesInFlight, std::move(destroy) });
+}
+
+void Renderer::AdvanceFrame()
+{
+	++frameIndex;
+	if (frameIndex % kPipelineCacheSaveInterval == 0)
+	{
+		SavePipelineCache();
+	}
+	while (!deferredDestroys.empty() && deferredDestroys.front().frame <= frameIndex)
+	{
+		deferredDestroys.front().destroy();
+		deferredDestroys.pop_front();
+	}
+}
+
+uint64_t Renderer::GetFrameIndex() const
+{
+	return frameIndex;
+}
+
+template <typename T>
+static void AppendKey(std::string& key, const T& value)
+{
+	key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+VkDescriptorSetLayout Renderer::GetDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings)
+{
+	// binding order does not change the layout, so sort before building the key
+	std::vector<VkDescriptorSetLayoutBinding> sortedBindings = bindings;
+	std::sort(sortedBindings.begin(), sortedBindings.end(),
+		[](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) { return a.binding < b.binding; });
+
+	std::string key;
+	for (const VkDescriptorSetLayoutBinding& binding : sortedBindings)
+	{
+		AppendKey(key, binding.binding);
+		AppendKey(key, binding.descriptorType);
+		AppendKey(key, binding.descriptorCount);
+		AppendKey(key, binding.stageFlags);
+		AppendKey(key, binding.pImmutableSamplers);
+	}
+
+	std::lock_guard<std::mutex> lock(layoutMutex);
+	auto existing = descriptorSetLayouts.find(key);
+	if (existing != descriptorSetLayouts.end())
+	{
+		return existing->second;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo = { VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+	layoutInfo.bindingCount = static_cast<uint32_t>(sortedBindings.size());
+	layoutInfo.pBindings = sortedBindings.data();
+
+	VkDescriptorSetLayout descriptorSetLayout;
+	if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create descriptor set layout");
+	}
+
+	descriptorSetLayouts.emplace(key, descriptorSetLayout);
+	return descriptorSetLayout;
+}
+
+VkPipelineLayout Renderer::GetPipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges)
+{
+	std::string key;
+	AppendKey(key, static_cast<uint32_t>(setLayouts.size()));
+	for (VkDescriptorSetLayout setLayout : setLayouts)
+	{
+		AppendKey(key, setLayout);
+	}
+	for (const VkPushConstantRange& range : pushConstantRanges)
+	{
+		AppendKey(key, range.stageFlags);
+		AppendKey(key, range.offset);
+		AppendKey(key, range.size);
+	}
+
+	std::lock_guard<std::mutex> lock(layoutMutex);
+	auto existing = pipelineLayouts.find(key);
+	if (existing != pipelineLayouts.end())
+	{
+		return existing->second;
+	}
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = { VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
+	pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+	pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+	pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+	pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
+
+	VkPipelineLayout pipelineLayout;
+	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create pipeline layout");
+	}
+
+	pipelineLayouts.emplace(key, pipelineLayout);
+	return pipelineLayout;
+}
+
+VkPipelineCache Renderer::GetPipelineCache()
+{
+	return pipelineCache;
+}
+
+void Renderer::SavePipelineCache()
+{
+	if (pipelineCachePath.empty() || pipelineCache == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	size_t dataSize = 0;
+	if (vkGetPipelineCacheData(device, pipelineCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == savedPipelineCacheSize)
+	{
+		// the cache only grows, so an unchanged size means nothing new to write
+		return;
+	}
+
+	std::vector<char> contents(sizeof(PipelineCachePrefix) + dataSize);
+	if (vkGetPipelineCacheData(device, pipelineCache, &dataSize, contents.data() + sizeof(PipelineCachePrefix)) != VK_SUCCESS)
+	{
+		return;
+	}
+	contents.resize(sizeof(PipelineCachePrefix) + dataSize);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	PipelineCachePrefix prefix{};
+	prefix.magic = kPipelineCacheMagic;
+	prefix.driverVersion = properties.driverVersion;
+	prefix.dataSize = dataSize;
+	prefix.dataHash = HashBytes(contents.data() + sizeof(prefix), dataSize);
+	std::memcpy(contents.data(), &prefix, sizeof(prefix));
+
+	if (WriteFileAtomic(pipelineCachePath, contents.data(), contents.size()))
+	{
+		savedPipelineCacheSize = dataSize;
+	}
+	else
+	{
+		std::cerr << "failed to save pipeline cache to " << pipelineCachePath << std::endl;
+	}
+}
+
+ShaderModuleCache& Renderer::GetShaderModuleCache()
+{
+	return *shaderModuleCache;
+}
+
+const ExtendedDynamicState& Renderer::GetExtendedDynamicState()
+{
+	return extendedDynamicState;
+}
+
 VkDevice Renderer::GetLogicalDevice()
 {
 	return device;
 }
 
+VkPhysicalDevice Renderer::GetPhysicalDevice()
+{
+	return physicalDevice;
+}
+
 VkFormat Renderer::GetSwapchainImageFormat()
 {
 	return swapchainImageFormat;
 }
 
+VkQueue Renderer::GetComputeQueue()
+{
+	return computeQueue;
+}
+
+VkCommandPool Renderer::GetCommandPool()
+{
+	return commandPool;
+}
+
+uint32_t Renderer::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
+{
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i)
+	{
+		if ((typeFilter & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+		{
+			return i;
+		}
+	}
+
+	throw std::runtime_error("failed to find a suitable memory type");
+}
+
+VkCommandBuffer Renderer::BeginSingleTimeCommands()
+{
+	VkCommandBufferAllocateInfo allocInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO };
+	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.commandPool = commandPool;
+	allocInfo.commandBufferCount = 1;
+
+	VkCommandBuffer commandBuffer;
+	vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
+
+	VkCommandBufferBeginInfo beginInfo = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+	return commandBuffer;
+}
+
+void Renderer::EndSingleTimeCommands(VkCommandBuffer commandBuffer)
+{
+	vkEndCommandBuffer(commandBuffer);
+
+	VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+
+	VkFenceCreateInfo fenceInfo = { VK_STRUCTURE_TYPE_FENCE_CREATE_INFO };
+	VkFence fence;
+	vkCreateFence(device, &fenceInfo, nullptr, &fence);
+
+	if (vkQueueSubmit(computeQueue, 1, &submitInfo, fence) != VK_SUCCESS)
+	{
+		std::cerr << "Failed to submit single time commands\n";
+	}
+	vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
+
+	vkDestroyFence(device, fence, nullptr);
+	vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
+}
+
 void Renderer::CreateVulkanInstance()
 {
 	VkApplicationInfo appInfo = { VK_STRUCTURE_TYPE_APPLICATION_INFO };
@@ -147,12 +508,15 @@ void Renderer::CreateVulkanInstance()
 	extensionNames.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 #endif
 
-	uint32_t glfwExtensionCount = 0;
-	const char** glfwExtensions;
-	glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-	for (uint32_t i = 0; i < glfwExtensionCount; ++i)
+	if (window)
 	{
-		extensionNames.push_back(glfwExtensions[i]);
+		uint32_t glfwExtensionCount = 0;
+		const char** glfwExtensions;
+		glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+		for (uint32_t i = 0; i < glfwExtensionCount; ++i)
+		{
+			extensionNames.push_back(glfwExtensions[i]);
+		}
 	}
 
 	createInfo.enabledExtensionCount = extensionNames.size();
@@ -290,7 +654,13 @@ QueueFamilyIndices Renderer::GetQueueFamilyIndices()
 			indices.graphicsFamily = i;
 		}
 
-		if (!indices.presentFamily.has_value())
+		// prefer running compute on the graphics family so its results need no queue ownership transfer
+		if (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT && (!indices.computeFamily.has_value() || indices.graphicsFamily == i))
+		{
+			indices.computeFamily = i;
+		}
+
+		if (window && !indices.presentFamily.has_value())
 		{
 			VkBool32 presentSupport = false;
 			vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentSupport);
@@ -309,7 +679,11 @@ void Renderer::CreateLogicalDevice()
 	QueueFamilyIndices indices = GetQueueFamilyIndices();
 
 	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-	std::unordered_set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.presentFamily.value() };
+	std::unordered_set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily.value(), indices.computeFamily.value() };
+	if (window)
+	{
+		uniqueQueueFamilies.insert(indices.presentFamily.value());
+	}
 	
 	float queuePriority = 1.0f;
 	for (uint32_t queueFamily : uniqueQueueFamilies)
@@ -322,9 +696,11 @@ void Renderer::CreateLogicalDevice()
 		queueCreateInfos.push_back(queueCreateInfo);
 	}
 
-	const std::vector<const char*> deviceExtensions = {
-		VK_KHR_SWAPCHAIN_EXTENSION_NAME
-	};
+	std::vector<const char*> deviceExtensions = { };
+	if (window)
+	{
+		deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+	}
 
 	uint32_t extensionCount;
 	vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
@@ -333,17 +709,7 @@ void Renderer::CreateLogicalDevice()
 
 	for (const char* requiredExtension : deviceExtensions)
 	{
-		bool bExtensionFound = false;
-		for (const VkExtensionProperties& availableExtension : availableExtensions)
-		{
-			if (*requiredExtension == *(availableExtension.extensionName))
-			{
-				bExtensionFound = true;
-				break;
-			}
-		}
-
-		if (!bExtensionFound)
+		if (!HasExtension(availableExtensions, requiredExtension))
 		{
 			std::cerr << "required device extension " << requiredExtension << " is not available\n";
 		}
@@ -352,6 +718,112 @@ void Renderer::CreateLogicalDevice()
 	VkPhysicalDeviceFeatures deviceFeatures{};
 
 	VkDeviceCreateInfo createInfo = { VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO };
+
+	/* Optional Extensions */
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+	// core functionality needs both the instance and the device at that version
+	uint32_t instanceApiVersion = VK_API_VERSION_1_0;
+	vkEnumerateInstanceVersion(&instanceApiVersion);
+	const uint32_t apiVersion = std::min(deviceProperties.apiVersion, instanceApiVersion);
+
+	// each candidate's features are queried through one chain, then only the ones in use are chained
+	// into the create info
+	VkPhysicalDeviceFeatures2 supportedFeatures = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2 };
+	void* enabledFeatures = nullptr;
+
+#ifdef VK_KHR_maintenance5
+	// lets pipelines take SPIR-V inline; it builds on Vulkan 1.1 and on dynamic rendering, core in 1.3
+	VkPhysicalDeviceMaintenance5FeaturesKHR maintenance5Features = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MAINTENANCE_5_FEATURES_KHR };
+	// before 1.3 dynamic rendering is an extension, which itself needs two extensions that 1.2 made core
+	std::vector<const char*> dynamicRenderingExtensions;
+	if (apiVersion < VK_API_VERSION_1_3)
+	{
+		dynamicRenderingExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+	}
+	if (apiVersion < VK_API_VERSION_1_2)
+	{
+		dynamicRenderingExtensions.push_back(VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME);
+		dynamicRenderingExtensions.push_back(VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME);
+	}
+	const bool bHasDynamicRendering = std::all_of(dynamicRenderingExtensions.begin(), dynamicRenderingExtensions.end(),
+		[&availableExtensions](const char* name) { return HasExtension(availableExtensions, name); });
+	if (bHasDynamicRendering && HasExtension(availableExtensions, VK_KHR_MAINTENANCE_5_EXTENSION_NAME))
+	{
+		ChainFeatures(supportedFeatures.pNext, maintenance5Features);
+	}
+#endif
+	// the first two are core in 1.3 without a feature to enable; the third is only an extension
+	const bool bCoreExtendedDynamicState = apiVersion >= VK_API_VERSION_1_3;
+#ifdef VK_EXT_extended_dynamic_state
+	VkPhysicalDeviceExtendedDynamicStateFeaturesEXT extendedDynamicStateFeatures = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT };
+	if (!bCoreExtendedDynamicState && HasExtension(availableExtensions, VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME))
+	{
+		ChainFeatures(supportedFeatures.pNext, extendedDynamicStateFeatures);
+	}
+#endif
+#ifdef VK_EXT_extended_dynamic_state2
+	VkPhysicalDeviceExtendedDynamicState2FeaturesEXT extendedDynamicState2Features = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_2_FEATURES_EXT };
+	if (!bCoreExtendedDynamicState && HasExtension(availableExtensions, VK_EXT_EXTENDED_DYNAMIC_STATE_2_EXTENSION_NAME))
+	{
+		ChainFeatures(supportedFeatures.pNext, extendedDynamicState2Features);
+	}
+#endif
+#ifdef VK_EXT_extended_dynamic_state3
+	VkPhysicalDeviceExtendedDynamicState3FeaturesEXT extendedDynamicState3Features = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT };
+	if (HasExtension(availableExtensions, VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME))
+	{
+		ChainFeatures(supportedFeatures.pNext, extendedDynamicState3Features);
+	}
+#endif
+
+	// structs left out of the chain keep their features zeroed
+	if (apiVersion >= VK_API_VERSION_1_1 && supportedFeatures.pNext)
+	{
+		vkGetPhysicalDeviceFeatures2(physicalDevice, &supportedFeatures);
+	}
+
+#ifdef VK_KHR_maintenance5
+	bMaintenance5 = maintenance5Features.maintenance5 == VK_TRUE;
+	if (bMaintenance5)
+	{
+		deviceExtensions.push_back(VK_KHR_MAINTENANCE_5_EXTENSION_NAME);
+		deviceExtensions.insert(deviceExtensions.end(), dynamicRenderingExtensions.begin(), dynamicRenderingExtensions.end());
+		ChainFeatures(enabledFeatures, maintenance5Features);
+	}
+#endif
+#ifdef VK_EXT_extended_dynamic_state
+	const bool bExtendedDynamicState = bCoreExtendedDynamicState || extendedDynamicStateFeatures.extendedDynamicState == VK_TRUE;
+	if (!bCoreExtendedDynamicState && bExtendedDynamicState)
+	{
+		deviceExtensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+		ChainFeatures(enabledFeatures, extendedDynamicStateFeatures);
+	}
+#endif
+#ifdef VK_EXT_extended_dynamic_state2
+	const bool bExtendedDynamicState2 = bCoreExtendedDynamicState || extendedDynamicState2Features.extendedDynamicState2 == VK_TRUE;
+	if (!bCoreExtendedDynamicState && bExtendedDynamicState2)
+	{
+		// only the base feature is used
+		extendedDynamicState2Features.extendedDynamicState2LogicOp = VK_FALSE;
+		extendedDynamicState2Features.extendedDynamicState2PatchControlPoints = VK_FALSE;
+		deviceExtensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_2_EXTENSION_NAME);
+		ChainFeatures(enabledFeatures, extendedDynamicState2Features);
+	}
+#endif
+#ifdef VK_EXT_extended_dynamic_state3
+	// of its many features, only the blend enable and equation are used
+	VkPhysicalDeviceExtendedDynamicState3FeaturesEXT enabledExtendedDynamicState3Features = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT };
+	enabledExtendedDynamicState3Features.extendedDynamicState3ColorBlendEnable = extendedDynamicState3Features.extendedDynamicState3ColorBlendEnable;
+	enabledExtendedDynamicState3Features.extendedDynamicState3ColorBlendEquation = extendedDynamicState3Features.extendedDynamicState3ColorBlendEquation;
+	if (enabledExtendedDynamicState3Features.extendedDynamicState3ColorBlendEnable || enabledExtendedDynamicState3Features.extendedDynamicState3ColorBlendEquation)
+	{
+		deviceExtensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME);
+		ChainFeatures(enabledFeatures, enabledExtendedDynamicState3Features);
+	}
+#endif
+	createInfo.pNext = enabledFeatures;
+
 	createInfo.pQueueCreateInfos = queueCreateInfos.data();
 	createInfo.queueCreateInfoCount = queueCreateInfos.size();
 	createInfo.ppEnabledExtensionNames = deviceExtensions.data();
@@ -376,10 +848,55 @@ void Renderer::CreateLogicalDevice()
 	{
 		vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
 	}
-	else
+	else if (window)
 	{
 		std::cerr << "Failed to create present family queue\n";
 	}
+
+	if (indices.computeFamily.has_value())
+	{
+		vkGetDeviceQueue(device, indices.computeFamily.value(), 0, &computeQueue);
+	}
+	else
+	{
+		std::cerr << "Failed to create compute family queue\n";
+	}
+
+	shaderModuleCache = std::make_unique<ShaderModuleCache>(device, bMaintenance5);
+
+	/* Extended Dynamic State, by the core name where the commands are core */
+	auto loadCommand = [this, bCoreExtendedDynamicState](auto& command, const char* coreName, const char* extensionName)
+	{
+		command = reinterpret_cast<std::remove_reference_t<decltype(command)>>(vkGetDeviceProcAddr(device, bCoreExtendedDynamicState ? coreName : extensionName));
+	};
+#ifdef VK_EXT_extended_dynamic_state
+	if (bExtendedDynamicState)
+	{
+		loadCommand(extendedDynamicState.cmdSetCullMode, "vkCmdSetCullMode", "vkCmdSetCullModeEXT");
+		loadCommand(extendedDynamicState.cmdSetFrontFace, "vkCmdSetFrontFace", "vkCmdSetFrontFaceEXT");
+		loadCommand(extendedDynamicState.cmdSetPrimitiveTopology, "vkCmdSetPrimitiveTopology", "vkCmdSetPrimitiveTopologyEXT");
+		loadCommand(extendedDynamicState.cmdSetDepthTestEnable, "vkCmdSetDepthTestEnable", "vkCmdSetDepthTestEnableEXT");
+		loadCommand(extendedDynamicState.cmdSetDepthWriteEnable, "vkCmdSetDepthWriteEnable", "vkCmdSetDepthWriteEnableEXT");
+		loadCommand(extendedDynamicState.cmdSetDepthCompareOp, "vkCmdSetDepthCompareOp", "vkCmdSetDepthCompareOpEXT");
+	}
+#endif
+#ifdef VK_EXT_extended_dynamic_state2
+	if (bExtendedDynamicState2)
+	{
+		loadCommand(extendedDynamicState.cmdSetDepthBiasEnable, "vkCmdSetDepthBiasEnable", "vkCmdSetDepthBiasEnableEXT");
+		loadCommand(extendedDynamicState.cmdSetPrimitiveRestartEnable, "vkCmdSetPrimitiveRestartEnable", "vkCmdSetPrimitiveRestartEnableEXT");
+	}
+#endif
+#ifdef VK_EXT_extended_dynamic_state3
+	if (enabledExtendedDynamicState3Features.extendedDynamicState3ColorBlendEnable)
+	{
+		loadCommand(extendedDynamicState.cmdSetColorBlendEnable, "vkCmdSetColorBlendEnableEXT", "vkCmdSetColorBlendEnableEXT");
+	}
+	if (enabledExtendedDynamicState3Features.extendedDynamicState3ColorBlendEquation)
+	{
+		loadCommand(extendedDynamicState.cmdSetColorBlendEquation, "vkCmdSetColorBlendEquationEXT", "vkCmdSetColorBlendEquationEXT");
+	}
+#endif
 }
 
 void Renderer::CreateSwapchain()
@@ -509,3 +1026,71 @@ void Renderer::CreateImageViews()
 		}
 	}
 }
+
+void Renderer::CreatePipelineCache()
+{
+	std::vector<char> contents;
+	if (!pipelineCachePath.empty())
+	{
+		try
+		{
+			contents = ReadFile(pipelineCachePath);
+		}
+		catch (const std::runtime_error&)
+		{
+			// first run, nothing saved yet
+		}
+	}
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	std::string reason;
+	if (!contents.empty() && !IsPipelineCacheValid(contents, properties, reason))
+	{
+		std::cerr << "discarding pipeline cache " << pipelineCachePath << ": " << reason << std::endl;
+		contents.clear();
+	}
+
+	VkPipelineCacheCreateInfo cacheInfo = { VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO };
+	if (!contents.empty())
+	{
+		cacheInfo.initialDataSize = contents.size() - sizeof(PipelineCachePrefix);
+		cacheInfo.pInitialData = contents.data() + sizeof(PipelineCachePrefix);
+	}
+
+	VkResult result = vkCreatePipelineCache(device, &cacheInfo, nullptr, &pipelineCache);
+	if (result != VK_SUCCESS && !contents.empty())
+	{
+		// the driver rejected the data after all; starting empty only costs the compiles
+		std::cerr << "discarding pipeline cache " << pipelineCachePath << ": rejected by the driver" << std::endl;
+		cacheInfo.initialDataSize = 0;
+		cacheInfo.pInitialData = nullptr;
+		result = vkCreatePipelineCache(device, &cacheInfo, nullptr, &pipelineCache);
+	}
+
+	if (result != VK_SUCCESS)
+	{
+		// pipelines are still created, just without a cache
+		std::cerr << "Failed to create pipeline cache\n";
+		pipelineCache = VK_NULL_HANDLE;
+		return;
+	}
+
+	// a run that compiles nothing new does not rewrite the file
+	vkGetPipelineCacheData(device, pipelineCache, &savedPipelineCacheSize, nullptr);
+}
+
+void Renderer::CreateCommandPool()
+{
+	QueueFamilyIndices indices = GetQueueFamilyIndices();
+
+	VkCommandPoolCreateInfo poolInfo = { VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolInfo.queueFamilyIndex = indices.computeFamily.value();
+
+	if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+	{
+		std::cerr << "Failed to create command pool\n";
+	}
+}
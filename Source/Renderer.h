@@ -2,23 +2,103 @@
 
 #include "vulkan/vulkan.h"
 
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
+class ShaderModuleCache;
 class Window;
 struct QueueFamilyIndices;
 
+// Raster state the device lets command buffers set, so that pipelines differing only in that state
+// can be one pipeline. Each command is null when its state has to stay baked into the pipeline.
+struct ExtendedDynamicState
+{
+#ifdef VK_EXT_extended_dynamic_state
+	// VK_EXT_extended_dynamic_state, core in Vulkan 1.3
+	PFN_vkCmdSetCullModeEXT cmdSetCullMode = nullptr;
+	PFN_vkCmdSetFrontFaceEXT cmdSetFrontFace = nullptr;
+	PFN_vkCmdSetPrimitiveTopologyEXT cmdSetPrimitiveTopology = nullptr;
+	PFN_vkCmdSetDepthTestEnableEXT cmdSetDepthTestEnable = nullptr;
+	PFN_vkCmdSetDepthWriteEnableEXT cmdSetDepthWriteEnable = nullptr;
+	PFN_vkCmdSetDepthCompareOpEXT cmdSetDepthCompareOp = nullptr;
+#endif
+#ifdef VK_EXT_extended_dynamic_state2
+	// VK_EXT_extended_dynamic_state2, core in Vulkan 1.3
+	PFN_vkCmdSetDepthBiasEnableEXT cmdSetDepthBiasEnable = nullptr;
+	PFN_vkCmdSetPrimitiveRestartEnableEXT cmdSetPrimitiveRestartEnable = nullptr;
+#endif
+#ifdef VK_EXT_extended_dynamic_state3
+	// VK_EXT_extended_dynamic_state3, per feature
+	PFN_vkCmdSetColorBlendEnableEXT cmdSetColorBlendEnable = nullptr;
+	PFN_vkCmdSetColorBlendEquationEXT cmdSetColorBlendEquation = nullptr;
+#endif
+};
+
 class Renderer
 {
 public:
-	Renderer(Window& window);
+	// pipelineCachePath names the file the pipeline cache is loaded from and saved to; when empty the
+	// cache lives only as long as the renderer
+	Renderer(Window& window, const std::string& pipelineCachePath = "");
+	// Headless renderer with no surface or swapchain, for compute work and validation runs
+	explicit Renderer(const std::string& pipelineCachePath = "");
 	~Renderer();
 
     Renderer(const Renderer&) = delete;
     void operator=(const Renderer&) = delete;
 
 	VkDevice GetLogicalDevice();
+	VkPhysicalDevice GetPhysicalDevice();
 	VkFormat GetSwapchainImageFormat();
+	VkQueue GetComputeQueue();
+	VkCommandPool GetCommandPool();
+
+	uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+
+	// Records into a fresh command buffer that EndSingleTimeCommands submits and waits on
+	VkCommandBuffer BeginSingleTimeCommands();
+	void EndSingleTimeCommands(VkCommandBuffer commandBuffer);
+
+	// Runs destroy once kMaxFramesInFlight more frames have ended, when no submitted work can still use
+	// the object. Lets pipelines and buffers be replaced without waiting for the device to go idle.
+	void DeferDestroy(std::function<void()> destroy);
+	// Marks the end of a frame; called once per frame after waiting on that frame's fence
+	void AdvanceFrame();
+	// frames ended so far; per-frame resources are picked by this modulo kMaxFramesInFlight
+	uint64_t GetFrameIndex() const;
+
+	static constexpr uint64_t kMaxFramesInFlight = 2;
+
+	// Layouts are created once per distinct description and owned by the renderer. Pipelines built from
+	// compatible shaders get the same handles, so bound descriptor sets survive switching between them.
+	VkDescriptorSetLayout GetDescriptorSetLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings);
+	VkPipelineLayout GetPipelineLayout(const std::vector<VkDescriptorSetLayout>& setLayouts, const std::vector<VkPushConstantRange>& pushConstantRanges);
+
+	// Passed to every pipeline creation, so pipelines built in an earlier run skip the driver's compile.
+	// Internally synchronized, so pipelines may be created from several threads.
+	VkPipelineCache GetPipelineCache();
+	// Writes the cache to disk atomically if it grew since the last save. Also runs periodically from
+	// AdvanceFrame and at shutdown.
+	void SavePipelineCache();
+
+	// frames between periodic saves, about a minute at 60 fps
+	static constexpr uint64_t kPipelineCacheSaveInterval = 3600;
+
+	// Shared by every pipeline on this device. Passes SPIR-V inline instead of creating modules when
+	// VK_KHR_maintenance5 is enabled.
+	ShaderModuleCache& GetShaderModuleCache();
+
+	// Commands for the raster state this device can leave out of pipelines; see
+	// Pipeline::DefaultPipelineConfigInfo and Pipeline::SetExtendedDynamicState
+	const ExtendedDynamicState& GetExtendedDynamicState();
 private:
+	void Init();
 	void CreateVulkanInstance();
 #if _DEBUG
 	void CreateDebugMessenger();
@@ -29,6 +109,8 @@ private:
 	void CreateLogicalDevice();
 	void CreateSwapchain();
 	void CreateImageViews();
+	void CreateCommandPool();
+	void CreatePipelineCache();
 	
 private:
 	VkInstance instance;
@@ -36,14 +118,38 @@ private:
 	VkDevice device;
 	VkQueue graphicsQueue;
 	VkQueue presentQueue;
+	VkQueue computeQueue;
+	VkCommandPool commandPool;
 	VkSurfaceKHR surface;
-	Window* window;
+	Window* window = nullptr;
 	VkSwapchainKHR swapchain;
 	std::vector<VkImage> swapchainImages;
-	VkFormat swapchainImageFormat;
+	// stays undefined on a headless renderer
+	VkFormat swapchainImageFormat = VK_FORMAT_UNDEFINED;
 	VkExtent2D swapchainExtent;
 	std::vector<VkImageView> swapchainImageViews;
 
+	struct DeferredDestroy
+	{
+		uint64_t frame;
+		std::function<void()> destroy;
+	};
+	std::deque<DeferredDestroy> deferredDestroys;
+	uint64_t frameIndex = 0;
+
+	// keyed by the serialized create info; locked because pipelines may be built off the main thread
+	std::mutex layoutMutex;
+	std::unordered_map<std::string, VkDescriptorSetLayout> descriptorSetLayouts;
+	std::unordered_map<std::string, VkPipelineLayout> pipelineLayouts;
+
+	std::string pipelineCachePath;
+	VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+	size_t savedPipelineCacheSize = 0;
+
+	bool bMaintenance5 = false;
+	ExtendedDynamicState extendedDynamicState;
+	std::unique_ptr<ShaderModuleCache> shaderModuleCache;
+
 #if _DEBUG
 	VkDebugUtilsMessengerEXT debugMessenger;
 #endif
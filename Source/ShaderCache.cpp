@@ -0,0 +1,398 @@
+#include "ShaderCache.h"
+
+#include "FileUtils.h"
+#include "Hash.h"
+#include "ShaderIncludeGraph.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unordered_set>
+#include <stdexcept>
+
+// bump when the key layout or the file formats change, so old entries are ignored rather than misread
+static constexpr uint32_t kCacheFormatVersion = 5;
+static constexpr uint32_t kSpirvMagic = 0x07230203;
+
+// Written ahead of the SPIR-V in a .spv entry. A blob cut short or corrupted on disk can still start
+// with the SPIR-V magic, so the size and hash are checked before the words are used.
+struct BlobHeader
+{
+	uint64_t spirvSize;
+	uint64_t spirvHash;
+};
+
+static bool TryHashFile(const std::string& path, uint64_t& outHash)
+{
+	std::vector<char> contents;
+	if (!TryReadFile(path, contents))
+	{
+		return false;
+	}
+	outHash = HashBytes(contents.data(), contents.size());
+	return true;
+}
+
+// The parts of the key shared by both levels: everything outside the source text that changes the SPIR-V
+static void AddEnvironment(Hasher& hasher, const ShaderCompiler& compiler, const ShaderCompileRequest& request)
+{
+	hasher.Add(kCacheFormatVersion);
+	hasher.Add(ShaderCompiler::GetVersionString());
+	hasher.Add(compiler.GetVulkanApiVersion());
+	hasher.Add(request.stage);
+	hasher.Add(request.entryPoint);
+	// debug info and stripping change the blob, so debug and shipping builds never share entries
+	hasher.Add(request.output);
+	hasher.Add(static_cast<uint64_t>(request.defines.size()));
+	for (const ShaderDefine& define : request.defines)
+	{
+		hasher.Add(define.name);
+		hasher.Add(define.value);
+	}
+}
+
+ShaderCache::ShaderCache(const ShaderCompiler& compiler, const std::string& cacheDirectory)
+	: compiler(compiler), cacheDirectory(cacheDirectory)
+{
+	std::error_code error;
+	std::filesystem::create_directories(cacheDirectory, error);
+	if (error)
+	{
+		// the cache only saves time, so carry on compiling everything rather than failing startup
+		std::cerr << "shader cache disabled, failed to create " << cacheDirectory << ": " << error.message() << std::endl;
+		bEnabled = false;
+	}
+}
+
+ShaderCompileResult ShaderCache::Compile(const ShaderCompileRequest& request)
+{
+	if (!bEnabled)
+	{
+		++missCount;
+		return compiler.Compile(request);
+	}
+
+	// load the source once, so the key and the compile see the same text even if the file is being saved
+	ShaderCompileRequest loadedRequest = request;
+	if (loadedRequest.source.empty())
+	{
+		std::vector<char> code;
+		if (!TryReadFile(request.sourcePath, code))
+		{
+			++missCount;
+			return compiler.Compile(request);
+		}
+		loadedRequest.source.assign(code.begin(), code.end());
+	}
+
+	/* Warm Path */
+	const uint64_t inputKey = GetInputKey(loadedRequest);
+	ShaderCompileResult result;
+	if (TryLoadManifest(inputKey, loadedRequest.sourcePath, result))
+	{
+		++hitCount;
+		return result;
+	}
+
+	/* Preprocessed Lookup */
+	const ShaderPreprocessResult preprocessed = compiler.Preprocess(loadedRequest);
+	if (!preprocessed.bSuccess)
+	{
+		// let the full compile produce the error log
+		++missCount;
+		return compiler.Compile(loadedRequest);
+	}
+
+	const uint64_t outputKey = GetOutputKey(loadedRequest, preprocessed.preprocessed);
+	if (TryLoadBlob(outputKey, result.spirv))
+	{
+		result.bSuccess = true;
+		result.includedFiles = preprocessed.includedFiles;
+		result.includes = preprocessed.includes;
+		StoreManifest(inputKey, outputKey, loadedRequest.sourcePath, result);
+		++hitCount;
+		return result;
+	}
+
+	/* Compile */
+	++missCount;
+	result = compiler.Compile(loadedRequest);
+	if (result.bSuccess)
+	{
+		StoreBlob(outputKey, result.spirv);
+		StoreManifest(inputKey, outputKey, loadedRequest.sourcePath, result);
+	}
+	return result;
+}
+
+std::vector<ShaderCompileResult> ShaderCache::CompileAll(const std::vector<ShaderCompileRequest>& requests, ThreadPool* threadPool)
+{
+	return ShaderCompiler::CompileEach(requests, threadPool, [this](const ShaderCompileRequest& request) { return Compile(request); });
+}
+
+void ShaderCache::Invalidate(const std::vector<std::string>& changedFiles)
+{
+	// the watcher and the includer may spell the same file differently
+	std::unordered_set<std::string> changed;
+	for (const std::string& path : changedFiles)
+	{
+		changed.insert(ShaderIncludeGraph::NormalizePath(path));
+	}
+
+	std::lock_guard<std::mutex> lock(fileHashMutex);
+	for (auto fileHash = fileHashes.begin(); fileHash != fileHashes.end();)
+	{
+		fileHash = changed.count(ShaderIncludeGraph::NormalizePath(fileHash->first)) != 0 ? fileHashes.erase(fileHash) : std::next(fileHash);
+	}
+}
+
+size_t ShaderCache::GetHitCount() const
+{
+	return hitCount;
+}
+
+size_t ShaderCache::GetMissCount() const
+{
+	return missCount;
+}
+
+uint64_t ShaderCache::GetInputKey(const ShaderCompileRequest& request) const
+{
+	Hasher hasher;
+	AddEnvironment(hasher, compiler, request);
+	// where includes are looked up, since the same source can resolve to different files
+	hasher.Add(request.sourcePath);
+	hasher.Add(static_cast<uint64_t>(compiler.GetIncludeDirectories().size()));
+	for (const std::string& includeDirectory : compiler.GetIncludeDirectories())
+	{
+		hasher.Add(includeDirectory);
+	}
+	hasher.Add(request.source);
+	return hasher.Get();
+}
+
+uint64_t ShaderCache::GetOutputKey(const ShaderCompileRequest& request, const std::string& preprocessed) const
+{
+	Hasher hasher;
+	AddEnvironment(hasher, compiler, request);
+	hasher.Add(preprocessed);
+	return hasher.Get();
+}
+
+/* Manifest format, one entry per line:
+* spirv <output key>
+* dep <content hash> <path>
+* include <includer> <included>, indices into the dep lines with -1 for the top-level file
+* missing <includer> <path>, a path looked up before an include resolved, which must still not exist
+*/
+bool ShaderCache::TryLoadManifest(uint64_t inputKey, const std::string& sourcePath, ShaderCompileResult& outResult)
+{
+	std::ifstream file(GetPath(inputKey, ".dep"));
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	std::string line;
+	std::string outputKey;
+	std::vector<std::string> includedFiles;
+	std::vector<ShaderInclude> includes;
+	while (std::getline(file, line))
+	{
+		std::istringstream stream(line);
+		std::string tag;
+		stream >> tag;
+		if (tag == "spirv")
+		{
+			stream >> outputKey;
+		}
+		else if (tag == "dep")
+		{
+			std::string expectedHash;
+			std::string path;
+			stream >> expectedHash;
+			stream.get();
+			std::getline(stream, path);
+
+			// an edited or deleted include invalidates the entry
+			uint64_t hash;
+			if (!TryGetFileHash(path, hash) || HashToString(hash) != expectedHash)
+			{
+				return false;
+			}
+			includedFiles.push_back(path);
+		}
+		else if (tag == "include")
+		{
+			int64_t includer = -1;
+			int64_t included = -1;
+			stream >> includer >> included;
+			if (!stream || includer < -1 || includer >= static_cast<int64_t>(includedFiles.size()) || included < 0 || included >= static_cast<int64_t>(includedFiles.size()))
+			{
+				return false;
+			}
+			includes.push_back({ includer < 0 ? sourcePath : includedFiles[includer], includedFiles[included] });
+		}
+		else if (tag == "missing")
+		{
+			int64_t includer = -1;
+			std::string path;
+			stream >> includer;
+			stream.get();
+			std::getline(stream, path);
+			if (!stream || includer < -1 || includer >= static_cast<int64_t>(includedFiles.size()))
+			{
+				return false;
+			}
+
+			// a file created where an earlier candidate was looked up would now be included instead
+			std::error_code error;
+			if (std::filesystem::exists(path, error) || error)
+			{
+				return false;
+			}
+			includes.push_back({ includer < 0 ? sourcePath : includedFiles[includer], path, true });
+		}
+	}
+
+	if (outputKey.empty())
+	{
+		return false;
+	}
+
+	uint64_t key;
+	std::istringstream(outputKey) >> std::hex >> key;
+	if (!TryLoadBlob(key, outResult.spirv))
+	{
+		return false;
+	}
+
+	outResult.bSuccess = true;
+	outResult.includedFiles = std::move(includedFiles);
+	outResult.includes = std::move(includes);
+	return true;
+}
+
+void ShaderCache::StoreManifest(uint64_t inputKey, uint64_t outputKey, const std::string& sourcePath, const ShaderCompileResult& result)
+{
+	std::string manifest = "spirv " + HashToString(outputKey) + "\n";
+	for (const std::string& path : result.includedFiles)
+	{
+		uint64_t hash;
+		if (!TryGetFileHash(path, hash))
+		{
+			// the include vanished since the compile; without its hash the entry could never be validated
+			return;
+		}
+		manifest += "dep " + HashToString(hash) + " " + path + "\n";
+	}
+
+	auto indexOf = [&result, &sourcePath](const std::string& path) -> int64_t
+	{
+		const auto found = std::find(result.includedFiles.begin(), result.includedFiles.end(), path);
+		return found != result.includedFiles.end() ? found - result.includedFiles.begin() : (path == sourcePath ? -1 : -2);
+	};
+	for (const ShaderInclude& include : result.includes)
+	{
+		const int64_t includer = indexOf(include.includer);
+		if (includer == -2)
+		{
+			return;
+		}
+		if (include.bMissing)
+		{
+			manifest += "missing " + std::to_string(includer) + " " + include.included + "\n";
+			continue;
+		}
+		const int64_t included = indexOf(include.included);
+		if (included < 0)
+		{
+			return;
+		}
+		manifest += "include " + std::to_string(includer) + " " + std::to_string(included) + "\n";
+	}
+
+	WriteFileAtomic(GetPath(inputKey, ".dep"), manifest.data(), manifest.size());
+}
+
+bool ShaderCache::TryGetFileHash(const std::string& path, uint64_t& outHash)
+{
+	std::error_code error;
+	const std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(path, error);
+	const uintmax_t size = error ? 0 : std::filesystem::file_size(path, error);
+	if (error)
+	{
+		return false;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(fileHashMutex);
+		auto fileHash = fileHashes.find(path);
+		if (fileHash != fileHashes.end() && fileHash->second.writeTime == writeTime && fileHash->second.size == size)
+		{
+			outHash = fileHash->second.hash;
+			return true;
+		}
+	}
+
+	// hashed outside the lock; two threads may both hash a new header, which is harmless
+	if (!TryHashFile(path, outHash))
+	{
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(fileHashMutex);
+	fileHashes[path] = { writeTime, size, outHash };
+	return true;
+}
+
+bool ShaderCache::TryLoadBlob(uint64_t outputKey, std::vector<uint32_t>& outSpirv) const
+{
+	std::vector<char> contents;
+	if (!TryReadFile(GetPath(outputKey, ".spv"), contents))
+	{
+		return false;
+	}
+
+	BlobHeader header;
+	if (contents.size() < sizeof(header))
+	{
+		return false;
+	}
+	std::memcpy(&header, contents.data(), sizeof(header));
+
+	const char* spirv = contents.data() + sizeof(header);
+	const size_t spirvSize = contents.size() - sizeof(header);
+	if (header.spirvSize != spirvSize || header.spirvHash != HashBytes(spirv, spirvSize))
+	{
+		return false;
+	}
+	if (spirvSize < sizeof(uint32_t) || spirvSize % sizeof(uint32_t) != 0)
+	{
+		return false;
+	}
+
+	outSpirv.resize(spirvSize / sizeof(uint32_t));
+	std::memcpy(outSpirv.data(), spirv, spirvSize);
+	return outSpirv[0] == kSpirvMagic;
+}
+
+void ShaderCache::StoreBlob(uint64_t outputKey, const std::vector<uint32_t>& spirv) const
+{
+	BlobHeader header;
+	header.spirvSize = spirv.size() * sizeof(uint32_t);
+	header.spirvHash = HashBytes(spirv.data(), header.spirvSize);
+
+	std::vector<char> contents(sizeof(header) + header.spirvSize);
+	std::memcpy(contents.data(), &header, sizeof(header));
+	std::memcpy(contents.data() + sizeof(header), spirv.data(), header.spirvSize);
+	WriteFileAtomic(GetPath(outputKey, ".spv"), contents.data(), contents.size());
+}
+
+std::string ShaderCache::GetPath(uint64_t key, const char* extension) const
+{
+	return (std::filesystem::path(cacheDirectory) / (HashToString(key) + extension)).string();
+}
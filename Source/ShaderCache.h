@@ -0,0 +1,73 @@
+#pragma once
+
+#include "ShaderCompiler.h"
+
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Persistent, content-addressed SPIR-V cache in front of a ShaderCompiler.
+//
+// Blobs are stored as <outputKey>.spv, where the output key hashes the preprocessed source together
+// with the defines, stage, entry point, target environment and glslang version, so any two requests
+// that preprocess to the same text share one blob. Finding that key still needs the preprocessor,
+// so each request also gets a <inputKey>.dep manifest keyed by the raw inputs; it names the blob and
+// the content hash of every included file. A warm start checks those hashes and loads the blob
+// without calling into glslang at all. Include hashes are remembered per file, so a header shared by
+// many stages is read once, and after an edit only the entries that include it miss.
+//
+// Files are written to a temporary name and renamed into place, so a crash or a second process
+// never leaves a truncated entry behind. Failed compiles are not cached.
+class ShaderCache
+{
+public:
+	ShaderCache(const ShaderCompiler& compiler, const std::string& cacheDirectory);
+
+	ShaderCache(const ShaderCache&) = delete;
+	void operator=(const ShaderCache&) = delete;
+
+	// Same contract as ShaderCompiler::Compile; safe to call from several threads
+	ShaderCompileResult Compile(const ShaderCompileRequest& request);
+	// Same contract as ShaderCompiler::CompileAll; hits and misses are mixed freely across the jobs
+	std::vector<ShaderCompileResult> CompileAll(const std::vector<ShaderCompileRequest>& requests, ThreadPool* threadPool = nullptr);
+
+	// Forgets the remembered hashes of files known to have changed. Edits are also caught by their
+	// modification time, but that can be too coarse for a save that follows another immediately.
+	void Invalidate(const std::vector<std::string>& changedFiles);
+
+	// requests answered from disk, and requests that needed a full glslang compile
+	size_t GetHitCount() const;
+	size_t GetMissCount() const;
+private:
+	uint64_t GetInputKey(const ShaderCompileRequest& request) const;
+	uint64_t GetOutputKey(const ShaderCompileRequest& request, const std::string& preprocessed) const;
+
+	bool TryLoadManifest(uint64_t inputKey, const std::string& sourcePath, ShaderCompileResult& outResult);
+	void StoreManifest(uint64_t inputKey, uint64_t outputKey, const std::string& sourcePath, const ShaderCompileResult& result);
+	bool TryGetFileHash(const std::string& path, uint64_t& outHash);
+	bool TryLoadBlob(uint64_t outputKey, std::vector<uint32_t>& outSpirv) const;
+	void StoreBlob(uint64_t outputKey, const std::vector<uint32_t>& spirv) const;
+
+	std::string GetPath(uint64_t key, const char* extension) const;
+private:
+	const ShaderCompiler& compiler;
+	std::string cacheDirectory;
+	bool bEnabled = true;
+
+	std::atomic<size_t> hitCount{ 0 };
+	std::atomic<size_t> missCount{ 0 };
+
+	struct FileHash
+	{
+		std::filesystem::file_time_type writeTime;
+		uintmax_t size;
+		uint64_t hash;
+	};
+	std::mutex fileHashMutex;
+	std::unordered_map<std::string, FileHash> fileHashes;
+};
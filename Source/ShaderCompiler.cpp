@@ -0,0 +1,418 @@
+#include "ShaderCompiler.h"
+
+#include "FileUtils.h"
+#include "ShaderReflection.h"
+#include "ThreadPool.h"
+
+#include "glslang/Public/ResourceLimits.h"
+#include "glslang/Public/ShaderLang.h"
+#include "glslang/build_info.h"
+#include "SPIRV/GlslangToSpv.h"
+#include "SPIRV/SPVRemapper.h"
+#include "SPIRV/doc.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <mutex>
+#include <stdexcept>
+
+// glslang's process state is global, so it is initialized with the first compiler and released with the last
+static std::mutex processMutex;
+static int processReferences = 0;
+
+static EShLanguage GetLanguage(ShaderStage stage)
+{
+	switch (stage)
+	{
+	case ShaderStage::Vertex: return EShLangVertex;
+	case ShaderStage::Fragment: return EShLangFragment;
+	default: return EShLangCompute;
+	}
+}
+
+static void GetTargetVersions(uint32_t vulkanApiVersion, glslang::EShTargetClientVersion& outClient, glslang::EShTargetLanguageVersion& outSpirv)
+{
+	const uint32_t minor = VK_API_VERSION_MINOR(vulkanApiVersion);
+	if (minor >= 3)
+	{
+		outClient = glslang::EShTargetVulkan_1_3;
+		outSpirv = glslang::EShTargetSpv_1_6;
+	}
+	else if (minor == 2)
+	{
+		outClient = glslang::EShTargetVulkan_1_2;
+		outSpirv = glslang::EShTargetSpv_1_5;
+	}
+	else if (minor == 1)
+	{
+		outClient = glslang::EShTargetVulkan_1_1;
+		outSpirv = glslang::EShTargetSpv_1_3;
+	}
+	else
+	{
+		outClient = glslang::EShTargetVulkan_1_0;
+		outSpirv = glslang::EShTargetSpv_1_0;
+	}
+}
+
+// Resolves #include "file" against the including file's directory and #include <file> against the
+// include directories, and records every file it opens and who included it, along with every path an
+// include was looked up at before it resolved, or without it resolving. One includer serves one compile.
+class ShaderIncluder : public glslang::TShader::Includer
+{
+public:
+	ShaderIncluder(const std::string& sourcePath, const std::vector<std::string>& includeDirectories)
+		: sourcePath(sourcePath), includeDirectories(includeDirectories)
+	{
+	}
+
+	IncludeResult* includeLocal(const char* headerName, const char* includerName, size_t inclusionDepth) override
+	{
+		const std::string includer = GetIncluder(includerName);
+		const std::filesystem::path directory = std::filesystem::path(includer).parent_path();
+		if (IncludeResult* result = TryInclude(directory / headerName, includer))
+		{
+			return result;
+		}
+		IncludeResult* result = includeSystem(headerName, includerName, inclusionDepth);
+		// the local candidate appearing later would take precedence over whatever the lookup found
+		AddInclude(includer, (directory / headerName).lexically_normal().generic_string(), true);
+		return result;
+	}
+
+	IncludeResult* includeSystem(const char* headerName, const char* includerName, size_t) override
+	{
+		const std::string includer = GetIncluder(includerName);
+		for (const std::string& includeDirectory : includeDirectories)
+		{
+			const std::filesystem::path path = std::filesystem::path(includeDirectory) / headerName;
+			if (IncludeResult* result = TryInclude(path, includer))
+			{
+				return result;
+			}
+			// a candidate appearing here later would change what this include resolves to
+			AddInclude(includer, path.lexically_normal().generic_string(), true);
+		}
+		return nullptr;
+	}
+
+	void releaseInclude(IncludeResult* result) override
+	{
+		if (result)
+		{
+			delete static_cast<std::vector<char>*>(result->userData);
+			delete result;
+		}
+	}
+
+	const std::vector<std::string>& GetIncludedFiles() const
+	{
+		return includedFiles;
+	}
+
+	const std::vector<ShaderInclude>& GetIncludes() const
+	{
+		return includes;
+	}
+private:
+	// the top-level file reports an empty includer name
+	std::string GetIncluder(const char* includerName) const
+	{
+		return includerName && includerName[0] ? includerName : sourcePath;
+	}
+
+	IncludeResult* TryInclude(const std::filesystem::path& path, const std::string& includer)
+	{
+		std::error_code error;
+		if (!std::filesystem::is_regular_file(path, error))
+		{
+			return nullptr;
+		}
+
+		const std::string name = path.lexically_normal().generic_string();
+		std::vector<char> code;
+		if (!TryReadFile(name, code))
+		{
+			// removed since the check, e.g. by an editor saving through a rename; creating it again is a change
+			AddInclude(includer, name, true);
+			return nullptr;
+		}
+		std::vector<char>* contents = new std::vector<char>(std::move(code));
+
+		if (std::find(includedFiles.begin(), includedFiles.end(), name) == includedFiles.end())
+		{
+			includedFiles.push_back(name);
+		}
+		AddInclude(includer, name, false);
+
+		return new IncludeResult(name, contents->data(), contents->size(), contents);
+	}
+
+	void AddInclude(const std::string& includer, const std::string& included, bool bMissing)
+	{
+		// a guarded header included from several files is opened once per includer
+		if (std::none_of(includes.begin(), includes.end(), [&](const ShaderInclude& include) { return include.includer == includer && include.included == included; }))
+		{
+			includes.push_back({ includer, included, bMissing });
+		}
+	}
+private:
+	std::string sourcePath;
+	const std::vector<std::string>& includeDirectories;
+	std::vector<std::string> includedFiles;
+	std::vector<ShaderInclude> includes;
+};
+
+static const EShMessages kMessages = static_cast<EShMessages>(EShMsgSpvRules | EShMsgVulkanRules);
+
+static EShMessages GetMessages(const ShaderCompileRequest& request)
+{
+	// keeps the source text around for the debug info
+	return request.output == ShaderOutput::DebugInfo ? static_cast<EShMessages>(kMessages | EShMsgDebugInfo) : kMessages;
+}
+
+// spirvbin_t reports errors through one process-wide handler, so each thread collects its own
+static thread_local std::string remapErrors;
+
+// Strips and remaps a copy of the module, keeping the original if the remapper reports an error
+static void StripAndRemap(std::vector<uint32_t>& spirv, std::string& outLog)
+{
+	static std::once_flag setupOnce;
+	std::call_once(setupOnce, []()
+	{
+		// opcode tables shared by every remapper; filling them is not thread safe
+		spv::Parameterize();
+		// the default handler exits the process
+		spv::spirvbin_t::registerErrorHandler([](const std::string& message) { remapErrors += message + "\n"; });
+	});
+
+	// specialization constants are matched by name (see ShaderPermutations), so their names survive the strip
+	std::vector<std::string> keptNames;
+	ShaderReflection reflection;
+	std::string reflectionError;
+	if (ReflectShader(spirv, reflection, reflectionError))
+	{
+		for (const ReflectedSpecConstant& specConstant : reflection.specConstants)
+		{
+			if (!specConstant.name.empty())
+			{
+				keptNames.push_back(specConstant.name);
+			}
+		}
+	}
+
+	// unused resources are kept so the reflected layout matches the unstripped build and pipelines stay compatible
+	const uint32_t options = spv::spirvbin_t::STRIP | spv::spirvbin_t::MAP_ALL | spv::spirvbin_t::DCE_FUNCS | spv::spirvbin_t::DCE_TYPES | spv::spirvbin_t::OPT_LOADSTORE;
+
+	std::vector<uint32_t> remapped = spirv;
+	remapErrors.clear();
+	spv::spirvbin_t remapper;
+	remapper.remap(remapped, keptNames, options);
+
+	if (!remapErrors.empty())
+	{
+		outLog += "SPIR-V remap failed, keeping the unstripped module: " + remapErrors;
+		return;
+	}
+	spirv.swap(remapped);
+}
+
+// Source text and preamble of one request; the TShader keeps pointers into these until it is destroyed
+struct ShaderInput
+{
+	std::string source;
+	std::string preamble;
+	const char* text = nullptr;
+	int length = 0;
+	const char* name = nullptr;
+};
+
+static bool LoadInput(const ShaderCompileRequest& request, ShaderInput& input, std::string& outLog)
+{
+	input.source = request.source;
+	if (input.source.empty())
+	{
+		try
+		{
+			const std::vector<char> code = ReadFile(request.sourcePath);
+			input.source.assign(code.begin(), code.end());
+		}
+		catch (const std::runtime_error& error)
+		{
+			outLog = error.what();
+			return false;
+		}
+	}
+
+	// defines go in the preamble so the source keeps its own line numbers in error messages
+	input.preamble = "#extension GL_GOOGLE_include_directive : require\n";
+	for (const ShaderDefine& define : request.defines)
+	{
+		input.preamble += "#define " + define.name + " " + define.value + "\n";
+	}
+
+	input.text = input.source.c_str();
+	input.length = static_cast<int>(input.source.size());
+	input.name = request.sourcePath.c_str();
+	return true;
+}
+
+static void ConfigureShader(glslang::TShader& shader, const ShaderCompileRequest& request, const ShaderInput& input, uint32_t vulkanApiVersion)
+{
+	const EShLanguage language = GetLanguage(request.stage);
+	glslang::EShTargetClientVersion clientVersion;
+	glslang::EShTargetLanguageVersion spirvVersion;
+	GetTargetVersions(vulkanApiVersion, clientVersion, spirvVersion);
+
+	shader.setStringsWithLengthsAndNames(&input.text, &input.length, &input.name, 1);
+	shader.setPreamble(input.preamble.c_str());
+	shader.setEntryPoint(request.entryPoint.c_str());
+	shader.setSourceEntryPoint(request.entryPoint.c_str());
+	shader.setEnvInput(glslang::EShSourceGlsl, language, glslang::EShClientVulkan, 100);
+	shader.setEnvClient(glslang::EShClientVulkan, clientVersion);
+	shader.setEnvTarget(glslang::EShTargetSpv, spirvVersion);
+}
+
+ShaderCompiler::ShaderCompiler(const std::vector<std::string>& includeDirectories, uint32_t vulkanApiVersion)
+	: includeDirectories(includeDirectories), vulkanApiVersion(vulkanApiVersion)
+{
+	std::lock_guard<std::mutex> lock(processMutex);
+	if (processReferences++ == 0)
+	{
+		glslang::InitializeProcess();
+	}
+}
+
+ShaderCompiler::~ShaderCompiler()
+{
+	std::lock_guard<std::mutex> lock(processMutex);
+	if (--processReferences == 0)
+	{
+		glslang::FinalizeProcess();
+	}
+}
+
+ShaderCompileResult ShaderCompiler::Compile(const ShaderCompileRequest& request) const
+{
+	ShaderCompileResult result;
+	ShaderInput input;
+	if (!LoadInput(request, input, result.log))
+	{
+		return result;
+	}
+
+	const EShLanguage language = GetLanguage(request.stage);
+	glslang::TShader shader(language);
+	ConfigureShader(shader, request, input, vulkanApiVersion);
+
+	ShaderIncluder includer(request.sourcePath, includeDirectories);
+	const bool bParsed = shader.parse(GetDefaultResources(), 100, false, GetMessages(request), includer);
+	result.includedFiles = includer.GetIncludedFiles();
+	result.includes = includer.GetIncludes();
+	result.log = shader.getInfoLog();
+	if (!bParsed)
+	{
+		return result;
+	}
+
+	glslang::TProgram program;
+	program.addShader(&shader);
+	if (!program.link(GetMessages(request)))
+	{
+		result.log += program.getInfoLog();
+		return result;
+	}
+
+	spv::SpvBuildLogger logger;
+	glslang::SpvOptions options;
+	options.generateDebugInfo = request.output == ShaderOutput::DebugInfo;
+	glslang::GlslangToSpv(*program.getIntermediate(language), result.spirv, &logger, &options);
+	result.log += logger.getAllMessages();
+	result.bSuccess = !result.spirv.empty();
+
+	if (result.bSuccess && request.output == ShaderOutput::Stripped)
+	{
+		StripAndRemap(result.spirv, result.log);
+	}
+
+	return result;
+}
+
+std::vector<ShaderCompileResult> ShaderCompiler::CompileAll(const std::vector<ShaderCompileRequest>& requests, ThreadPool* threadPool) const
+{
+	return CompileEach(requests, threadPool, [this](const ShaderCompileRequest& request) { return Compile(request); });
+}
+
+std::vector<ShaderCompileResult> ShaderCompiler::CompileEach(const std::vector<ShaderCompileRequest>& requests, ThreadPool* threadPool,
+	const std::function<ShaderCompileResult(const ShaderCompileRequest&)>& compile)
+{
+	std::vector<ShaderCompileResult> results(requests.size());
+	auto compileRange = [&compile, &requests, &results](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			results[i] = compile(requests[i]);
+		}
+	};
+
+	ParallelFor(threadPool, requests.size(), 1, compileRange);
+	return results;
+}
+
+ShaderPreprocessResult ShaderCompiler::Preprocess(const ShaderCompileRequest& request) const
+{
+	ShaderPreprocessResult result;
+	ShaderInput input;
+	if (!LoadInput(request, input, result.log))
+	{
+		return result;
+	}
+
+	glslang::TShader shader(GetLanguage(request.stage));
+	ConfigureShader(shader, request, input, vulkanApiVersion);
+
+	ShaderIncluder includer(request.sourcePath, includeDirectories);
+	result.bSuccess = shader.preprocess(GetDefaultResources(), 100, ENoProfile, false, false, kMessages, &result.preprocessed, includer);
+	result.includedFiles = includer.GetIncludedFiles();
+	result.includes = includer.GetIncludes();
+	result.log = shader.getInfoLog();
+
+	return result;
+}
+
+uint32_t ShaderCompiler::GetVulkanApiVersion() const
+{
+	return vulkanApiVersion;
+}
+
+const std::vector<std::string>& ShaderCompiler::GetIncludeDirectories() const
+{
+	return includeDirectories;
+}
+
+std::string ShaderCompiler::GetVersionString()
+{
+	return std::to_string(GLSLANG_VERSION_MAJOR) + "." + std::to_string(GLSLANG_VERSION_MINOR) + "." + std::to_string(GLSLANG_VERSION_PATCH) + GLSLANG_VERSION_FLAVOR;
+}
+
+bool ShaderCompiler::GetStageFromPath(const std::string& path, ShaderStage& outStage)
+{
+	const std::string extension = std::filesystem::path(path).extension().string();
+	if (extension == ".vert")
+	{
+		outStage = ShaderStage::Vertex;
+	}
+	else if (extension == ".frag")
+	{
+		outStage = ShaderStage::Fragment;
+	}
+	else if (extension == ".comp")
+	{
+		outStage = ShaderStage::Compute;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
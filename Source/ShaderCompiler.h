@@ -0,0 +1,118 @@
+#pragma once
+
+#include <functional>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+class ThreadPool;
+
+enum class ShaderStage
+{
+	Vertex,
+	Fragment,
+	Compute
+};
+
+// What happens to the SPIR-V after glslang generates it
+enum class ShaderOutput
+{
+	// glslang's output as is, which keeps the names of variables and blocks
+	Default,
+	// also embeds the source text and line numbers, for profilers and shader debuggers
+	DebugInfo,
+	// debug instructions stripped, dead functions and types removed and ids remapped by
+	// spirvbin_t, for shipping: smaller modules that compress better and load faster
+	Stripped
+};
+
+struct ShaderDefine
+{
+	std::string name;
+	std::string value;
+};
+
+// Everything that varies from one compile to the next
+struct ShaderCompileRequest
+{
+	// #include "..." resolves against this file's directory first, then the compiler's include directories
+	std::string sourcePath;
+	// read from sourcePath when empty
+	std::string source;
+	ShaderStage stage = ShaderStage::Vertex;
+	std::vector<ShaderDefine> defines;
+	std::string entryPoint = "main";
+	ShaderOutput output = ShaderOutput::Default;
+};
+
+// One #include as glslang resolved it. The top-level file appears under the request's sourcePath, and
+// headers under the path the includer opened them by. An #include that did not resolve is recorded once
+// per path it was looked up at, marked missing, so creating any of those files counts as a change.
+struct ShaderInclude
+{
+	std::string includer;
+	std::string included;
+	bool bMissing = false;
+};
+
+struct ShaderCompileResult
+{
+	bool bSuccess = false;
+	std::vector<uint32_t> spirv;
+	// glslang's errors and warnings, empty on a clean compile
+	std::string log;
+	// every file pulled in through #include, in first-use order
+	std::vector<std::string> includedFiles;
+	// the edges between those files, each once, in first-use order
+	std::vector<ShaderInclude> includes;
+};
+
+struct ShaderPreprocessResult
+{
+	bool bSuccess = false;
+	// the source after includes, defines and conditionals are resolved
+	std::string preprocessed;
+	std::string log;
+	std::vector<std::string> includedFiles;
+	std::vector<ShaderInclude> includes;
+};
+
+// Compiles GLSL to SPIR-V in process through the vendored glslang. The compiler object holds only
+// process-wide setup (glslang initialization, include directories, target environment); all
+// per-compile state lives in the request and in locals of Compile, so one compiler can be shared,
+// including by several threads compiling at once.
+class ShaderCompiler
+{
+public:
+	// vulkanApiVersion is a VK_API_VERSION_* value and selects the matching SPIR-V version
+	ShaderCompiler(const std::vector<std::string>& includeDirectories = {}, uint32_t vulkanApiVersion = VK_API_VERSION_1_0);
+	~ShaderCompiler();
+
+	ShaderCompiler(const ShaderCompiler&) = delete;
+	void operator=(const ShaderCompiler&) = delete;
+
+	ShaderCompileResult Compile(const ShaderCompileRequest& request) const;
+	// Compiles every request, spread over the thread pool when one is given. results[i] always belongs
+	// to requests[i] and carries its own log, whatever order the jobs finish in.
+	std::vector<ShaderCompileResult> CompileAll(const std::vector<ShaderCompileRequest>& requests, ThreadPool* threadPool = nullptr) const;
+	// Runs only glslang's preprocessor, which is much cheaper than a full compile
+	ShaderPreprocessResult Preprocess(const ShaderCompileRequest& request) const;
+
+	uint32_t GetVulkanApiVersion() const;
+	const std::vector<std::string>& GetIncludeDirectories() const;
+	// glslang's version, which changes the SPIR-V produced for the same source
+	static std::string GetVersionString();
+
+	// The fan-out behind CompileAll, for anything compiling requests its own way: runs compile on every
+	// request, on the pool when one is given, and gathers the results in request order
+	static std::vector<ShaderCompileResult> CompileEach(const std::vector<ShaderCompileRequest>& requests, ThreadPool* threadPool,
+		const std::function<ShaderCompileResult(const ShaderCompileRequest&)>& compile);
+
+	// Stage from the file extension: .vert, .frag or .comp
+	static bool GetStageFromPath(const std::string& path, ShaderStage& outStage);
+private:
+	std::vector<std::string> includeDirectories;
+	uint32_t vulkanApiVersion;
+};
@@ -0,0 +1,158 @@
+#include "ShaderHotReload.h"
+
+#include "Pipeline.h"
+#include "ShaderCache.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+static bool IsSameRequest(const ShaderCompileRequest& a, const ShaderCompileRequest& b)
+{
+	if (a.sourcePath != b.sourcePath || a.source != b.source || a.stage != b.stage || a.entryPoint != b.entryPoint || a.output != b.output || a.defines.size() != b.defines.size())
+	{
+		return false;
+	}
+
+	for (size_t i = 0; i < a.defines.size(); ++i)
+	{
+		if (a.defines[i].name != b.defines[i].name || a.defines[i].value != b.defines[i].value)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+ShaderHotReload::ShaderHotReload(ShaderCache& cache, const std::string& directory, ThreadPool* threadPool)
+	: cache(cache), watcher(directory), threadPool(threadPool)
+{
+}
+
+void ShaderHotReload::Register(Pipeline& pipeline, const ShaderCompileRequest& vertRequest, const ShaderCompileResult& vertResult,
+	const ShaderCompileRequest& fragRequest, const ShaderCompileResult& fragResult)
+{
+	Unregister(pipeline);
+	registrations.push_back({ &pipeline, AddStage(vertRequest, vertResult), AddStage(fragRequest, fragResult), false });
+}
+
+void ShaderHotReload::Unregister(Pipeline& pipeline)
+{
+	registrations.erase(std::remove_if(registrations.begin(), registrations.end(),
+		[&pipeline](const Registration& registration) { return registration.pipeline == &pipeline; }), registrations.end());
+}
+
+void ShaderHotReload::Update()
+{
+	const std::vector<std::string> changedFiles = watcher.Poll();
+	if (changedFiles.empty())
+	{
+		return;
+	}
+
+	// only cache entries that depend on the changed files miss; the rest still validate from memory
+	cache.Invalidate(changedFiles);
+
+	/* Find Affected Stages */
+	std::vector<size_t> dirtyStages;
+	std::vector<ShaderCompileRequest> requests;
+	for (uint64_t stage : includeGraph.GetAffectedStages(changedFiles))
+	{
+		dirtyStages.push_back(static_cast<size_t>(stage));
+		requests.push_back(stages[stage].request);
+	}
+
+	if (dirtyStages.empty())
+	{
+		return;
+	}
+
+	/* Recompile */
+	const std::vector<ShaderCompileResult> results = cache.CompileAll(requests, threadPool);
+
+	std::vector<bool> bReloaded(stages.size(), false);
+	std::vector<bool> bFailed(stages.size(), false);
+	for (size_t i = 0; i < dirtyStages.size(); ++i)
+	{
+		Stage& stage = stages[dirtyStages[i]];
+		if (!results[i].bSuccess)
+		{
+			std::cerr << "failed to reload " << stage.request.sourcePath << DescribeCause(dirtyStages[i], changedFiles) << "\n" << results[i].log;
+			bFailed[dirtyStages[i]] = true;
+			// keep the last good includes, and also watch what the broken source reached, including an
+			// include of a file that does not exist yet
+			includeGraph.Add(dirtyStages[i], results[i].includes);
+			continue;
+		}
+
+		// the includes may have changed too, and a file that was missing may now exist
+		includeGraph.Set(dirtyStages[i], stage.request, results[i].includes);
+		bReloaded[dirtyStages[i]] = stage.spirv != results[i].spirv;
+		stage.spirv = results[i].spirv;
+	}
+
+	/* Rebuild Pipelines */
+	for (Registration& registration : registrations)
+	{
+		const bool bChanged = registration.bPending || bReloaded[registration.vertStage] || bReloaded[registration.fragStage];
+		if (!bChanged)
+		{
+			continue;
+		}
+
+		// wait for the broken stage to be fixed, then rebuild with both changes
+		if (bFailed[registration.vertStage] || bFailed[registration.fragStage])
+		{
+			registration.bPending = true;
+			continue;
+		}
+		registration.bPending = false;
+
+		try
+		{
+			registration.pipeline->Rebuild(stages[registration.vertStage].spirv, stages[registration.fragStage].spirv);
+			std::cout << "reloaded " << stages[registration.vertStage].request.sourcePath << " + " << stages[registration.fragStage].request.sourcePath << "\n";
+		}
+		catch (const std::runtime_error& error)
+		{
+			std::cerr << "failed to rebuild pipeline: " << error.what() << "\n";
+		}
+	}
+}
+
+size_t ShaderHotReload::AddStage(const ShaderCompileRequest& request, const ShaderCompileResult& result)
+{
+	for (size_t i = 0; i < stages.size(); ++i)
+	{
+		if (IsSameRequest(stages[i].request, request))
+		{
+			return i;
+		}
+	}
+
+	Stage stage;
+	stage.request = request;
+	stage.spirv = result.spirv;
+	stages.push_back(std::move(stage));
+	includeGraph.Set(stages.size() - 1, request, result.includes);
+	return stages.size() - 1;
+}
+
+std::string ShaderHotReload::DescribeCause(size_t stage, const std::vector<std::string>& changedFiles) const
+{
+	// an error inside a shared header is easier to place knowing which include pulled it in
+	for (const std::string& path : changedFiles)
+	{
+		const std::vector<std::string> chain = includeGraph.GetIncludeChain(stage, path);
+		if (chain.size() > 1)
+		{
+			std::string cause = " (";
+			for (size_t i = 1; i < chain.size(); ++i)
+			{
+				cause += (i > 1 ? " -> " : "") + chain[i];
+			}
+			return cause + " changed)";
+		}
+	}
+	return "";
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "ShaderCompiler.h"
+#include "ShaderIncludeGraph.h"
+#include "ShaderWatcher.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class Pipeline;
+class ShaderCache;
+class ThreadPool;
+
+// Rebuilds registered pipelines when their shader sources change on disk. Each frame Update polls the
+// watcher, looks the changed files up in the include graph, recompiles only the stages that reach them
+// (in parallel, through the cache), and rebuilds only the pipelines that use those stages. A stage
+// that fails to compile keeps its last good SPIR-V, and its pipelines keep running until the error
+// is fixed.
+class ShaderHotReload
+{
+public:
+	ShaderHotReload(ShaderCache& cache, const std::string& directory, ThreadPool* threadPool = nullptr);
+
+	ShaderHotReload(const ShaderHotReload&) = delete;
+	void operator=(const ShaderHotReload&) = delete;
+
+	// Stages are matched by request, so pipelines sharing a stage compile it once per change
+	void Register(Pipeline& pipeline, const ShaderCompileRequest& vertRequest, const ShaderCompileResult& vertResult,
+		const ShaderCompileRequest& fragRequest, const ShaderCompileResult& fragResult);
+	void Unregister(Pipeline& pipeline);
+
+	// Called once per frame; returns without touching the compiler when nothing changed
+	void Update();
+private:
+	struct Stage
+	{
+		ShaderCompileRequest request;
+		std::vector<uint32_t> spirv;
+	};
+
+	struct Registration
+	{
+		Pipeline* pipeline;
+		size_t vertStage;
+		size_t fragStage;
+		// one stage changed while the other failed to compile
+		bool bPending;
+	};
+
+	size_t AddStage(const ShaderCompileRequest& request, const ShaderCompileResult& result);
+	// the include path to the first changed header, for error messages
+	std::string DescribeCause(size_t stage, const std::vector<std::string>& changedFiles) const;
+private:
+	ShaderCache& cache;
+	ShaderWatcher watcher;
+	ThreadPool* threadPool;
+
+	std::vector<Stage> stages;
+	// keyed by index into stages
+	ShaderIncludeGraph includeGraph;
+	std::vector<Registration> registrations;
+};
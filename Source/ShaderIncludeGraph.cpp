@@ -0,0 +1,150 @@
+#include "ShaderIncludeGraph.h"
+
+#include <algorithm>
+#include <deque>
+#include <filesystem>
+
+void ShaderIncludeGraph::Set(uint64_t stage, const ShaderCompileRequest& request, const std::vector<ShaderInclude>& includes)
+{
+	Remove(stage);
+
+	StageIncludes& stageIncludes = stages[stage];
+	stageIncludes.root = NormalizePath(request.sourcePath);
+	// inline sources have no file of their own to watch
+	stageIncludes.bWatchRoot = request.source.empty();
+	for (const ShaderInclude& include : includes)
+	{
+		stageIncludes.edges.emplace_back(NormalizePath(include.includer), NormalizePath(include.included));
+	}
+
+	if (stageIncludes.bWatchRoot)
+	{
+		dependents[stageIncludes.root].insert(stage);
+	}
+	// every file a stage reaches is the target of one of its edges
+	for (const auto& [includer, included] : stageIncludes.edges)
+	{
+		dependents[included].insert(stage);
+	}
+}
+
+void ShaderIncludeGraph::Add(uint64_t stage, const std::vector<ShaderInclude>& includes)
+{
+	auto existing = stages.find(stage);
+	if (existing == stages.end())
+	{
+		return;
+	}
+
+	StageIncludes& stageIncludes = existing->second;
+	for (const ShaderInclude& include : includes)
+	{
+		std::pair<std::string, std::string> edge(NormalizePath(include.includer), NormalizePath(include.included));
+		if (std::find(stageIncludes.edges.begin(), stageIncludes.edges.end(), edge) == stageIncludes.edges.end())
+		{
+			dependents[edge.second].insert(stage);
+			stageIncludes.edges.push_back(std::move(edge));
+		}
+	}
+}
+
+void ShaderIncludeGraph::Remove(uint64_t stage)
+{
+	auto existing = stages.find(stage);
+	if (existing == stages.end())
+	{
+		return;
+	}
+
+	Unindex(stage, existing->second);
+	stages.erase(existing);
+}
+
+std::vector<uint64_t> ShaderIncludeGraph::GetAffectedStages(const std::vector<std::string>& changedFiles) const
+{
+	std::unordered_set<uint64_t> affected;
+	for (const std::string& path : changedFiles)
+	{
+		auto fileDependents = dependents.find(NormalizePath(path));
+		if (fileDependents != dependents.end())
+		{
+			affected.insert(fileDependents->second.begin(), fileDependents->second.end());
+		}
+	}
+
+	std::vector<uint64_t> sortedStages(affected.begin(), affected.end());
+	std::sort(sortedStages.begin(), sortedStages.end());
+	return sortedStages;
+}
+
+std::vector<std::string> ShaderIncludeGraph::GetIncludeChain(uint64_t stage, const std::string& file) const
+{
+	auto existing = stages.find(stage);
+	if (existing == stages.end())
+	{
+		return {};
+	}
+
+	const StageIncludes& stageIncludes = existing->second;
+	const std::string target = NormalizePath(file);
+
+	// breadth first from the root, so the chain is the shortest one
+	std::unordered_map<std::string, std::string> parents;
+	std::deque<std::string> pending = { stageIncludes.root };
+	parents[stageIncludes.root] = "";
+	while (!pending.empty() && parents.count(target) == 0)
+	{
+		const std::string current = pending.front();
+		pending.pop_front();
+		for (const auto& [includer, included] : stageIncludes.edges)
+		{
+			if (includer == current && parents.count(included) == 0)
+			{
+				parents[included] = current;
+				pending.push_back(included);
+			}
+		}
+	}
+
+	if (parents.count(target) == 0)
+	{
+		return {};
+	}
+
+	std::vector<std::string> chain;
+	for (std::string current = target; !current.empty(); current = parents[current])
+	{
+		chain.push_back(current);
+	}
+	std::reverse(chain.begin(), chain.end());
+	return chain;
+}
+
+std::string ShaderIncludeGraph::NormalizePath(const std::string& path)
+{
+	std::error_code error;
+	const std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+	return error ? std::filesystem::path(path).lexically_normal().generic_string() : canonical.generic_string();
+}
+
+void ShaderIncludeGraph::Unindex(uint64_t stage, const StageIncludes& stageIncludes)
+{
+	auto removeFrom = [this, stage](const std::string& path)
+	{
+		auto fileDependents = dependents.find(path);
+		if (fileDependents != dependents.end())
+		{
+			fileDependents->second.erase(stage);
+			if (fileDependents->second.empty())
+			{
+				dependents.erase(fileDependents);
+			}
+		}
+	};
+
+	removeFrom(stageIncludes.root);
+	for (const auto& [includer, included] : stageIncludes.edges)
+	{
+		removeFrom(included);
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "ShaderCompiler.h"
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// The #include edges of a set of compiled stages, with an index from every file to the stages that
+// reach it, directly or through other headers. An edit to a shared header then maps to exactly the
+// stages that include it, without scanning every stage's dependencies. Edges are kept per stage
+// because defines can make the same header include different files for different stages.
+//
+// Paths are normalized on the way in and on lookup, so the watcher, the requests and the includer
+// may each spell a path their own way. Includes that did not resolve are indexed like the others, so
+// creating the missing file is a change to the stages that looked for it.
+class ShaderIncludeGraph
+{
+public:
+	// Replaces everything recorded for the stage. Its own source file counts as a dependency unless
+	// the request carries the source inline.
+	void Set(uint64_t stage, const ShaderCompileRequest& request, const std::vector<ShaderInclude>& includes);
+	// Adds to what is recorded for the stage, for a compile that failed partway and may have seen only
+	// some of its includes
+	void Add(uint64_t stage, const std::vector<ShaderInclude>& includes);
+	void Remove(uint64_t stage);
+
+	// Stages that depend on any of the changed files, in ascending order
+	std::vector<uint64_t> GetAffectedStages(const std::vector<std::string>& changedFiles) const;
+	// The files from the stage's source down to file along its includes, or empty when it does not reach file
+	std::vector<std::string> GetIncludeChain(uint64_t stage, const std::string& file) const;
+
+	static std::string NormalizePath(const std::string& path);
+private:
+	struct StageIncludes
+	{
+		std::string root;
+		bool bWatchRoot;
+		// normalized, includer first
+		std::vector<std::pair<std::string, std::string>> edges;
+	};
+
+	void Unindex(uint64_t stage, const StageIncludes& stageIncludes);
+private:
+	std::unordered_map<uint64_t, StageIncludes> stages;
+	// normalized path to the stages that depend on it
+	std::unordered_map<std::string, std::unordered_set<uint64_t>> dependents;
+};
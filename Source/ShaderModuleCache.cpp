@@ -0,0 +1,104 @@
+#include "ShaderModuleCache.h"
+
+#include "Hash.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+ShaderModule::ShaderModule(VkDevice device, const std::vector<uint32_t>& spirv, bool bInlineSpirv)
+	: device(device), spirv(spirv)
+{
+	createInfo = { VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO };
+	createInfo.codeSize = this->spirv.size() * sizeof(uint32_t);
+	createInfo.pCode = this->spirv.data();
+
+	if (!bInlineSpirv && vkCreateShaderModule(device, &createInfo, nullptr, &module) != VK_SUCCESS)
+	{
+		throw std::runtime_error("failed to create shader module");
+	}
+}
+
+ShaderModule::~ShaderModule()
+{
+	if (module != VK_NULL_HANDLE)
+	{
+		vkDestroyShaderModule(device, module, nullptr);
+	}
+}
+
+void ShaderModule::FillStageInfo(VkPipelineShaderStageCreateInfo& stageInfo) const
+{
+	stageInfo.module = module;
+	if (module == VK_NULL_HANDLE)
+	{
+		// VK_KHR_maintenance5: a module create info in the stage's chain stands in for the module
+		stageInfo.pNext = &createInfo;
+	}
+}
+
+const std::vector<uint32_t>& ShaderModule::GetSpirv() const
+{
+	return spirv;
+}
+
+VkShaderModule ShaderModule::GetModule() const
+{
+	return module;
+}
+
+ShaderModuleCache::ShaderModuleCache(VkDevice device, bool bInlineSpirv)
+	: device(device), bInlineSpirv(bInlineSpirv)
+{
+}
+
+std::shared_ptr<const ShaderModule> ShaderModuleCache::Acquire(const std::vector<uint32_t>& spirv)
+{
+	const uint64_t hash = HashBytes(spirv.data(), spirv.size() * sizeof(uint32_t));
+
+	std::lock_guard<std::mutex> lock(mutex);
+	auto entry = modules.find(hash);
+	if (entry != modules.end())
+	{
+		if (std::shared_ptr<const ShaderModule> existing = entry->second.lock())
+		{
+			if (existing->GetSpirv() == spirv)
+			{
+				return existing;
+			}
+			// a hash collision; the newcomer gets a module of its own rather than evicting the cached one
+			return std::make_shared<const ShaderModule>(device, spirv, bInlineSpirv);
+		}
+	}
+
+	// expired entries are pruned once the map has doubled since the last prune, which keeps it bounded
+	// by the live modules at a constant cost per acquire
+	if (modules.size() >= pruneThreshold)
+	{
+		for (auto module = modules.begin(); module != modules.end();)
+		{
+			module = module->second.expired() ? modules.erase(module) : std::next(module);
+		}
+		pruneThreshold = std::max(kMinPruneThreshold, 2 * modules.size());
+	}
+
+	std::shared_ptr<const ShaderModule> module = std::make_shared<const ShaderModule>(device, spirv, bInlineSpirv);
+	modules[hash] = module;
+	return module;
+}
+
+bool ShaderModuleCache::IsInlineSpirv() const
+{
+	return bInlineSpirv;
+}
+
+size_t ShaderModuleCache::GetModuleCount()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	size_t count = 0;
+	for (auto& [hash, module] : modules)
+	{
+		count += module.expired() ? 0 : 1;
+	}
+	return count;
+}
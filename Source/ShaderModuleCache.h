@@ -0,0 +1,64 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+// One compiled stage as the driver sees it. Either a real VkShaderModule, or, when the device supports
+// VK_KHR_maintenance5, just the SPIR-V, which pipeline creation then reads inline without ever
+// creating a module.
+class ShaderModule
+{
+public:
+	ShaderModule(VkDevice device, const std::vector<uint32_t>& spirv, bool bInlineSpirv);
+	~ShaderModule();
+
+	ShaderModule(const ShaderModule&) = delete;
+	void operator=(const ShaderModule&) = delete;
+
+	// Sets module, or chains the inline create info into pNext; the stage must not be used after this
+	// object is released
+	void FillStageInfo(VkPipelineShaderStageCreateInfo& stageInfo) const;
+
+	const std::vector<uint32_t>& GetSpirv() const;
+	// VK_NULL_HANDLE when the SPIR-V is passed inline
+	VkShaderModule GetModule() const;
+private:
+	VkDevice device;
+	std::vector<uint32_t> spirv;
+	VkShaderModuleCreateInfo createInfo;
+	VkShaderModule module = VK_NULL_HANDLE;
+};
+
+// Device-level cache of shader modules keyed by a hash of their SPIR-V. Pipelines hold a reference to the
+// modules they were built from, so pipelines that share a stage, and rebuilds that leave a stage
+// unchanged, reuse one module; it is destroyed when the last reference goes. Modules are only read while
+// a pipeline is being created, so they may go before the pipelines built from them.
+class ShaderModuleCache
+{
+public:
+	ShaderModuleCache(VkDevice device, bool bInlineSpirv);
+
+	ShaderModuleCache(const ShaderModuleCache&) = delete;
+	void operator=(const ShaderModuleCache&) = delete;
+
+	// Safe to call from several threads
+	std::shared_ptr<const ShaderModule> Acquire(const std::vector<uint32_t>& spirv);
+
+	bool IsInlineSpirv() const;
+	// modules currently referenced by at least one pipeline
+	size_t GetModuleCount();
+private:
+	VkDevice device;
+	bool bInlineSpirv;
+
+	std::mutex mutex;
+	std::unordered_map<uint64_t, std::weak_ptr<const ShaderModule>> modules;
+	static constexpr size_t kMinPruneThreshold = 64;
+	size_t pruneThreshold = kMinPruneThreshold;
+};
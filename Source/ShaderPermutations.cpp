@@ -0,0 +1,157 @@
+#include "ShaderPermutations.h"
+
+#include "ShaderCache.h"
+
+#include <algorithm>
+#include <cstring>
+
+// Writes value into data at an offset aligned to the constant's size and adds its map entry
+static void AddSpecConstant(ShaderSpecialization& specialization, const ReflectedSpecConstant& constant, int32_t value)
+{
+	const size_t offset = (specialization.data.size() + constant.size - 1) / constant.size * constant.size;
+	specialization.data.resize(offset + constant.size);
+	uint8_t* destination = specialization.data.data() + offset;
+
+	switch (constant.type)
+	{
+	case SpecConstantType::Bool:
+	{
+		const VkBool32 boolValue = value != 0 ? VK_TRUE : VK_FALSE;
+		std::memcpy(destination, &boolValue, sizeof(boolValue));
+		break;
+	}
+	case SpecConstantType::Float:
+		if (constant.size == sizeof(double))
+		{
+			const double floatValue = static_cast<double>(value);
+			std::memcpy(destination, &floatValue, sizeof(floatValue));
+		}
+		else
+		{
+			const float floatValue = static_cast<float>(value);
+			std::memcpy(destination, &floatValue, sizeof(floatValue));
+		}
+		break;
+	default:
+		if (constant.size == sizeof(int64_t))
+		{
+			const int64_t intValue = value;
+			std::memcpy(destination, &intValue, sizeof(intValue));
+		}
+		else
+		{
+			std::memcpy(destination, &value, sizeof(value));
+		}
+		break;
+	}
+
+	VkSpecializationMapEntry entry{};
+	entry.constantID = constant.specId;
+	entry.offset = static_cast<uint32_t>(offset);
+	entry.size = constant.size;
+	specialization.mapEntries.push_back(entry);
+}
+
+ShaderPermutations::ShaderPermutations(ShaderCache& cache, const ShaderCompileRequest& baseRequest)
+	: cache(cache), baseRequest(baseRequest)
+{
+}
+
+ShaderPermutation ShaderPermutations::Get(const std::vector<ShaderFeature>& features)
+{
+	// sorted by name so the same set in any order maps to the same variant; a repeated name keeps its last value
+	std::vector<ShaderFeature> sortedFeatures = features;
+	std::stable_sort(sortedFeatures.begin(), sortedFeatures.end(),
+		[](const ShaderFeature& a, const ShaderFeature& b) { return a.name < b.name; });
+	std::vector<ShaderFeature> uniqueFeatures;
+	for (const ShaderFeature& feature : sortedFeatures)
+	{
+		if (!uniqueFeatures.empty() && uniqueFeatures.back().name == feature.name)
+		{
+			uniqueFeatures.back() = feature;
+		}
+		else
+		{
+			uniqueFeatures.push_back(feature);
+		}
+	}
+
+	/* Classify Features */
+	const std::shared_ptr<const ShaderVariant> baseVariant = GetVariant({});
+	const std::vector<ReflectedSpecConstant>& specConstants = baseVariant->reflection.specConstants;
+
+	ShaderPermutation permutation;
+	std::vector<ShaderDefine> defines;
+	for (const ShaderFeature& feature : uniqueFeatures)
+	{
+		auto specConstant = std::find_if(specConstants.begin(), specConstants.end(),
+			[&feature](const ReflectedSpecConstant& constant) { return constant.name == feature.name; });
+
+		if (specConstant != specConstants.end())
+		{
+			AddSpecConstant(permutation.specialization, *specConstant, feature.value);
+		}
+		else
+		{
+			defines.push_back({ feature.name, std::to_string(feature.value) });
+		}
+	}
+
+	// a constant the define variant compiled out is ignored by Vulkan, so the same data works for every variant
+	permutation.variant = defines.empty() ? baseVariant : GetVariant(defines);
+	return permutation;
+}
+
+bool ShaderPermutations::IsSpecConstant(const std::string& featureName)
+{
+	const std::vector<ReflectedSpecConstant>& specConstants = GetVariant({})->reflection.specConstants;
+	return std::any_of(specConstants.begin(), specConstants.end(),
+		[&featureName](const ReflectedSpecConstant& constant) { return constant.name == featureName; });
+}
+
+size_t ShaderPermutations::GetVariantCount()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return variants.size();
+}
+
+std::shared_ptr<const ShaderVariant> ShaderPermutations::GetVariant(const std::vector<ShaderDefine>& defines)
+{
+	std::string key;
+	for (const ShaderDefine& define : defines)
+	{
+		key += define.name + "=" + define.value + "\n";
+	}
+
+	std::shared_ptr<VariantSlot> slot;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::shared_ptr<VariantSlot>& existing = variants[key];
+		if (!existing)
+		{
+			existing = std::make_shared<VariantSlot>();
+		}
+		slot = existing;
+	}
+
+	// compile outside the lock so different variants build in parallel
+	std::call_once(slot->once, [this, &slot, &defines]() { slot->variant = Compile(defines); });
+	return slot->variant;
+}
+
+std::shared_ptr<const ShaderVariant> ShaderPermutations::Compile(const std::vector<ShaderDefine>& defines) const
+{
+	ShaderCompileRequest request = baseRequest;
+	request.defines.insert(request.defines.end(), defines.begin(), defines.end());
+
+	ShaderCompileResult result = cache.Compile(request);
+
+	std::shared_ptr<ShaderVariant> variant = std::make_shared<ShaderVariant>();
+	variant->log = std::move(result.log);
+	if (result.bSuccess)
+	{
+		variant->bSuccess = ReflectShader(result.spirv, variant->reflection, variant->log);
+		variant->spirv = std::move(result.spirv);
+	}
+	return variant;
+}
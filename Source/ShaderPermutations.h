@@ -0,0 +1,100 @@
+#pragma once
+
+#include "ShaderCompiler.h"
+#include "ShaderReflection.h"
+
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+class ShaderCache;
+
+// A feature toggle or small integer option. Off features are simply left out of the list.
+struct ShaderFeature
+{
+	std::string name;
+	int32_t value = 1;
+};
+
+// Specialization constant values for one pipeline stage
+struct ShaderSpecialization
+{
+	std::vector<VkSpecializationMapEntry> mapEntries;
+	std::vector<uint8_t> data;
+
+	bool IsEmpty() const
+	{
+		return mapEntries.empty();
+	}
+
+	// points into this object, so it is only valid while the specialization is alive and unchanged
+	VkSpecializationInfo GetInfo() const
+	{
+		VkSpecializationInfo info{};
+		info.mapEntryCount = static_cast<uint32_t>(mapEntries.size());
+		info.pMapEntries = mapEntries.data();
+		info.dataSize = data.size();
+		info.pData = data.data();
+		return info;
+	}
+};
+
+// SPIR-V for one combination of preprocessor defines
+struct ShaderVariant
+{
+	bool bSuccess = false;
+	std::vector<uint32_t> spirv;
+	std::string log;
+	ShaderReflection reflection;
+};
+
+struct ShaderPermutation
+{
+	// shared by every permutation that differs only in specialization constants
+	std::shared_ptr<const ShaderVariant> variant;
+	ShaderSpecialization specialization;
+};
+
+// Permutations of one shader stage. A feature whose name matches a specialization constant in the
+// shader (layout(constant_id = N) const bool NAME = ...) is applied as specialization data, so it
+// costs no extra compile and no extra SPIR-V; the driver still folds the constant and removes the dead
+// branches when the pipeline is built. Any other feature becomes a #define, which is needed when it
+// changes declarations, and each distinct define set is compiled once, on first request.
+class ShaderPermutations
+{
+public:
+	ShaderPermutations(ShaderCache& cache, const ShaderCompileRequest& baseRequest);
+
+	ShaderPermutations(const ShaderPermutations&) = delete;
+	void operator=(const ShaderPermutations&) = delete;
+
+	// Safe to call from several threads; concurrent requests for a new variant compile it once
+	ShaderPermutation Get(const std::vector<ShaderFeature>& features);
+
+	// true when the feature is a specialization constant of the shader compiled without any features
+	bool IsSpecConstant(const std::string& featureName);
+	// define variants compiled so far
+	size_t GetVariantCount();
+private:
+	struct VariantSlot
+	{
+		std::once_flag once;
+		std::shared_ptr<const ShaderVariant> variant;
+	};
+
+	std::shared_ptr<const ShaderVariant> GetVariant(const std::vector<ShaderDefine>& defines);
+	std::shared_ptr<const ShaderVariant> Compile(const std::vector<ShaderDefine>& defines) const;
+private:
+	ShaderCache& cache;
+	ShaderCompileRequest baseRequest;
+
+	std::mutex mutex;
+	// keyed by the sorted define list
+	std::unordered_map<std::string, std::shared_ptr<VariantSlot>> variants;
+};
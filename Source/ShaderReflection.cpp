@@ -0,0 +1,676 @@
+#include "ShaderReflection.h"
+
+#include "SPIRV/spirv.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+struct SpirvDecorations
+{
+	uint32_t set = 0;
+	uint32_t binding = 0;
+	uint32_t location = 0;
+	uint32_t arrayStride = 0;
+	uint32_t specId = 0;
+	bool bHasSpecId = false;
+	bool bHasBinding = false;
+	bool bHasLocation = false;
+	bool bBuiltIn = false;
+	bool bBlock = false;
+	bool bBufferBlock = false;
+};
+
+struct SpirvMemberDecorations
+{
+	uint32_t offset = 0;
+	uint32_t matrixStride = 0;
+	bool bRowMajor = false;
+};
+
+struct SpirvSpecConstant
+{
+	uint32_t id;
+	uint32_t type;
+	// the low word of the default, like OpConstant
+	uint32_t defaultValue;
+};
+
+// OpSpecConstantOp, e.g. an array sized COUNT * 2
+struct SpirvSpecConstantOp
+{
+	uint32_t id;
+	spv::Op op;
+	std::vector<uint32_t> operands;
+};
+
+struct SpirvVariable
+{
+	uint32_t id;
+	uint32_t pointerType;
+	spv::StorageClass storageClass;
+};
+
+// The parts of a module reflection needs, indexed by result id
+struct SpirvModule
+{
+	spv::ExecutionModel executionModel = spv::ExecutionModelMax;
+	std::unordered_map<uint32_t, std::vector<uint32_t>> types;
+	std::unordered_map<uint32_t, spv::Op> typeOps;
+	std::unordered_map<uint32_t, uint32_t> constants;
+	std::unordered_map<uint32_t, SpirvDecorations> decorations;
+	std::unordered_map<uint32_t, std::vector<SpirvMemberDecorations>> memberDecorations;
+	std::vector<SpirvVariable> variables;
+	std::vector<SpirvSpecConstant> specConstants;
+	// in definition order, so each one's operands are resolved before it
+	std::vector<SpirvSpecConstantOp> specConstantOps;
+	std::unordered_map<uint32_t, std::string> names;
+};
+
+static constexpr uint32_t kSpirvMagic = 0x07230203;
+static constexpr size_t kSpirvHeaderWords = 5;
+
+static bool ParseModule(const std::vector<uint32_t>& spirv, SpirvModule& outModule, std::string& outError)
+{
+	if (spirv.size() < kSpirvHeaderWords || spirv[0] != kSpirvMagic)
+	{
+		outError = "not a SPIR-V module";
+		return false;
+	}
+
+	for (size_t offset = kSpirvHeaderWords; offset < spirv.size();)
+	{
+		const uint32_t wordCount = spirv[offset] >> 16;
+		const spv::Op op = static_cast<spv::Op>(spirv[offset] & 0xffff);
+		if (wordCount == 0 || offset + wordCount > spirv.size())
+		{
+			outError = "truncated SPIR-V instruction";
+			return false;
+		}
+		const uint32_t* words = spirv.data() + offset;
+		offset += wordCount;
+
+		switch (op)
+		{
+		case spv::OpEntryPoint:
+			// only the first entry point is reflected
+			if (outModule.executionModel == spv::ExecutionModelMax)
+			{
+				outModule.executionModel = static_cast<spv::ExecutionModel>(words[1]);
+			}
+			break;
+		case spv::OpDecorate:
+		{
+			SpirvDecorations& decorations = outModule.decorations[words[1]];
+			switch (static_cast<spv::Decoration>(words[2]))
+			{
+			case spv::DecorationDescriptorSet: decorations.set = words[3]; break;
+			case spv::DecorationBinding: decorations.binding = words[3]; decorations.bHasBinding = true; break;
+			case spv::DecorationLocation: decorations.location = words[3]; decorations.bHasLocation = true; break;
+			case spv::DecorationArrayStride: decorations.arrayStride = words[3]; break;
+			case spv::DecorationSpecId: decorations.specId = words[3]; decorations.bHasSpecId = true; break;
+			case spv::DecorationBuiltIn: decorations.bBuiltIn = true; break;
+			case spv::DecorationBlock: decorations.bBlock = true; break;
+			case spv::DecorationBufferBlock: decorations.bBufferBlock = true; break;
+			default: break;
+			}
+			break;
+		}
+		case spv::OpMemberDecorate:
+		{
+			std::vector<SpirvMemberDecorations>& members = outModule.memberDecorations[words[1]];
+			if (members.size() <= words[2])
+			{
+				members.resize(words[2] + 1);
+			}
+			switch (static_cast<spv::Decoration>(words[3]))
+			{
+			case spv::DecorationOffset: members[words[2]].offset = words[4]; break;
+			case spv::DecorationMatrixStride: members[words[2]].matrixStride = words[4]; break;
+			case spv::DecorationRowMajor: members[words[2]].bRowMajor = true; break;
+			default: break;
+			}
+			break;
+		}
+		case spv::OpName:
+			// a nul-terminated string packed four characters to a word
+			outModule.names[words[1]] = std::string(reinterpret_cast<const char*>(words + 2), strnlen(reinterpret_cast<const char*>(words + 2), (wordCount - 2) * sizeof(uint32_t)));
+			break;
+		case spv::OpTypeBool:
+		case spv::OpTypeInt:
+		case spv::OpTypeFloat:
+		case spv::OpTypeVector:
+		case spv::OpTypeMatrix:
+		case spv::OpTypeArray:
+		case spv::OpTypeRuntimeArray:
+		case spv::OpTypeStruct:
+		case spv::OpTypePointer:
+		case spv::OpTypeImage:
+		case spv::OpTypeSampler:
+		case spv::OpTypeSampledImage:
+		case spv::OpTypeAccelerationStructureKHR:
+			outModule.typeOps[words[1]] = op;
+			outModule.types[words[1]].assign(words + 2, words + wordCount);
+			break;
+		case spv::OpConstant:
+			// array lengths are 32-bit integers, so the low word is enough
+			outModule.constants[words[2]] = words[3];
+			break;
+		case spv::OpSpecConstantTrue:
+			outModule.specConstants.push_back({ words[2], words[1], 1 });
+			break;
+		case spv::OpSpecConstantFalse:
+			outModule.specConstants.push_back({ words[2], words[1], 0 });
+			break;
+		case spv::OpSpecConstant:
+			outModule.specConstants.push_back({ words[2], words[1], words[3] });
+			break;
+		case spv::OpSpecConstantOp:
+			outModule.specConstantOps.push_back({ words[2], static_cast<spv::Op>(words[3]), std::vector<uint32_t>(words + 4, words + wordCount) });
+			break;
+		case spv::OpVariable:
+			outModule.variables.push_back({ words[2], words[1], static_cast<spv::StorageClass>(words[3]) });
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (outModule.executionModel == spv::ExecutionModelMax)
+	{
+		outError = "SPIR-V module has no entry point";
+		return false;
+	}
+	return true;
+}
+
+// Gives every specialization constant its value in constants, so array lengths resolve through them
+// like through plain constants. Expressions other than integer arithmetic are left undefined.
+static void ResolveSpecConstants(SpirvModule& module, const VkSpecializationInfo* specialization)
+{
+	for (const SpirvSpecConstant& specConstant : module.specConstants)
+	{
+		uint32_t value = specConstant.defaultValue;
+		const auto decorations = module.decorations.find(specConstant.id);
+		if (specialization && decorations != module.decorations.end() && decorations->second.bHasSpecId)
+		{
+			for (uint32_t i = 0; i < specialization->mapEntryCount; ++i)
+			{
+				const VkSpecializationMapEntry& entry = specialization->pMapEntries[i];
+				if (entry.constantID == decorations->second.specId && entry.offset + entry.size <= specialization->dataSize)
+				{
+					value = 0;
+					std::memcpy(&value, static_cast<const uint8_t*>(specialization->pData) + entry.offset, std::min<size_t>(entry.size, sizeof(value)));
+				}
+			}
+		}
+		module.constants[specConstant.id] = value;
+	}
+
+	for (const SpirvSpecConstantOp& specConstantOp : module.specConstantOps)
+	{
+		if (specConstantOp.operands.size() != 2)
+		{
+			continue;
+		}
+		const auto a = module.constants.find(specConstantOp.operands[0]);
+		const auto b = module.constants.find(specConstantOp.operands[1]);
+		const bool bDivision = specConstantOp.op == spv::OpUDiv || specConstantOp.op == spv::OpSDiv;
+		if (a == module.constants.end() || b == module.constants.end() || (bDivision && b->second == 0))
+		{
+			continue;
+		}
+
+		const int32_t signedA = static_cast<int32_t>(a->second);
+		const int32_t signedB = static_cast<int32_t>(b->second);
+		switch (specConstantOp.op)
+		{
+		case spv::OpIAdd: module.constants[specConstantOp.id] = a->second + b->second; break;
+		case spv::OpISub: module.constants[specConstantOp.id] = a->second - b->second; break;
+		case spv::OpIMul: module.constants[specConstantOp.id] = a->second * b->second; break;
+		case spv::OpUDiv: module.constants[specConstantOp.id] = a->second / b->second; break;
+		case spv::OpSDiv: module.constants[specConstantOp.id] = signedB == -1 ? 0u - a->second : static_cast<uint32_t>(signedA / signedB); break;
+		default: break;
+		}
+	}
+}
+
+static bool GetStage(spv::ExecutionModel executionModel, VkShaderStageFlagBits& outStage)
+{
+	switch (executionModel)
+	{
+	case spv::ExecutionModelVertex: outStage = VK_SHADER_STAGE_VERTEX_BIT; return true;
+	case spv::ExecutionModelTessellationControl: outStage = VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT; return true;
+	case spv::ExecutionModelTessellationEvaluation: outStage = VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT; return true;
+	case spv::ExecutionModelGeometry: outStage = VK_SHADER_STAGE_GEOMETRY_BIT; return true;
+	case spv::ExecutionModelFragment: outStage = VK_SHADER_STAGE_FRAGMENT_BIT; return true;
+	case spv::ExecutionModelGLCompute: outStage = VK_SHADER_STAGE_COMPUTE_BIT; return true;
+	default: return false;
+	}
+}
+
+// Size of a type inside an explicitly laid out block; matrix strides are member decorations, so the
+// member's decorations come along
+static uint32_t GetTypeSize(const SpirvModule& module, uint32_t typeId, const SpirvMemberDecorations& member)
+{
+	const std::vector<uint32_t>& operands = module.types.at(typeId);
+	switch (module.typeOps.at(typeId))
+	{
+	case spv::OpTypeInt:
+	case spv::OpTypeFloat:
+		return operands[0] / 8;
+	case spv::OpTypeVector:
+		return operands[1] * GetTypeSize(module, operands[0], member);
+	case spv::OpTypeMatrix:
+	{
+		const uint32_t columns = operands[1];
+		const uint32_t rows = module.types.at(operands[0])[1];
+		return (member.bRowMajor ? rows : columns) * member.matrixStride;
+	}
+	case spv::OpTypeArray:
+	{
+		const auto decorations = module.decorations.find(typeId);
+		const uint32_t stride = decorations != module.decorations.end() ? decorations->second.arrayStride : 0;
+		return module.constants.at(operands[1]) * stride;
+	}
+	case spv::OpTypeStruct:
+	{
+		const auto members = module.memberDecorations.find(typeId);
+		uint32_t size = 0;
+		for (size_t i = 0; i < operands.size(); ++i)
+		{
+			const SpirvMemberDecorations memberDecorations = members != module.memberDecorations.end() && i < members->second.size() ? members->second[i] : SpirvMemberDecorations{};
+			size = std::max(size, memberDecorations.offset + GetTypeSize(module, operands[i], memberDecorations));
+		}
+		return size;
+	}
+	default:
+		return 0;
+	}
+}
+
+static bool GetDescriptorType(const SpirvModule& module, const SpirvVariable& variable, uint32_t typeId, VkDescriptorType& outType)
+{
+	const std::vector<uint32_t>& operands = module.types.at(typeId);
+	const auto decorations = module.decorations.find(typeId);
+	const bool bBlock = decorations != module.decorations.end() && decorations->second.bBlock;
+	const bool bBufferBlock = decorations != module.decorations.end() && decorations->second.bBufferBlock;
+
+	switch (module.typeOps.at(typeId))
+	{
+	case spv::OpTypeSampler:
+		outType = VK_DESCRIPTOR_TYPE_SAMPLER;
+		return true;
+	case spv::OpTypeSampledImage:
+		outType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		return true;
+	case spv::OpTypeImage:
+	{
+		const spv::Dim dim = static_cast<spv::Dim>(operands[1]);
+		const uint32_t sampled = operands[5];
+		if (dim == spv::DimSubpassData)
+		{
+			outType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+		}
+		else if (dim == spv::DimBuffer)
+		{
+			outType = sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+		}
+		else
+		{
+			outType = sampled == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+		}
+		return true;
+	}
+	case spv::OpTypeStruct:
+		if (variable.storageClass == spv::StorageClassStorageBuffer || (variable.storageClass == spv::StorageClassUniform && bBufferBlock))
+		{
+			outType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			return true;
+		}
+		if (variable.storageClass == spv::StorageClassUniform && bBlock)
+		{
+			outType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			return true;
+		}
+		return false;
+#ifdef VK_KHR_acceleration_structure
+	case spv::OpTypeAccelerationStructureKHR:
+		outType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+		return true;
+#endif
+	default:
+		return false;
+	}
+}
+
+static bool ReflectDescriptor(const SpirvModule& module, const SpirvVariable& variable, ShaderReflection& outReflection, std::string& outError)
+{
+	const auto decorations = module.decorations.find(variable.id);
+	if (decorations == module.decorations.end() || !decorations->second.bHasBinding)
+	{
+		return true;
+	}
+
+	// arrays of resources become one binding with a descriptor count
+	uint32_t typeId = module.types.at(variable.pointerType)[1];
+	uint32_t count = 1;
+	while (true)
+	{
+		const spv::Op op = module.typeOps.at(typeId);
+		if (op == spv::OpTypeRuntimeArray)
+		{
+			outError = "runtime descriptor arrays need descriptor indexing, which the engine does not enable";
+			return false;
+		}
+		if (op != spv::OpTypeArray)
+		{
+			break;
+		}
+		count *= module.constants.at(module.types.at(typeId)[1]);
+		typeId = module.types.at(typeId)[0];
+	}
+
+	ReflectedDescriptorBinding binding;
+	binding.set = decorations->second.set;
+	binding.binding = decorations->second.binding;
+	binding.descriptorCount = count;
+	if (!GetDescriptorType(module, variable, typeId, binding.descriptorType))
+	{
+		outError = "unsupported resource at set " + std::to_string(binding.set) + " binding " + std::to_string(binding.binding);
+		return false;
+	}
+
+	outReflection.descriptorBindings.push_back(binding);
+	return true;
+}
+
+static VkFormat GetVertexFormat(const SpirvModule& module, uint32_t scalarType, uint32_t components)
+{
+	static const VkFormat kFloat32[] = { VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32A32_SFLOAT };
+	static const VkFormat kSint32[] = { VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT, VK_FORMAT_R32G32B32A32_SINT };
+	static const VkFormat kUint32[] = { VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT, VK_FORMAT_R32G32B32A32_UINT };
+	static const VkFormat kFloat64[] = { VK_FORMAT_R64_SFLOAT, VK_FORMAT_R64G64_SFLOAT, VK_FORMAT_R64G64B64_SFLOAT, VK_FORMAT_R64G64B64A64_SFLOAT };
+	static const VkFormat kFloat16[] = { VK_FORMAT_R16_SFLOAT, VK_FORMAT_R16G16_SFLOAT, VK_FORMAT_R16G16B16_SFLOAT, VK_FORMAT_R16G16B16A16_SFLOAT };
+
+	const std::vector<uint32_t>& operands = module.types.at(scalarType);
+	const uint32_t width = operands[0];
+	if (components < 1 || components > 4)
+	{
+		return VK_FORMAT_UNDEFINED;
+	}
+
+	if (module.typeOps.at(scalarType) == spv::OpTypeFloat)
+	{
+		return width == 64 ? kFloat64[components - 1] : width == 16 ? kFloat16[components - 1] : kFloat32[components - 1];
+	}
+	if (width == 32)
+	{
+		return operands[1] ? kSint32[components - 1] : kUint32[components - 1];
+	}
+	return VK_FORMAT_UNDEFINED;
+}
+
+static bool ReflectVertexInput(const SpirvModule& module, const SpirvVariable& variable, ShaderReflection& outReflection, std::string& outError)
+{
+	const auto decorations = module.decorations.find(variable.id);
+	if (decorations == module.decorations.end() || decorations->second.bBuiltIn || !decorations->second.bHasLocation)
+	{
+		return true;
+	}
+
+	uint32_t typeId = module.types.at(variable.pointerType)[1];
+	uint32_t elementCount = 1;
+	while (module.typeOps.at(typeId) == spv::OpTypeArray)
+	{
+		elementCount *= module.constants.at(module.types.at(typeId)[1]);
+		typeId = module.types.at(typeId)[0];
+	}
+
+	// a matrix is one attribute per column
+	uint32_t columns = 1;
+	if (module.typeOps.at(typeId) == spv::OpTypeMatrix)
+	{
+		columns = module.types.at(typeId)[1];
+		typeId = module.types.at(typeId)[0];
+	}
+
+	uint32_t components = 1;
+	if (module.typeOps.at(typeId) == spv::OpTypeVector)
+	{
+		components = module.types.at(typeId)[1];
+		typeId = module.types.at(typeId)[0];
+	}
+
+	const VkFormat format = GetVertexFormat(module, typeId, components);
+	if (format == VK_FORMAT_UNDEFINED)
+	{
+		outError = "unsupported vertex input type at location " + std::to_string(decorations->second.location);
+		return false;
+	}
+
+	// 64-bit vectors of three or four components take two locations each
+	const uint32_t locationsPerColumn = module.types.at(typeId)[0] == 64 && components > 2 ? 2 : 1;
+	uint32_t location = decorations->second.location;
+	for (uint32_t i = 0; i < elementCount * columns; ++i, location += locationsPerColumn)
+	{
+		VkVertexInputAttributeDescription attribute{};
+		attribute.location = location;
+		attribute.binding = 0;
+		attribute.format = format;
+		outReflection.vertexAttributes.push_back(attribute);
+	}
+	return true;
+}
+
+bool ReflectShader(const std::vector<uint32_t>& spirv, ShaderReflection& outReflection, std::string& outError, const VkSpecializationInfo* specialization)
+{
+	SpirvModule module;
+	if (!ParseModule(spirv, module, outError))
+	{
+		return false;
+	}
+	ResolveSpecConstants(module, specialization);
+
+	outReflection = ShaderReflection();
+	if (!GetStage(module.executionModel, outReflection.stage))
+	{
+		outError = "unsupported SPIR-V execution model";
+		return false;
+	}
+
+	try
+	{
+		for (const SpirvVariable& variable : module.variables)
+		{
+			switch (variable.storageClass)
+			{
+			case spv::StorageClassUniformConstant:
+			case spv::StorageClassUniform:
+			case spv::StorageClassStorageBuffer:
+				if (!ReflectDescriptor(module, variable, outReflection, outError))
+				{
+					return false;
+				}
+				break;
+			case spv::StorageClassPushConstant:
+			{
+				const uint32_t blockType = module.types.at(variable.pointerType)[1];
+				const auto members = module.memberDecorations.find(blockType);
+				uint32_t offset = 0;
+				if (members != module.memberDecorations.end() && !members->second.empty())
+				{
+					offset = members->second[0].offset;
+					for (const SpirvMemberDecorations& member : members->second)
+					{
+						offset = std::min(offset, member.offset);
+					}
+				}
+				const uint32_t end = GetTypeSize(module, blockType, SpirvMemberDecorations{});
+				outReflection.pushConstantOffset = offset;
+				outReflection.pushConstantSize = end > offset ? end - offset : 0;
+				break;
+			}
+			case spv::StorageClassInput:
+				if (outReflection.stage == VK_SHADER_STAGE_VERTEX_BIT && !ReflectVertexInput(module, variable, outReflection, outError))
+				{
+					return false;
+				}
+				break;
+			default:
+				break;
+			}
+		}
+
+		for (const SpirvSpecConstant& specConstant : module.specConstants)
+		{
+			const auto decorations = module.decorations.find(specConstant.id);
+			if (decorations == module.decorations.end() || !decorations->second.bHasSpecId)
+			{
+				continue;
+			}
+
+			ReflectedSpecConstant reflected;
+			reflected.specId = decorations->second.specId;
+			const auto name = module.names.find(specConstant.id);
+			reflected.name = name != module.names.end() ? name->second : std::string();
+
+			const spv::Op typeOp = module.typeOps.at(specConstant.type);
+			const std::vector<uint32_t>& operands = module.types.at(specConstant.type);
+			if (typeOp == spv::OpTypeBool)
+			{
+				reflected.type = SpecConstantType::Bool;
+				reflected.size = sizeof(VkBool32);
+			}
+			else
+			{
+				reflected.type = typeOp == spv::OpTypeFloat ? SpecConstantType::Float : operands[1] ? SpecConstantType::Int : SpecConstantType::Uint;
+				reflected.size = operands[0] / 8;
+			}
+			outReflection.specConstants.push_back(reflected);
+		}
+	}
+	catch (const std::out_of_range&)
+	{
+		// an id used before or without its definition
+		outError = "SPIR-V module references an undefined id";
+		return false;
+	}
+
+	std::sort(outReflection.descriptorBindings.begin(), outReflection.descriptorBindings.end(),
+		[](const ReflectedDescriptorBinding& a, const ReflectedDescriptorBinding& b) { return a.set != b.set ? a.set < b.set : a.binding < b.binding; });
+	std::sort(outReflection.specConstants.begin(), outReflection.specConstants.end(),
+		[](const ReflectedSpecConstant& a, const ReflectedSpecConstant& b) { return a.specId < b.specId; });
+	std::sort(outReflection.vertexAttributes.begin(), outReflection.vertexAttributes.end(),
+		[](const VkVertexInputAttributeDescription& a, const VkVertexInputAttributeDescription& b) { return a.location < b.location; });
+	return true;
+}
+
+PipelineLayoutDescription MergeShaderReflections(const std::vector<ShaderReflection>& reflections)
+{
+	PipelineLayoutDescription description;
+
+	VkPushConstantRange pushConstantRange{};
+	uint32_t pushConstantEnd = 0;
+
+	for (const ShaderReflection& reflection : reflections)
+	{
+		for (const ReflectedDescriptorBinding& binding : reflection.descriptorBindings)
+		{
+			if (description.setBindings.size() <= binding.set)
+			{
+				description.setBindings.resize(binding.set + 1);
+			}
+
+			std::vector<VkDescriptorSetLayoutBinding>& setBindings = description.setBindings[binding.set];
+			auto existing = std::find_if(setBindings.begin(), setBindings.end(),
+				[&binding](const VkDescriptorSetLayoutBinding& setBinding) { return setBinding.binding == binding.binding; });
+
+			if (existing == setBindings.end())
+			{
+				VkDescriptorSetLayoutBinding setBinding{};
+				setBinding.binding = binding.binding;
+				setBinding.descriptorType = binding.descriptorType;
+				setBinding.descriptorCount = binding.descriptorCount;
+				setBinding.stageFlags = reflection.stage;
+				setBindings.push_back(setBinding);
+			}
+			else if (existing->descriptorType != binding.descriptorType || existing->descriptorCount != binding.descriptorCount)
+			{
+				throw std::runtime_error("shader stages disagree on set " + std::to_string(binding.set) + " binding " + std::to_string(binding.binding));
+			}
+			else
+			{
+				existing->stageFlags |= reflection.stage;
+			}
+		}
+
+		if (reflection.pushConstantSize > 0)
+		{
+			const uint32_t end = reflection.pushConstantOffset + reflection.pushConstantSize;
+			pushConstantRange.offset = pushConstantRange.stageFlags ? std::min(pushConstantRange.offset, reflection.pushConstantOffset) : reflection.pushConstantOffset;
+			pushConstantEnd = std::max(pushConstantEnd, end);
+			pushConstantRange.stageFlags |= reflection.stage;
+		}
+	}
+
+	for (std::vector<VkDescriptorSetLayoutBinding>& setBindings : description.setBindings)
+	{
+		std::sort(setBindings.begin(), setBindings.end(),
+			[](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) { return a.binding < b.binding; });
+	}
+
+	if (pushConstantRange.stageFlags)
+	{
+		pushConstantRange.size = pushConstantEnd - pushConstantRange.offset;
+		description.pushConstantRanges.push_back(pushConstantRange);
+	}
+
+	return description;
+}
+
+// Bytes per vertex for the formats GetVertexFormat produces
+static uint32_t GetFormatSize(VkFormat format)
+{
+	switch (format)
+	{
+	case VK_FORMAT_R16_SFLOAT: return 2;
+	case VK_FORMAT_R16G16_SFLOAT: return 4;
+	case VK_FORMAT_R16G16B16_SFLOAT: return 6;
+	case VK_FORMAT_R16G16B16A16_SFLOAT: return 8;
+	case VK_FORMAT_R32_SFLOAT: case VK_FORMAT_R32_SINT: case VK_FORMAT_R32_UINT: return 4;
+	case VK_FORMAT_R32G32_SFLOAT: case VK_FORMAT_R32G32_SINT: case VK_FORMAT_R32G32_UINT: return 8;
+	case VK_FORMAT_R32G32B32_SFLOAT: case VK_FORMAT_R32G32B32_SINT: case VK_FORMAT_R32G32B32_UINT: return 12;
+	case VK_FORMAT_R32G32B32A32_SFLOAT: case VK_FORMAT_R32G32B32A32_SINT: case VK_FORMAT_R32G32B32A32_UINT: return 16;
+	case VK_FORMAT_R64_SFLOAT: return 8;
+	case VK_FORMAT_R64G64_SFLOAT: return 16;
+	case VK_FORMAT_R64G64B64_SFLOAT: return 24;
+	case VK_FORMAT_R64G64B64A64_SFLOAT: return 32;
+	default: return 0;
+	}
+}
+
+void GetPackedVertexInput(const ShaderReflection& vertexReflection, std::vector<VkVertexInputBindingDescription>& outBindings, std::vector<VkVertexInputAttributeDescription>& outAttributes)
+{
+	outBindings.clear();
+	outAttributes = vertexReflection.vertexAttributes;
+	if (outAttributes.empty())
+	{
+		return;
+	}
+
+	uint32_t offset = 0;
+	for (VkVertexInputAttributeDescription& attribute : outAttributes)
+	{
+		attribute.binding = 0;
+		attribute.offset = offset;
+		offset += GetFormatSize(attribute.format);
+	}
+
+	VkVertexInputBindingDescription binding{};
+	binding.binding = 0;
+	binding.stride = offset;
+	binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	outBindings.push_back(binding);
+}
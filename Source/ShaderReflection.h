@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "vulkan/vulkan.h"
+
+struct ReflectedDescriptorBinding
+{
+	uint32_t set;
+	uint32_t binding;
+	VkDescriptorType descriptorType;
+	uint32_t descriptorCount;
+};
+
+enum class SpecConstantType
+{
+	Bool,
+	Int,
+	Uint,
+	Float
+};
+
+// layout(constant_id = N) const ... NAME = default;
+struct ReflectedSpecConstant
+{
+	uint32_t specId;
+	// the GLSL name, empty when the module was stripped of debug names
+	std::string name;
+	SpecConstantType type;
+	// bytes in VkSpecializationInfo data: 4 for bool (VkBool32) and 32-bit types, 8 for 64-bit types
+	uint32_t size;
+};
+
+// What a pipeline layout and vertex input state need to know about one compiled stage
+struct ShaderReflection
+{
+	VkShaderStageFlagBits stage = VK_SHADER_STAGE_VERTEX_BIT;
+	std::vector<ReflectedDescriptorBinding> descriptorBindings;
+	// offset and size of the push constant block, or zero size when the stage has none
+	uint32_t pushConstantOffset = 0;
+	uint32_t pushConstantSize = 0;
+	// vertex stage inputs in location order; matrices and arrays take one attribute per location
+	std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+	// in specId order
+	std::vector<ReflectedSpecConstant> specConstants;
+};
+
+// Reads the resources of the first entry point straight from the SPIR-V words. Fails on malformed
+// modules and on resources this engine cannot build a layout for (runtime descriptor arrays).
+// Array lengths given by specialization constants take the values in specialization, or the
+// constants' defaults when there is none or it leaves them out.
+bool ReflectShader(const std::vector<uint32_t>& spirv, ShaderReflection& outReflection, std::string& outError,
+	const VkSpecializationInfo* specialization = nullptr);
+
+// The layout shared by a set of stages: bindings merged per set with their stage flags OR'ed, and one
+// push constant range covering every stage's block
+struct PipelineLayoutDescription
+{
+	// indexed by set number; sets a shader skips are left empty
+	std::vector<std::vector<VkDescriptorSetLayoutBinding>> setBindings;
+	std::vector<VkPushConstantRange> pushConstantRanges;
+};
+
+// Throws when two stages disagree on the type or count of the same set and binding
+PipelineLayoutDescription MergeShaderReflections(const std::vector<ShaderReflection>& reflections);
+
+// Attributes packed in location order into vertex buffer binding 0, which is how the engine lays out
+// interleaved vertices; pipelines with other layouts fill in PipelineConfigInfo themselves
+void GetPackedVertexInput(const ShaderReflection& vertexReflection, std::vector<VkVertexInputBindingDescription>& outBindings, std::vector<VkVertexInputAttributeDescription>& outAttributes);
@@ -0,0 +1,130 @@
+#include "ShaderWatcher.h"
+
+#include <algorithm>
+#include <iostream>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+ShaderWatcher::ShaderWatcher(const std::string& directory)
+	: directory(directory)
+{
+#if defined(__linux__)
+	inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	// editors save either in place (close after write) or by renaming a temporary file over the original
+	if (inotifyFd >= 0 && inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE) < 0)
+	{
+		std::cerr << "Failed to watch " << directory << ", falling back to polling\n";
+		close(inotifyFd);
+		inotifyFd = -1;
+	}
+#endif
+
+	if (inotifyFd < 0)
+	{
+		ScanModificationTimes(modificationTimes);
+		lastScan = std::chrono::steady_clock::now();
+	}
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+#if defined(__linux__)
+	if (inotifyFd >= 0)
+	{
+		close(inotifyFd);
+	}
+#endif
+}
+
+std::vector<std::string> ShaderWatcher::Poll()
+{
+	if (inotifyFd < 0)
+	{
+		return PollModificationTimes();
+	}
+
+	std::vector<std::string> changedFiles;
+#if defined(__linux__)
+	alignas(inotify_event) char buffer[4096];
+	while (true)
+	{
+		const ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+		if (length <= 0)
+		{
+			break;
+		}
+
+		for (ssize_t offset = 0; offset < length;)
+		{
+			const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+			offset += sizeof(inotify_event) + event->len;
+
+			if (event->len == 0 || (event->mask & IN_ISDIR))
+			{
+				continue;
+			}
+
+			const std::string path = (std::filesystem::path(directory) / event->name).generic_string();
+			if (std::find(changedFiles.begin(), changedFiles.end(), path) == changedFiles.end())
+			{
+				changedFiles.push_back(path);
+			}
+		}
+	}
+#endif
+	return changedFiles;
+}
+
+std::vector<std::string> ShaderWatcher::PollModificationTimes()
+{
+	std::vector<std::string> changedFiles;
+
+	const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (now - lastScan < kPollInterval)
+	{
+		return changedFiles;
+	}
+	lastScan = now;
+
+	std::unordered_map<std::string, std::filesystem::file_time_type> times;
+	ScanModificationTimes(times);
+
+	for (const auto& [path, time] : times)
+	{
+		const auto previous = modificationTimes.find(path);
+		if (previous == modificationTimes.end() || previous->second != time)
+		{
+			changedFiles.push_back(path);
+		}
+	}
+	for (const auto& [path, time] : modificationTimes)
+	{
+		if (times.find(path) == times.end())
+		{
+			changedFiles.push_back(path);
+		}
+	}
+
+	modificationTimes = std::move(times);
+	return changedFiles;
+}
+
+void ShaderWatcher::ScanModificationTimes(std::unordered_map<std::string, std::filesystem::file_time_type>& outTimes) const
+{
+	std::error_code error;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory, error))
+	{
+		std::error_code entryError;
+		if (entry.is_regular_file(entryError))
+		{
+			const std::filesystem::file_time_type time = entry.last_write_time(entryError);
+			if (!entryError)
+			{
+				outTimes[entry.path().generic_string()] = time;
+			}
+		}
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Reports files in one directory that were written, created, renamed into place or deleted. On Linux
+// this reads inotify events, so an idle Poll costs one non-blocking read. Elsewhere it falls back to
+// comparing modification times, rescanning the directory at most every kPollInterval.
+// Subdirectories are not watched.
+class ShaderWatcher
+{
+public:
+	explicit ShaderWatcher(const std::string& directory);
+	~ShaderWatcher();
+
+	ShaderWatcher(const ShaderWatcher&) = delete;
+	void operator=(const ShaderWatcher&) = delete;
+
+	// Never blocks. Each changed path is reported once per call, however many events it produced.
+	std::vector<std::string> Poll();
+private:
+	std::vector<std::string> PollModificationTimes();
+	void ScanModificationTimes(std::unordered_map<std::string, std::filesystem::file_time_type>& outTimes) const;
+private:
+	static constexpr std::chrono::milliseconds kPollInterval{ 250 };
+
+	std::string directory;
+	// inotify descriptor, or -1 when using the modification time fallback
+	int inotifyFd = -1;
+
+	std::unordered_map<std::string, std::filesystem::file_time_type> modificationTimes;
+	std::chrono::steady_clock::time_point lastScan;
+};
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <new>
+#include <stddef.h>
+
+// Thin wrapper over the vector instruction set MathLib is built for. AVX2 is opt-in through the
+// ENGINE_ENABLE_AVX2 CMake option; x64 builds always have SSE2; anything else runs one lane at a time.
+// Defining ENGINE_SIMD_SCALAR forces the one-lane path, which the benchmarks use as the scalar baseline.
+#if !defined(ENGINE_SIMD_SCALAR) && defined(__AVX2__)
+#include <immintrin.h>
+#define ENGINE_SIMD_AVX2 1
+#elif !defined(ENGINE_SIMD_SCALAR) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define ENGINE_SIMD_SSE2 1
+#endif
+
+static constexpr size_t kSimdAlignment = 32;
+
+#if ENGINE_SIMD_AVX2
+
+struct SimdFloat
+{
+	static constexpr size_t Width = 8;
+	__m256 v;
+};
+
+inline SimdFloat SimdLoad(const float* p) { return { _mm256_loadu_ps(p) }; }
+inline void SimdStore(float* p, SimdFloat a) { _mm256_storeu_ps(p, a.v); }
+inline SimdFloat SimdSet(float x) { return { _mm256_set1_ps(x) }; }
+inline SimdFloat SimdAdd(SimdFloat a, SimdFloat b) { return { _mm256_add_ps(a.v, b.v) }; }
+inline SimdFloat SimdSub(SimdFloat a, SimdFloat b) { return { _mm256_sub_ps(a.v, b.v) }; }
+inline SimdFloat SimdMul(SimdFloat a, SimdFloat b) { return { _mm256_mul_ps(a.v, b.v) }; }
+inline SimdFloat SimdDiv(SimdFloat a, SimdFloat b) { return { _mm256_div_ps(a.v, b.v) }; }
+inline SimdFloat SimdMin(SimdFloat a, SimdFloat b) { return { _mm256_min_ps(a.v, b.v) }; }
+inline SimdFloat SimdMax(SimdFloat a, SimdFloat b) { return { _mm256_max_ps(a.v, b.v) }; }
+inline SimdFloat SimdSqrt(SimdFloat a) { return { _mm256_sqrt_ps(a.v) }; }
+inline SimdFloat SimdAbs(SimdFloat a) { return { _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v) }; }
+inline SimdFloat SimdLess(SimdFloat a, SimdFloat b) { return { _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+// mask lanes are all ones or all zeros, as produced by SimdLess
+inline SimdFloat SimdSelect(SimdFloat mask, SimdFloat a, SimdFloat b) { return { _mm256_blendv_ps(b.v, a.v, mask.v) }; }
+// sign bits of b flipped onto a
+inline SimdFloat SimdXorSign(SimdFloat a, SimdFloat b) { return { _mm256_xor_ps(a.v, _mm256_and_ps(b.v, _mm256_set1_ps(-0.0f))) }; }
+
+// transposes a Width x Width block held as Width row vectors
+inline void SimdTranspose(SimdFloat* rows)
+{
+	const __m256 t0 = _mm256_unpacklo_ps(rows[0].v, rows[1].v);
+	const __m256 t1 = _mm256_unpackhi_ps(rows[0].v, rows[1].v);
+	const __m256 t2 = _mm256_unpacklo_ps(rows[2].v, rows[3].v);
+	const __m256 t3 = _mm256_unpackhi_ps(rows[2].v, rows[3].v);
+	const __m256 t4 = _mm256_unpacklo_ps(rows[4].v, rows[5].v);
+	const __m256 t5 = _mm256_unpackhi_ps(rows[4].v, rows[5].v);
+	const __m256 t6 = _mm256_unpacklo_ps(rows[6].v, rows[7].v);
+	const __m256 t7 = _mm256_unpackhi_ps(rows[6].v, rows[7].v);
+
+	const __m256 s0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+	const __m256 s1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+	const __m256 s2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+	const __m256 s3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+	const __m256 s4 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(1, 0, 1, 0));
+	const __m256 s5 = _mm256_shuffle_ps(t4, t6, _MM_SHUFFLE(3, 2, 3, 2));
+	const __m256 s6 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(1, 0, 1, 0));
+	const __m256 s7 = _mm256_shuffle_ps(t5, t7, _MM_SHUFFLE(3, 2, 3, 2));
+
+	rows[0].v = _mm256_permute2f128_ps(s0, s4, 0x20);
+	rows[1].v = _mm256_permute2f128_ps(s1, s5, 0x20);
+	rows[2].v = _mm256_permute2f128_ps(s2, s6, 0x20);
+	rows[3].v = _mm256_permute2f128_ps(s3, s7, 0x20);
+	rows[4].v = _mm256_permute2f128_ps(s0, s4, 0x31);
+	rows[5].v = _mm256_permute2f128_ps(s1, s5, 0x31);
+	rows[6].v = _mm256_permute2f128_ps(s2, s6, 0x31);
+	rows[7].v = _mm256_permute2f128_ps(s3, s7, 0x31);
+}
+
+#if defined(__FMA__) || defined(_MSC_VER)
+inline SimdFloat SimdMulAdd(SimdFloat a, SimdFloat b, SimdFloat c) { return { _mm256_fmadd_ps(a.v, b.v, c.v) }; }
+inline SimdFloat SimdMulSub(SimdFloat a, SimdFloat b, SimdFloat c) { return { _mm256_fmsub_ps(a.v, b.v, c.v) }; }
+#else
+inline SimdFloat SimdMulAdd(SimdFloat a, SimdFloat b, SimdFloat c) { return SimdAdd(SimdMul(a, b), c); }
+inline SimdFloat SimdMulSub(SimdFloat a, SimdFloat b, SimdFloat c) { return SimdSub(SimdMul(a, b), c); }
+#endif
+
+#elif ENGINE_SIMD_SSE2
+
+struct SimdFloat
+{
+	static constexpr size_t Width = 4;
+	__m128 v;
+};
+
+inline SimdFloat SimdLoad(const float* p) { return { _mm_loadu_ps(p) }; }
+inline void SimdStore(float* p, SimdFloat a) { _mm_storeu_ps(p, a.v); }
+inline SimdFloat SimdSet(float x) { return { _mm_set1_ps(x) }; }
+inline SimdFloat SimdAdd(SimdFloat a, SimdFloat b) { return { _mm_add_ps(a.v, b.v) }; }
+inline SimdFloat SimdSub(SimdFloat a, SimdFloat b) { return { _mm_sub_ps(a.v, b.v) }; }
+inline SimdFloat SimdMul(SimdFloat a, SimdFloat b) { return { _mm_mul_ps(a.v, b.v) }; }
+inline SimdFloat SimdDiv(SimdFloat a, SimdFloat b) { return { _mm_div_ps(a.v, b.v) }; }
+inline SimdFloat SimdMin(SimdFloat a, SimdFloat b) { return { _mm_min_ps(a.v, b.v) }; }
+inline SimdFloat SimdMax(SimdFloat a, SimdFloat b) { return { _mm_max_ps(a.v, b.v) }; }
+inline SimdFloat SimdSqrt(SimdFloat a) { return { _mm_sqrt_ps(a.v) }; }
+inline SimdFloat SimdAbs(SimdFloat a) { return { _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v) }; }
+inline SimdFloat SimdLess(SimdFloat a, SimdFloat b) { return { _mm_cmplt_ps(a.v, b.v) }; }
+inline SimdFloat SimdSelect(SimdFloat mask, SimdFloat a, SimdFloat b) { return { _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)) }; }
+inline SimdFloat SimdXorSign(SimdFloat a, SimdFloat b) { return { _mm_xor_ps(a.v, _mm_and_ps(b.v, _mm_set1_ps(-0.0f))) }; }
+inline SimdFloat SimdMulAdd(SimdFloat a, SimdFloat b, SimdFloat c) { return SimdAdd(SimdMul(a, b), c); }
+inline SimdFloat SimdMulSub(SimdFloat a, SimdFloat b, SimdFloat c) { return SimdSub(SimdMul(a, b), c); }
+
+inline void SimdTranspose(SimdFloat* rows)
+{
+	_MM_TRANSPOSE4_PS(rows[0].v, rows[1].v, rows[2].v, rows[3].v);
+}
+
+#else
+
+#include <cmath>
+
+struct SimdFloat
+{
+	static constexpr size_t Width = 1;
+	float v;
+};
+
+inline SimdFloat SimdLoad(const float* p) { return { *p }; }
+inline void SimdStore(float* p, SimdFloat a) { *p = a.v; }
+inline SimdFloat SimdSet(float x) { return { x }; }
+inline SimdFloat SimdAdd(SimdFloat a, SimdFloat b) { return { a.v + b.v }; }
+inline SimdFloat SimdSub(SimdFloat a, SimdFloat b) { return { a.v - b.v }; }
+inline SimdFloat SimdMul(SimdFloat a, SimdFloat b) { return { a.v * b.v }; }
+inline SimdFloat SimdDiv(SimdFloat a, SimdFloat b) { return { a.v / b.v }; }
+inline SimdFloat SimdMin(SimdFloat a, SimdFloat b) { return { a.v < b.v ? a.v : b.v }; }
+inline SimdFloat SimdMax(SimdFloat a, SimdFloat b) { return { a.v > b.v ? a.v : b.v }; }
+inline SimdFloat SimdSqrt(SimdFloat a) { return { std::sqrt(a.v) }; }
+inline SimdFloat SimdAbs(SimdFloat a) { return { std::fabs(a.v) }; }
+inline SimdFloat SimdLess(SimdFloat a, SimdFloat b) { return { a.v < b.v ? 1.0f : 0.0f }; }
+inline SimdFloat SimdSelect(SimdFloat mask, SimdFloat a, SimdFloat b) { return { mask.v != 0.0f ? a.v : b.v }; }
+inline SimdFloat SimdXorSign(SimdFloat a, SimdFloat b) { return { std::signbit(b.v) ? -a.v : a.v }; }
+inline SimdFloat SimdMulAdd(SimdFloat a, SimdFloat b, SimdFloat c) { return { a.v * b.v + c.v }; }
+inline SimdFloat SimdMulSub(SimdFloat a, SimdFloat b, SimdFloat c) { return { a.v * b.v - c.v }; }
+inline void SimdTranspose(SimdFloat*) {}
+
+#endif
+
+// Allocator for the SoA buffers, so vector loads never straddle a cache line
+template <typename T, size_t Alignment = kSimdAlignment>
+struct AlignedAllocator
+{
+	using value_type = T;
+
+	template <typename U>
+	struct rebind
+	{
+		using other = AlignedAllocator<U, Alignment>;
+	};
+
+	AlignedAllocator() = default;
+
+	template <typename U>
+	AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+	T* allocate(size_t count)
+	{
+		return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(Alignment)));
+	}
+
+	void deallocate(T* p, size_t)
+	{
+		::operator delete(p, std::align_val_t(Alignment));
+	}
+
+	template <typename U>
+	bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+	template <typename U>
+	bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false; }
+};
@@ -0,0 +1,164 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+ThreadPool::ThreadPool(size_t threadCount)
+{
+	if (threadCount == 0)
+	{
+		const size_t hardwareThreads = std::thread::hardware_concurrency();
+		threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	workers.reserve(threadCount);
+	for (size_t i = 0; i < threadCount; ++i)
+	{
+		workers.emplace_back(&ThreadPool::WorkerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		bStopping = true;
+	}
+	condition.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+size_t ThreadPool::GetThreadCount() const
+{
+	return workers.size();
+}
+
+void ThreadPool::Enqueue(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		tasks.push_back(std::move(task));
+	}
+	condition.notify_one();
+}
+
+void ThreadPool::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [this]() { return bStopping || !tasks.empty(); });
+			if (bStopping && tasks.empty())
+			{
+				return;
+			}
+
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+
+		task();
+	}
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t minChunkSize, const std::function<void(size_t, size_t)>& body)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	// a few chunks per thread so uneven chunks still balance out
+	const size_t participants = workers.size() + 1;
+	const size_t chunkSize = std::max(std::max<size_t>(minChunkSize, 1), (count + participants * 4 - 1) / (participants * 4));
+	const size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+
+	if (chunkCount == 1)
+	{
+		body(0, count);
+		return;
+	}
+
+	struct SharedState
+	{
+		std::atomic<size_t> nextChunk{ 0 };
+		std::atomic<size_t> remainingChunks{ 0 };
+		std::mutex mutex;
+		std::condition_variable done;
+		// the first exception thrown by body, rethrown on the caller
+		std::exception_ptr error;
+	};
+
+	std::shared_ptr<SharedState> state = std::make_shared<SharedState>();
+	state->remainingChunks = chunkCount;
+
+	auto runChunks = [state, count, chunkSize, chunkCount, &body]()
+	{
+		size_t chunk;
+		while ((chunk = state->nextChunk.fetch_add(1)) < chunkCount)
+		{
+			const size_t begin = chunk * chunkSize;
+			size_t finishedChunks = 1;
+			try
+			{
+				body(begin, std::min(begin + chunkSize, count));
+			}
+			catch (...)
+			{
+				{
+					std::lock_guard<std::mutex> lock(state->mutex);
+					if (!state->error)
+					{
+						state->error = std::current_exception();
+					}
+				}
+
+				// stop handing out chunks; the ones nobody claimed yet count as finished
+				const size_t claimedChunks = std::min(state->nextChunk.exchange(chunkCount), chunkCount);
+				finishedChunks += chunkCount - claimedChunks;
+			}
+
+			if (state->remainingChunks.fetch_sub(finishedChunks) == finishedChunks)
+			{
+				std::lock_guard<std::mutex> lock(state->mutex);
+				state->done.notify_all();
+			}
+		}
+	};
+
+	// helpers that start after every chunk was claimed return immediately, so body is never touched after we return
+	const size_t helperCount = std::min(workers.size(), chunkCount - 1);
+	for (size_t i = 0; i < helperCount; ++i)
+	{
+		Enqueue(runChunks);
+	}
+
+	runChunks();
+
+	// chunks still running on the workers use body, so wait for them even when one has failed
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->done.wait(lock, [&state]() { return state->remainingChunks.load() == 0; });
+	if (state->error)
+	{
+		std::rethrow_exception(state->error);
+	}
+}
+
+void ParallelFor(ThreadPool* threadPool, size_t count, size_t minChunkSize, const std::function<void(size_t, size_t)>& body)
+{
+	if (threadPool)
+	{
+		threadPool->ParallelFor(count, minChunkSize, body);
+	}
+	else if (count > 0)
+	{
+		body(0, count);
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stddef.h>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads shared by the CPU-side systems (FFT passes, shader compiles, ...).
+class ThreadPool
+{
+public:
+	// threadCount of zero uses one worker per hardware thread, minus the calling thread
+	explicit ThreadPool(size_t threadCount = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	void operator=(const ThreadPool&) = delete;
+
+	template <typename F>
+	auto Submit(F&& task) -> std::future<decltype(task())>
+	{
+		using Result = decltype(task());
+		auto packagedTask = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+		std::future<Result> future = packagedTask->get_future();
+		Enqueue([packagedTask]() { (*packagedTask)(); });
+		return future;
+	}
+
+	// Splits [0, count) into chunks of at least minChunkSize and runs body(begin, end) on the workers.
+	// The calling thread works on chunks too, so this is safe to call from inside a pool task. If body
+	// throws, no further chunks start, and the first exception is rethrown here once the running ones end.
+	void ParallelFor(size_t count, size_t minChunkSize, const std::function<void(size_t, size_t)>& body);
+
+	size_t GetThreadCount() const;
+private:
+	void Enqueue(std::function<void()> task);
+	void WorkerLoop();
+private:
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> tasks;
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool bStopping = false;
+};
+
+// ThreadPool::ParallelFor when there is a pool, otherwise body(0, count) on the calling thread
+void ParallelFor(ThreadPool* threadPool, size_t count, size_t minChunkSize, const std::function<void(size_t, size_t)>& body);
@@ -23,7 +23,7 @@ Window::~Window()
     glfwDestroyWindow(this->window);
 }
 
-void Window::Run()
+void Window::Run(const std::function<void()>& onFrame)
 {
     while (!glfwWindowShouldClose(this->window))
     {
@@ -31,6 +31,11 @@ void Window::Run()
         glfwGetFramebufferSize(this->window, &Width, &Height);
         glfwSwapBuffers(this->window);
         glfwPollEvents();
+
+        if (onFrame)
+        {
+            onFrame();
+        }
     }
 }
 
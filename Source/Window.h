@@ -3,6 +3,8 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include <functional>
+
 class Window 
 {
 public:
@@ -12,7 +14,8 @@ public:
     Window(Window const&) = delete;
     Window& operator=(Window other) = delete;
 
-    void Run();
+    // onFrame runs once per frame, after the window events are handled
+    void Run(const std::function<void()>& onFrame = nullptr);
     void CreateSurface(VkInstance instance, const VkAllocationCallbacks* allocationCallbacks, VkSurfaceKHR* surface) const;
     void GetWindowSize(int& outWidth, int& outHeight);
     void GetFramebufferSize(int& outWidth, int& outHeight);
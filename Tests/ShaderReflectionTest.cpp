@@ -0,0 +1,99 @@
+#include "ShaderCompiler.h"
+#include "ShaderReflection.h"
+
+#include <stdint.h>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Array lengths set by specialization constants, checked at their defaults and specialized
+static const char* kVertexSource = R"(#version 450
+layout(constant_id = 0) const int COUNT = 4;
+layout(location = 0) in vec4 weights[COUNT];
+layout(push_constant) uniform Push { vec4 values[COUNT]; } push;
+void main() { gl_Position = weights[0] + push.values[0]; }
+)";
+
+static const char* kFragmentSource = R"(#version 450
+layout(constant_id = 0) const int COUNT = 4;
+layout(set = 0, binding = 0) uniform sampler2D textures[COUNT];
+layout(set = 0, binding = 1) uniform sampler2D shadowMaps[COUNT * 2];
+layout(location = 0) out vec4 color;
+void main() { color = texture(textures[0], vec2(0.0)) + texture(shadowMaps[0], vec2(0.0)); }
+)";
+
+static int failureCount = 0;
+
+static void Check(bool bCondition, const std::string& message)
+{
+	if (!bCondition)
+	{
+		std::cerr << "FAILED: " << message << std::endl;
+		++failureCount;
+	}
+}
+
+static std::vector<uint32_t> Compile(const ShaderCompiler& compiler, const char* name, const char* source, ShaderStage stage)
+{
+	ShaderCompileRequest request;
+	request.sourcePath = name;
+	request.source = source;
+	request.stage = stage;
+	const ShaderCompileResult result = compiler.Compile(request);
+	Check(result.bSuccess, std::string("compile ") + name + ": " + result.log);
+	return result.spirv;
+}
+
+static void CheckCounts(const std::vector<uint32_t>& vertSpirv, const std::vector<uint32_t>& fragSpirv, const VkSpecializationInfo* specialization, uint32_t count)
+{
+	const std::string label = " with COUNT = " + std::to_string(count);
+
+	ShaderReflection vertReflection;
+	std::string error;
+	Check(ReflectShader(vertSpirv, vertReflection, error, specialization), "reflect vertex" + label + ": " + error);
+	Check(vertReflection.vertexAttributes.size() == count, "vertex attributes" + label);
+	Check(vertReflection.pushConstantSize == count * 16, "push constant size" + label);
+
+	ShaderReflection fragReflection;
+	Check(ReflectShader(fragSpirv, fragReflection, error, specialization), "reflect fragment" + label + ": " + error);
+	Check(fragReflection.descriptorBindings.size() == 2, "descriptor bindings" + label);
+	if (fragReflection.descriptorBindings.size() == 2)
+	{
+		Check(fragReflection.descriptorBindings[0].descriptorCount == count, "descriptor count" + label);
+		Check(fragReflection.descriptorBindings[1].descriptorCount == count * 2, "descriptor count of an expression" + label);
+	}
+}
+
+int main()
+{
+	ShaderCompiler compiler;
+	const std::vector<uint32_t> vertSpirv = Compile(compiler, "spec_arrays.vert", kVertexSource, ShaderStage::Vertex);
+	const std::vector<uint32_t> fragSpirv = Compile(compiler, "spec_arrays.frag", kFragmentSource, ShaderStage::Fragment);
+	if (failureCount == 0)
+	{
+		CheckCounts(vertSpirv, fragSpirv, nullptr, 4);
+
+		const int32_t count = 6;
+		const VkSpecializationMapEntry entry = { 0, 0, sizeof(count) };
+		VkSpecializationInfo specialization{};
+		specialization.mapEntryCount = 1;
+		specialization.pMapEntries = &entry;
+		specialization.dataSize = sizeof(count);
+		specialization.pData = &count;
+		CheckCounts(vertSpirv, fragSpirv, &specialization, 6);
+
+		// an entry for another constant leaves the default in place
+		const VkSpecializationMapEntry otherEntry = { 1, 0, sizeof(count) };
+		specialization.pMapEntries = &otherEntry;
+		CheckCounts(vertSpirv, fragSpirv, &specialization, 4);
+	}
+
+	if (failureCount > 0)
+	{
+		std::cerr << failureCount << " check(s) failed" << std::endl;
+		return 1;
+	}
+	std::cout << "shader reflection tests passed" << std::endl;
+	return 0;
+}
@@ -1,5 +0,0 @@
-@echo off
-
-C:\VulkanSDK\1.3.236.0\Bin\glslc.exe Shaders/main.vert -o Shaders/vert.spv
-C:\VulkanSDK\1.3.236.0\Bin\glslc.exe Shaders/main.frag -o Shaders/frag.spv
-pause
\ No newline at end of file